@@ -32,11 +32,24 @@ extern void _bios_int(uint8_t intnum, bios_int_regs_t* regs);
 
 void bios_int(uint8_t intnum, bios_int_regs_t* regs)
 {
+	uint16_t fs;
+	uint16_t gs;
+
 	disable_local_interrupt();
+
+	/* The BIOS call loads flat data segments in FS and GS, restore the local
+	 * storage segments.
+	 */
+	__asm__ __volatile__("movw %%fs, %w0" : "=r" (fs));
+	__asm__ __volatile__("movw %%gs, %w0" : "=r" (gs));
+
 	disable_paging();
 
 	_bios_int(intnum, regs);
 
+	__asm__ __volatile__("movw %w0, %%fs" :: "r" (fs));
+	__asm__ __volatile__("movw %w0, %%gs" :: "r" (gs));
+
 	enable_paging();
 	enable_local_interrupt();
 }
@@ -23,10 +23,12 @@
 #include "../drivers/mouse.h"       /* init_mouse */
 #include "../drivers/rtc.h"         /* init_rtc */
 #include "../drivers/pit.h"         /* init_pit */
+#include "../drivers/tsc.h"         /* init_tsc */
 #include "../drivers/pic.h"         /* init_pic */
 #include "../drivers/acpi.h"        /* init_acpi */
 #include "../cpu/cpu.h"             /* get_cpu_info */
-#include "../cpu/smp.h"             /* get_cpu_count */
+#include "../cpu/smp.h"             /* get_cpu_count, init_smp */
+#include "../cpu/fpu.h"             /* init_fpu */
 #include "../core/scheduler.h"      /* init_scheduler */
 #include "../core/interrupts.h"     /* init_kernel_interrupt */
 #include "../core/panic.h"          /* kernel_panic */
@@ -134,6 +136,10 @@ void kernel_kickstart(void)
 #ifdef TESTS
     test_bios_call();
     test_klist();
+    test_rbtree();
+    test_slab();
+    test_stack_pool();
+    test_futex();
 #endif
 
     /* Init VESA */
@@ -179,6 +185,17 @@ void kernel_kickstart(void)
     test_sw_interupts();
 #endif
 
+    /* Init FPU */
+    err = init_fpu();
+    if(err == OS_NO_ERR)
+    {
+        kernel_success("FPU Initialized\n");
+    }
+    else
+    {
+        kernel_info("FPU / SSE not available, threads cannot use them\n");
+    }
+
     /* Init PIC */
     err = init_pic();
     if(err == OS_NO_ERR)
@@ -265,6 +282,20 @@ void kernel_kickstart(void)
     #endif
     }
 
+    /* Init TSC */
+    err = init_tsc();
+    if(err == OS_NO_ERR)
+    {
+        kernel_success("TSC Initialized, %d kHz\n", get_tsc_frequency_khz());
+    }
+    else
+    {
+        kernel_info("TSC not available, the monotonic clock uses the uptime\n");
+    }
+#ifdef TESTS
+    test_tsc();
+#endif
+
     /* Init RTC */
     err = init_rtc();
     if(err == OS_NO_ERR)
@@ -326,6 +357,22 @@ void kernel_kickstart(void)
     //test_ata();
 #endif
 
+    /* Init SMP */
+    if(acpi_get_lapic_available() == 1)
+    {
+        err = init_smp();
+        if(err == OS_NO_ERR)
+        {
+            kernel_success("SMP Initialized, %d CPU running\n",
+                           get_booted_cpu_count());
+        }
+        else
+        {
+            kernel_error("SMP Initialization error [%d]\n", err);
+            kernel_panic();
+        }
+    }
+
     /* Init Scheduler */
     err = init_scheduler();
 
@@ -24,6 +24,7 @@
 #include "../drivers/lapic.h"    /* set_INT_LAPIC_EOI */
 #include "../cpu/cpu_settings.h" /* IDT_ENTRY_COUNT */
 #include "../cpu/cpu.h"          /* sti cli */
+#include "../cpu/smp.h"          /* get_cpu_id, MAX_CPU_COUNT */
 #include "kernel_output.h"       /* kernel_success */
 #include "panic.h"               /* panic, interrupt */
 
@@ -46,8 +47,10 @@ static uint8_t io_apic_capable;
 /* Tells the kernel if the LAPIC is available */
 static uint8_t lapic_capable;
 
-/* Keep track on the nexting level, kernel starts with interrupt disabled */
-static volatile uint32_t int_lock_nesting = 1;
+/* Keep track on the nexting level of each CPU, kernel starts with interrupt
+ * disabled. APs nesting levels are set at interrupt init.
+ */
+static volatile uint32_t int_lock_nesting[MAX_CPU_COUNT] = {1};
 
 /*******************************************************************************
  * FUNCTIONS
@@ -76,22 +79,24 @@ void kernel_interrupt_handler(cpu_state_t cpu_state,
                               uint32_t int_id,
                               stack_state_t stack_state)
 {
+    uint32_t cpu_id = get_cpu_id();
+
     /* If interrupts are disabled */
-    if(int_lock_nesting > 0 &&
+    if(int_lock_nesting[cpu_id] > 0 &&
        int_id != PANIC_INT_LINE &&
        int_id != SCHEDULER_SW_INT_LINE &&
        int_id >= MIN_INTERRUPT_LINE)
     {
         #ifdef DEBUG_INTERRUPT
         kernel_serial_debug("Blocked interrupt %d, (nesting level %d)\n",
-                            int_id, int_lock_nesting);
+                            int_id, int_lock_nesting[cpu_id]);
         #endif
         return;
     }
 
     #ifdef DEBUG_INTERRUPT
     kernel_serial_debug("Interrupt %d, (nesting level %d)\n",
-                        int_id, int_lock_nesting);
+                        int_id, int_lock_nesting[cpu_id]);
     #endif
 
     /* Execute custom handlers */
@@ -147,8 +152,11 @@ OS_RETURN_E init_kernel_interrupt(void)
 
     spinlock_init(&handler_table_lock);
 
-    /* INT are disabled */
-    int_lock_nesting = 1;
+    /* INT are disabled on all CPUs */
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        int_lock_nesting[i] = 1;
+    }
 
     return OS_NO_ERR;
 }
@@ -194,6 +202,47 @@ OS_RETURN_E register_interrupt_handler(const uint32_t interrupt_line,
     return OS_NO_ERR;
 }
 
+OS_RETURN_E register_exception_handler(const uint32_t exception_line,
+                                       void(*handler)(
+                                             cpu_state_t*,
+                                             uint32_t,
+                                             stack_state_t*
+                                             )
+                                       )
+{
+    if(exception_line >= MIN_INTERRUPT_LINE)
+    {
+        return OR_ERR_UNAUTHORIZED_INTERRUPT_LINE;
+    }
+
+    if(handler == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    spinlock_lock(&handler_table_lock);
+
+    /* Exceptions are attached to the kernel panic by default */
+    if(kernel_interrupt_handlers[exception_line].handler != panic)
+    {
+        spinlock_unlock(&handler_table_lock);
+
+        return OS_ERR_INTERRUPT_ALREADY_REGISTERED;
+    }
+
+    kernel_interrupt_handlers[exception_line].handler = handler;
+    kernel_interrupt_handlers[exception_line].enabled = 1;
+
+    #ifdef DEBUG_INTERRUPT
+    kernel_serial_debug("Added exception %d handler at 0x%08x\n",
+                        exception_line, (uint32_t)handler);
+    #endif
+
+    spinlock_unlock(&handler_table_lock);
+
+    return OS_NO_ERR;
+}
+
 OS_RETURN_E remove_interrupt_handler(const uint32_t interrupt_line)
 {
     if(interrupt_line < MIN_INTERRUPT_LINE ||
@@ -225,16 +274,18 @@ OS_RETURN_E remove_interrupt_handler(const uint32_t interrupt_line)
 
 void enable_local_interrupt(void)
 {
-    if(int_lock_nesting > 0)
+    uint32_t cpu_id = get_cpu_id();
+
+    if(int_lock_nesting[cpu_id] > 0)
     {
-        --int_lock_nesting;
+        --int_lock_nesting[cpu_id];
     }
 
-    if(int_lock_nesting == 0)
+    if(int_lock_nesting[cpu_id] == 0)
     {
         #ifdef DEBUG_INTERRUPT
         kernel_serial_debug("--- Enabled HW INT (%d) ---\n",
-                            int_lock_nesting);
+                            int_lock_nesting[cpu_id]);
         #endif
 
         sti();
@@ -243,22 +294,27 @@ void enable_local_interrupt(void)
 
 void disable_local_interrupt(void)
 {
+    uint32_t cpu_id;
+
     cli();
 
-    if(int_lock_nesting < UINT32_MAX)
+    /* Interrupts are disabled, the thread cannot migrate anymore */
+    cpu_id = get_cpu_id();
+
+    if(int_lock_nesting[cpu_id] < UINT32_MAX)
     {
-        ++int_lock_nesting;
+        ++int_lock_nesting[cpu_id];
     }
 
     #ifdef DEBUG_INTERRUPT
     kernel_serial_debug("--- Disabled HW INT (%d) ---\n",
-                        int_lock_nesting);
+                        int_lock_nesting[cpu_id]);
     #endif
 }
 
 int8_t get_local_interrupt_enabled(void)
 {
-    return ((int_lock_nesting > 0) ? 0 : 1);
+    return ((int_lock_nesting[get_cpu_id()] > 0) ? 0 : 1);
 }
 
 
@@ -311,6 +367,72 @@ void update_tick(void)
     }
 }
 
+OS_RETURN_E set_sched_timer_oneshot(const uint32_t time_ms)
+{
+    if(lapic_capable == 1)
+    {
+        return lapic_timer_set_oneshot(time_ms);
+    }
+    else
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+}
+
+OS_RETURN_E set_sched_timer_oneshot_ns(const uint32_t time_ns)
+{
+    if(lapic_capable == 1)
+    {
+        return lapic_timer_set_oneshot_ns(time_ns);
+    }
+    else
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+}
+
+uint8_t set_sched_timer_deadline(const uint32_t time_ns)
+{
+    if(lapic_capable == 1)
+    {
+        return lapic_timer_set_deadline(time_ns);
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+uint8_t set_sched_timer_periodic(void)
+{
+    if(lapic_capable == 1)
+    {
+        return lapic_timer_set_periodic();
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+OS_RETURN_E send_sched_ipi(const uint32_t cpu_id)
+{
+    int32_t lapic_id;
+
+    if(lapic_capable != 1)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    lapic_id = get_cpu_lapic_id(cpu_id);
+    if(lapic_id < 0)
+    {
+        return OS_ERR_NO_SUCH_LAPIC_ID;
+    }
+
+    return lapic_send_ipi(lapic_id, SCHEDULER_IPI_INT_LINE);
+}
+
 int32_t get_IRQ_SCHED_TIMER(void)
 {
     if(lapic_capable == 1)
@@ -42,6 +42,7 @@
 
 #define LAPIC_TIMER_INTERRUPT_LINE  0x20
 #define SCHEDULER_SW_INT_LINE       0x21
+#define SCHEDULER_IPI_INT_LINE      0x22
 #define PANIC_INT_LINE              0x2A
 
 /*******************************************************************************
@@ -128,6 +129,23 @@ OS_RETURN_E register_interrupt_handler(const uint32_t interrupt_line,
                                              )
                                        );
 
+/* Register a custom exception handler to be executed instead of the kernel
+ * panic. The exception line must be less than the minimal authorized custom
+ * interrupt line.
+ *
+ * @param exception_line The exception line to attach the handler to.
+ * @param handler The handler for the desired exception.
+ * @return The function returns OS_NO_ERR in case of succes, otherwise, please
+ * refer to the error codes.
+ */
+OS_RETURN_E register_exception_handler(const uint32_t exception_line,
+                                       void(*handler)(
+                                             cpu_state_t*,
+                                             uint32_t,
+                                             stack_state_t*
+                                             )
+                                       );
+
 /* Unregister a custom interrupt handler to be executed. The interrupt line must
  * be greater or equal to the minimal authorized custom interrupt line and less
  * than the maximum one.
@@ -175,6 +193,47 @@ OS_RETURN_E set_IRQ_EOI(const uint32_t irq_number);
 /* Update kernel time counter by one tick, compute the uptime in ms */
 void update_tick(void);
 
+/* Stop the scheduler timer ticks of the current CPU, the timer interrupt is
+ * raised once after the time given as parameter. Only the LAPIC timer supports
+ * this mode. Local interrupts must be disabled.
+ *
+ * @param time_ms The time before the timer interrupt in milliseconds.
+ * @return The state or error code.
+ */
+OS_RETURN_E set_sched_timer_oneshot(const uint32_t time_ms);
+
+/* Same as set_sched_timer_oneshot with a nanosecond resolution.
+ *
+ * @param time_ns The time before the timer interrupt in nanoseconds.
+ * @return The state or error code.
+ */
+OS_RETURN_E set_sched_timer_oneshot_ns(const uint32_t time_ns);
+
+/* Raise the scheduler timer interrupt of the current CPU after the time given
+ * as parameter if it comes before the next tick. The ticks are stopped until
+ * set_sched_timer_periodic is called. Only the LAPIC timer supports this mode.
+ * Local interrupts must be disabled.
+ *
+ * @param time_ns The time before the deadline in nanoseconds.
+ * @return 1 if the deadline was programmed, 0 otherwise.
+ */
+uint8_t set_sched_timer_deadline(const uint32_t time_ns);
+
+/* Restart the scheduler timer ticks of the current CPU. The time elapsed
+ * without ticks is accounted in the uptime. Local interrupts must be disabled.
+ *
+ * @return 1 if the ticks were stopped, 0 otherwise.
+ */
+uint8_t set_sched_timer_periodic(void);
+
+/* Raise the scheduler IPI on the CPU given as parameter. Only the LAPIC
+ * supports IPIs.
+ *
+ * @param cpu_id The id of the CPU to send the IPI to.
+ * @return The state or error code.
+ */
+OS_RETURN_E send_sched_ipi(const uint32_t cpu_id);
+
 /* Returns the timer IRQ number attached to the scheduler.
  *
  * @return The IRQ number of the timer that is attached to the scheduler.
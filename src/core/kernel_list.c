@@ -14,7 +14,7 @@
 #include "../lib/stddef.h"  /* OS_RETURN_E */
 #include "../lib/stdint.h"  /* Generic int types */
 #include "../lib/string.h"  /* memset */
-#include "../memory/heap.h" /* kmalloc, kfree */
+#include "../memory/slab.h" /* kmem_cache_alloc, kmem_cache_free */
 
 #include "../debug.h"       /* kernel_serial_debug */
 
@@ -25,16 +25,36 @@
  * GLOBAL VARIABLES
  ******************************************************************************/
 
+/* Lists constructor */
+static void kernel_list_ctor(void* obj);
+
+/* Nodes and lists caches */
+static kmem_cache_t node_cache = KMEM_CACHE_INIT("kernel_list_node",
+                                                 sizeof(kernel_list_node_t),
+                                                 NULL, NULL);
+static kmem_cache_t list_cache = KMEM_CACHE_INIT("kernel_list",
+                                                 sizeof(kernel_list_t),
+                                                 kernel_list_ctor, NULL);
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
 
+/* Lists constructor, a list is always given back empty to its cache.
+ *
+ * @param obj The list to construct.
+ */
+static void kernel_list_ctor(void* obj)
+{
+    memset(obj, 0, sizeof(kernel_list_t));
+}
+
  kernel_list_node_t* kernel_list_create_node(void* data, OS_RETURN_E *error)
  {
      kernel_list_node_t* new_node;
 
      /* Create new node */
-     new_node = kmalloc(sizeof(kernel_list_node_t));
+     new_node = kmem_cache_alloc(&node_cache);
 
      if(new_node == NULL)
      {
@@ -70,7 +90,7 @@ OS_RETURN_E kernel_list_delete_node(kernel_list_node_t** node)
         return OS_ERR_UNAUTHORIZED_ACTION;
     }
 
-    kfree(*node);
+    kmem_cache_free(&node_cache, *node);
 
     *node = NULL;
 
@@ -82,7 +102,7 @@ kernel_list_t* kernel_list_create_list(OS_RETURN_E *error)
     kernel_list_t* new_list;
 
     /* Create new node */
-    new_list = kmalloc(sizeof(kernel_list_t));
+    new_list = kmem_cache_alloc(&list_cache);
     if(new_list == NULL)
     {
         if(error != NULL)
@@ -92,8 +112,9 @@ kernel_list_t* kernel_list_create_list(OS_RETURN_E *error)
         return NULL;
     }
 
-    /* Init the structure */
-    memset(new_list, 0, sizeof(kernel_list_t));
+    /* Lists are given back empty to the cache, no need to init the
+     * structure
+     */
 
     if(error != NULL)
     {
@@ -116,7 +137,7 @@ OS_RETURN_E kernel_list_delete_list(kernel_list_t** list)
         return OS_ERR_UNAUTHORIZED_ACTION;
     }
 
-    kfree(*list);
+    kmem_cache_free(&list_cache, *list);
 
     *list = NULL;
 
@@ -324,28 +345,48 @@ OS_RETURN_E kernel_list_remove_node_from(kernel_list_t* list,
         return OS_ERR_NO_SUCH_ID;
     }
 
+    return kernel_list_unlink_node(list, node);
+}
+
+OS_RETURN_E kernel_list_unlink_node(kernel_list_t* list,
+                                    kernel_list_node_t* node)
+{
+    if(list == NULL || node == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    if(node->enlisted == 0 || list->size == 0)
+    {
+        return OS_ERR_NO_SUCH_ID;
+    }
+
+    #ifdef DEBUG_KERNEL_QUEUE
+    kernel_serial_debug("Unlink node kernel node 0x%08x in list 0x%08x\n",
+                        (uint32_t)node,
+                        (uint32_t)list);
+    #endif
+
     /* Manage link */
-    if(cursor->prev != NULL && cursor->next != NULL)
+    if(node->prev != NULL)
     {
-        cursor->prev->next = cursor->next;
-        cursor->next->prev = cursor->prev;
+        node->prev->next = node->next;
     }
-    else if(cursor->prev == NULL && cursor->next != NULL)
+    else
     {
-        list->head = cursor->next;
-        cursor->next->prev = NULL;
+        list->head = node->next;
     }
-    else if(cursor->prev != NULL && cursor->next == NULL)
+    if(node->next != NULL)
     {
-        list->tail = cursor->prev;
-        cursor->prev->next = NULL;
+        node->next->prev = node->prev;
     }
     else
     {
-        list->head = NULL;
-        list->tail = NULL;
+        list->tail = node->prev;
     }
 
+    --list->size;
+
     node->next = NULL;
     node->prev = NULL;
 
@@ -134,5 +134,16 @@ kernel_list_node_t* kernel_list_find_node(kernel_list_t* list, void* data,
 OS_RETURN_E kernel_list_remove_node_from(kernel_list_t* list,
                                          kernel_list_node_t* node);
 
+/* Remove a node from a list given as parameter in constant time. The list is
+ * not searched, the node must be enlisted in this list.
+ *
+ * @param list The list containing the node.
+ * @param node The node to remove.
+ * @returns The function returns OS_NO_ERR on success, see system returns type
+ * for further error description.
+ */
+OS_RETURN_E kernel_list_unlink_node(kernel_list_t* list,
+                                    kernel_list_node_t* node);
+
 
 #endif /* __KERNEL_LIST_H_ */
@@ -0,0 +1,477 @@
+/*******************************************************************************
+ *
+ * File: kernel_rbtree.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel red-black trees. The nodes are embedded in the structures they sort,
+ * the tree never allocates memory. Nodes are sorted by a 64 bits key, nodes of
+ * equal keys are kept in insertion order. The first node is cached.
+ ******************************************************************************/
+
+#include "../lib/stddef.h"  /* OS_RETURN_E */
+#include "../lib/stdint.h"  /* Generic int types */
+
+/* Header include */
+#include "kernel_rbtree.h"
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Tells if a node is black, missing leaves are black.
+ *
+ * @param node The node to check.
+ * @returns 1 if the node is black, 0 otherwise.
+ */
+__inline__ static uint8_t rbtree_is_black(const kernel_rbtree_node_t* node)
+{
+    return (node == NULL || node->color == KERNEL_RBTREE_BLACK);
+}
+
+/* Replace a subtree by an other one in the parent of the first subtree.
+ *
+ * @param tree The tree to manage.
+ * @param old The root of the replaced subtree.
+ * @param new The root of the new subtree, may be NULL.
+ */
+static void rbtree_replace(kernel_rbtree_t* tree,
+                           kernel_rbtree_node_t* old,
+                           kernel_rbtree_node_t* new)
+{
+    if(old->parent == NULL)
+    {
+        tree->root = new;
+    }
+    else if(old == old->parent->left)
+    {
+        old->parent->left = new;
+    }
+    else
+    {
+        old->parent->right = new;
+    }
+
+    if(new != NULL)
+    {
+        new->parent = old->parent;
+    }
+}
+
+/* Rotate a subtree to the left, the right child of the node becomes the root
+ * of the subtree.
+ *
+ * @param tree The tree to manage.
+ * @param node The root of the subtree.
+ */
+static void rbtree_rotate_left(kernel_rbtree_t* tree,
+                               kernel_rbtree_node_t* node)
+{
+    kernel_rbtree_node_t* pivot = node->right;
+
+    node->right = pivot->left;
+    if(pivot->left != NULL)
+    {
+        pivot->left->parent = node;
+    }
+
+    rbtree_replace(tree, node, pivot);
+
+    pivot->left  = node;
+    node->parent = pivot;
+}
+
+/* Rotate a subtree to the right, the left child of the node becomes the root
+ * of the subtree.
+ *
+ * @param tree The tree to manage.
+ * @param node The root of the subtree.
+ */
+static void rbtree_rotate_right(kernel_rbtree_t* tree,
+                                kernel_rbtree_node_t* node)
+{
+    kernel_rbtree_node_t* pivot = node->left;
+
+    node->left = pivot->right;
+    if(pivot->right != NULL)
+    {
+        pivot->right->parent = node;
+    }
+
+    rbtree_replace(tree, node, pivot);
+
+    pivot->right = node;
+    node->parent = pivot;
+}
+
+/* Restore the tree properties after the insertion of a red node.
+ *
+ * @param tree The tree to manage.
+ * @param node The inserted node.
+ */
+static void rbtree_insert_fixup(kernel_rbtree_t* tree,
+                                kernel_rbtree_node_t* node)
+{
+    kernel_rbtree_node_t* parent;
+    kernel_rbtree_node_t* grandparent;
+    kernel_rbtree_node_t* uncle;
+
+    while((parent = node->parent) != NULL &&
+          parent->color == KERNEL_RBTREE_RED)
+    {
+        /* The root is black, a red node has a parent */
+        grandparent = parent->parent;
+
+        if(parent == grandparent->left)
+        {
+            uncle = grandparent->right;
+            if(rbtree_is_black(uncle) == 0)
+            {
+                parent->color      = KERNEL_RBTREE_BLACK;
+                uncle->color       = KERNEL_RBTREE_BLACK;
+                grandparent->color = KERNEL_RBTREE_RED;
+                node               = grandparent;
+                continue;
+            }
+
+            if(node == parent->right)
+            {
+                rbtree_rotate_left(tree, parent);
+                node   = parent;
+                parent = node->parent;
+            }
+
+            parent->color      = KERNEL_RBTREE_BLACK;
+            grandparent->color = KERNEL_RBTREE_RED;
+            rbtree_rotate_right(tree, grandparent);
+        }
+        else
+        {
+            uncle = grandparent->left;
+            if(rbtree_is_black(uncle) == 0)
+            {
+                parent->color      = KERNEL_RBTREE_BLACK;
+                uncle->color       = KERNEL_RBTREE_BLACK;
+                grandparent->color = KERNEL_RBTREE_RED;
+                node               = grandparent;
+                continue;
+            }
+
+            if(node == parent->left)
+            {
+                rbtree_rotate_right(tree, parent);
+                node   = parent;
+                parent = node->parent;
+            }
+
+            parent->color      = KERNEL_RBTREE_BLACK;
+            grandparent->color = KERNEL_RBTREE_RED;
+            rbtree_rotate_left(tree, grandparent);
+        }
+    }
+
+    tree->root->color = KERNEL_RBTREE_BLACK;
+}
+
+/* Restore the tree properties after the removal of a black node.
+ *
+ * @param tree The tree to manage.
+ * @param node The node which replaced the removed node, may be NULL.
+ * @param parent The parent of the replacing node.
+ */
+static void rbtree_remove_fixup(kernel_rbtree_t* tree,
+                                kernel_rbtree_node_t* node,
+                                kernel_rbtree_node_t* parent)
+{
+    kernel_rbtree_node_t* sibling;
+
+    /* The side of the removed black node holds one black node less, its
+     * sibling cannot be a missing leaf.
+     */
+    while(node != tree->root && rbtree_is_black(node) == 1)
+    {
+        if(node == parent->left)
+        {
+            sibling = parent->right;
+            if(sibling->color == KERNEL_RBTREE_RED)
+            {
+                sibling->color = KERNEL_RBTREE_BLACK;
+                parent->color  = KERNEL_RBTREE_RED;
+                rbtree_rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+
+            if(rbtree_is_black(sibling->left) == 1 &&
+               rbtree_is_black(sibling->right) == 1)
+            {
+                sibling->color = KERNEL_RBTREE_RED;
+                node           = parent;
+                parent         = node->parent;
+                continue;
+            }
+
+            if(rbtree_is_black(sibling->right) == 1)
+            {
+                sibling->left->color = KERNEL_RBTREE_BLACK;
+                sibling->color       = KERNEL_RBTREE_RED;
+                rbtree_rotate_right(tree, sibling);
+                sibling = parent->right;
+            }
+
+            sibling->color        = parent->color;
+            parent->color         = KERNEL_RBTREE_BLACK;
+            sibling->right->color = KERNEL_RBTREE_BLACK;
+            rbtree_rotate_left(tree, parent);
+        }
+        else
+        {
+            sibling = parent->left;
+            if(sibling->color == KERNEL_RBTREE_RED)
+            {
+                sibling->color = KERNEL_RBTREE_BLACK;
+                parent->color  = KERNEL_RBTREE_RED;
+                rbtree_rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+
+            if(rbtree_is_black(sibling->left) == 1 &&
+               rbtree_is_black(sibling->right) == 1)
+            {
+                sibling->color = KERNEL_RBTREE_RED;
+                node           = parent;
+                parent         = node->parent;
+                continue;
+            }
+
+            if(rbtree_is_black(sibling->left) == 1)
+            {
+                sibling->right->color = KERNEL_RBTREE_BLACK;
+                sibling->color        = KERNEL_RBTREE_RED;
+                rbtree_rotate_left(tree, sibling);
+                sibling = parent->left;
+            }
+
+            sibling->color       = parent->color;
+            parent->color        = KERNEL_RBTREE_BLACK;
+            sibling->left->color = KERNEL_RBTREE_BLACK;
+            rbtree_rotate_right(tree, parent);
+        }
+
+        node = tree->root;
+    }
+
+    if(node != NULL)
+    {
+        node->color = KERNEL_RBTREE_BLACK;
+    }
+}
+
+OS_RETURN_E kernel_rbtree_init(kernel_rbtree_t* tree)
+{
+    if(tree == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    tree->root  = NULL;
+    tree->first = NULL;
+    tree->size  = 0;
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E kernel_rbtree_insert(kernel_rbtree_t* tree,
+                                 kernel_rbtree_node_t* node,
+                                 const uint64_t key)
+{
+    kernel_rbtree_node_t* parent;
+    kernel_rbtree_node_t* cursor;
+    uint8_t               left;
+    uint8_t               first;
+
+    if(tree == NULL || node == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    if(node->linked != 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    /* Equal keys go right, the insertion order is kept */
+    parent = NULL;
+    cursor = tree->root;
+    left   = 0;
+    first  = 1;
+    while(cursor != NULL)
+    {
+        parent = cursor;
+        if(key < cursor->key)
+        {
+            cursor = cursor->left;
+            left   = 1;
+        }
+        else
+        {
+            cursor = cursor->right;
+            left   = 0;
+            first  = 0;
+        }
+    }
+
+    node->key    = key;
+    node->left   = NULL;
+    node->right  = NULL;
+    node->parent = parent;
+    node->color  = KERNEL_RBTREE_RED;
+    node->linked = 1;
+
+    if(parent == NULL)
+    {
+        tree->root = node;
+    }
+    else if(left == 1)
+    {
+        parent->left = node;
+    }
+    else
+    {
+        parent->right = node;
+    }
+
+    if(first == 1)
+    {
+        tree->first = node;
+    }
+
+    rbtree_insert_fixup(tree, node);
+
+    ++tree->size;
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E kernel_rbtree_remove(kernel_rbtree_t* tree,
+                                 kernel_rbtree_node_t* node)
+{
+    kernel_rbtree_node_t* child;
+    kernel_rbtree_node_t* parent;
+    kernel_rbtree_node_t* successor;
+    uint8_t               removed_color;
+
+    if(tree == NULL || node == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    if(node->linked == 0 || tree->size == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    if(tree->first == node)
+    {
+        tree->first = kernel_rbtree_next(node);
+    }
+
+    removed_color = node->color;
+    if(node->left == NULL)
+    {
+        child  = node->right;
+        parent = node->parent;
+        rbtree_replace(tree, node, child);
+    }
+    else if(node->right == NULL)
+    {
+        child  = node->left;
+        parent = node->parent;
+        rbtree_replace(tree, node, child);
+    }
+    else
+    {
+        /* The successor takes the place and the color of the node */
+        successor = node->right;
+        while(successor->left != NULL)
+        {
+            successor = successor->left;
+        }
+
+        removed_color = successor->color;
+        child         = successor->right;
+
+        if(successor->parent == node)
+        {
+            parent = successor;
+        }
+        else
+        {
+            parent = successor->parent;
+            rbtree_replace(tree, successor, child);
+            successor->right         = node->right;
+            successor->right->parent = successor;
+        }
+
+        rbtree_replace(tree, node, successor);
+        successor->left         = node->left;
+        successor->left->parent = successor;
+        successor->color        = node->color;
+    }
+
+    if(removed_color == KERNEL_RBTREE_BLACK)
+    {
+        rbtree_remove_fixup(tree, child, parent);
+    }
+
+    node->left   = NULL;
+    node->right  = NULL;
+    node->parent = NULL;
+    node->linked = 0;
+
+    --tree->size;
+
+    return OS_NO_ERR;
+}
+
+kernel_rbtree_node_t* kernel_rbtree_first(const kernel_rbtree_t* tree)
+{
+    if(tree == NULL)
+    {
+        return NULL;
+    }
+
+    return tree->first;
+}
+
+kernel_rbtree_node_t* kernel_rbtree_next(const kernel_rbtree_node_t* node)
+{
+    kernel_rbtree_node_t* cursor;
+
+    if(node == NULL)
+    {
+        return NULL;
+    }
+
+    /* Lowest node of the right subtree */
+    if(node->right != NULL)
+    {
+        cursor = node->right;
+        while(cursor->left != NULL)
+        {
+            cursor = cursor->left;
+        }
+        return cursor;
+    }
+
+    /* First ancestor the node is on the left of */
+    while(node->parent != NULL && node == node->parent->right)
+    {
+        node = node->parent;
+    }
+
+    return node->parent;
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ *
+ * File: kernel_rbtree.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel red-black trees. The nodes are embedded in the structures they sort,
+ * the tree never allocates memory. Nodes are sorted by a 64 bits key, nodes of
+ * equal keys are kept in insertion order. The first node is cached.
+ ******************************************************************************/
+
+#ifndef __KERNEL_RBTREE_H_
+#define __KERNEL_RBTREE_H_
+
+#include "../lib/stddef.h" /* OS_RETURN_E */
+#include "../lib/stdint.h" /* Generic int types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Nodes colors */
+#define KERNEL_RBTREE_RED   0
+#define KERNEL_RBTREE_BLACK 1
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Tree node structure */
+typedef struct kernel_rbtree_node
+{
+    struct kernel_rbtree_node* left;   /* Left child */
+    struct kernel_rbtree_node* right;  /* Right child */
+    struct kernel_rbtree_node* parent; /* Parent, NULL for the root */
+
+    uint64_t key;     /* Sorting key of the node */
+
+    uint8_t  color;   /* Color of the node */
+    uint8_t  linked;  /* Is the node in a tree */
+
+    void*    data;    /* Data contained by the node */
+} kernel_rbtree_node_t;
+
+/* Tree structure */
+typedef struct kernel_rbtree
+{
+    struct kernel_rbtree_node* root;  /* Root of the tree */
+    struct kernel_rbtree_node* first; /* Node of the lowest key */
+
+    uint32_t size;                    /* Tree size */
+} kernel_rbtree_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Initialize an empty tree.
+ *
+ * @param tree The tree to initialize.
+ * @returns The function returns OS_NO_ERR on success, see system returns type
+ * for further error description.
+ */
+OS_RETURN_E kernel_rbtree_init(kernel_rbtree_t* tree);
+
+/* Insert a node in the tree given as parameter. A node inserted with the key
+ * of nodes already in the tree is placed after them.
+ *
+ * WARNING A node should be only used in ONE tree at most !!!
+ *
+ * @param tree The tree to manage.
+ * @param node The node to insert, its data must be set.
+ * @param key The sorting key of the node.
+ * @returns The function returns OS_NO_ERR on success, see system returns type
+ * for further error description.
+ */
+OS_RETURN_E kernel_rbtree_insert(kernel_rbtree_t* tree,
+                                 kernel_rbtree_node_t* node,
+                                 const uint64_t key);
+
+/* Remove a node from the tree given as parameter. The node must be in this
+ * tree.
+ *
+ * @param tree The tree containing the node.
+ * @param node The node to remove.
+ * @returns The function returns OS_NO_ERR on success, see system returns type
+ * for further error description.
+ */
+OS_RETURN_E kernel_rbtree_remove(kernel_rbtree_t* tree,
+                                 kernel_rbtree_node_t* node);
+
+/* Returns the node of the lowest key of a tree in constant time.
+ *
+ * @param tree The tree to manage.
+ * @returns The first node, NULL if the tree is empty.
+ */
+kernel_rbtree_node_t* kernel_rbtree_first(const kernel_rbtree_t* tree);
+
+/* Returns the node following a node in its tree order.
+ *
+ * @param node The node to get the successor of.
+ * @returns The next node, NULL if the node is the last one.
+ */
+kernel_rbtree_node_t* kernel_rbtree_next(const kernel_rbtree_node_t* node);
+
+#endif /* __KERNEL_RBTREE_H_ */
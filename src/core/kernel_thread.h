@@ -15,11 +15,17 @@
 #define __KERNEL_THREAD_H_
 
 #include "../lib/stdint.h"       /* Generic int types */
+#include "../lib/stddef.h"       /* OS_RETURN_E */
 #include "../cpu/cpu_settings.h" /* KERNEL_CS KERNEL_DS */
+#include "../cpu/cpu_local.h"    /* SEGMENT_LOCAL_READ, SEGMENT_LOCAL_WRITE */
+#include "../cpu/fpu.h"          /* fpu_context_t */
+#include "../memory/stack_pool.h" /* kernel_stack_t */
 #include "kernel_list.h"
+#include "kernel_rbtree.h"
 
 /* Forward declaration */
 struct thread_queue;
+struct mutex;
 
 /*******************************************************************************
  * CONSTANTS
@@ -27,7 +33,8 @@ struct thread_queue;
 
 /* Thread settings */
 #define THREAD_MAX_NAME_LENGTH  32
-#define THREAD_STACK_SIZE       2048 /* 64 KB */
+/* Default thread stack size in bytes, see stack_pool.h for the limits */
+#define THREAD_STACK_SIZE       8192
 
 /* Thread init values */
 #define THREAD_INIT_EFLAGS 0x202 // INT | PARITY
@@ -41,8 +48,8 @@ struct thread_queue;
 #define THREAD_INIT_SS     KERNEL_DS
 #define THREAD_INIT_DS     KERNEL_DS
 #define THREAD_INIT_ES     KERNEL_DS
-#define THREAD_INIT_FS     KERNEL_DS
-#define THREAD_INIT_GS     KERNEL_DS
+#define THREAD_INIT_FS     KERNEL_TLS_SEGMENT
+#define THREAD_INIT_GS     KERNEL_CPU_LOCAL_SEGMENT
 
 /*******************************************************************************
  * STRUCTURES
@@ -66,9 +73,32 @@ typedef enum BLOCK_TYPE
     SEM,
     MUTEX,
     QUEUE,
-    IO_KEYBOARD
+    IO_KEYBOARD,
+    FUTEX
 } BLOCK_TYPE_E;
 
+/* Scheduling policies */
+typedef enum SCHED_POLICY
+{
+    SCHED_POLICY_PRIORITY,
+    SCHED_POLICY_FAIR
+} SCHED_POLICY_E;
+
+/* Thread local storage block, pointed by FS while the thread executes. The
+ * fields must be 32 bits wide.
+ */
+typedef struct thread_tls
+{
+    /* Linear address of the block */
+    struct thread_tls*    self;
+
+    /* Thread owning the block */
+    struct kernel_thread* thread;
+
+    /* Last error reported to the thread, see get_last_error */
+    OS_RETURN_E           last_error;
+} thread_tls_t;
+
 /* Kernel thread structure */
 typedef struct kernel_thread
 {
@@ -86,29 +116,122 @@ typedef struct kernel_thread
 
     THREAD_STATE_E   state;
 
+    /* CPU executing the thread, -1 when the thread is not executed */
+    volatile int32_t cpu_id;
+
+    /* CPU run queue the thread belongs to */
+    volatile uint32_t rq_cpu;
+
+    /* CPUs allowed to execute the thread, bit n for the CPU n. When migrating,
+     * next thread migrating to the same CPU and CPU still switching from the
+     * thread, -1 if none.
+     */
+    volatile uint32_t     affinity;
+    struct kernel_thread* migrate_next;
+    int32_t               migrate_from;
+
     /* Thread specific registers */
     uint32_t         esp;
     uint32_t         ebp;
     uint32_t         eip;
 
-    /* Thread kernel stack */
-    uint32_t         kernel_stack[THREAD_STACK_SIZE];
+    /* Thread kernel stack, allocated from the stacks pool */
+    kernel_stack_t   kernel_stack;
+
+    /* Thread local storage block */
+    thread_tls_t     tls;
+
+    /* Thread FPU / SSE state, switched lazily */
+    fpu_context_t    fpu;
 
     /* Wake up time for the sleeping thread */
     uint32_t         wakeup_time;
 
+    /* High resolution wake up time (monotonic ns), 0 when the thread sleeps
+     * in the sleep wheel, and next high resolution sleeping thread of the CPU
+     */
+    uint64_t              wakeup_ns;
+    struct kernel_thread* hr_next;
+
     /* Thread block management */
     BLOCK_TYPE_E     block_type;
     uint32_t         io_req_time;
 
+    /* Address the thread waits on when blocked on a futex */
+    volatile uint32_t* futex_addr;
+
     /* Thread pointer that is joining the thread */
     kernel_list_node_t* joining_thread;
 
     /* Thread's children */
     kernel_list_t* children;
 
-    /* Statistics (scheduler) */
-    uint32_t         last_sched;
+    /* Thread's parent, NULL for the IDLE threads */
+    struct kernel_thread* parent;
+
+    /* Thread nodes in the threads tables, the thread is removed from the
+     * tables in constant time. The scheduling node is kept in the run queues,
+     * the sleep wheel, the waiting lists and the zombie table.
+     */
+    kernel_list_node_t* sched_node;
+    kernel_list_node_t* global_node;
+    kernel_list_node_t* child_node;
+
+    /* Priority inheritance: priority inherited from the threads waiting for
+     * the mutexes held by the thread, priority inheritance mutexes held by the
+     * thread and mutex the thread is waiting for.
+     */
+    uint32_t         inherited_prio;
+    struct mutex*    held_mutexes;
+    struct mutex*    blocked_mutex;
+
+    /* Scheduling policy. Fair threads are sorted by virtual runtime (executed
+     * time in ns scaled by their weight) in the fair tree of their CPU, the
+     * time they got the CPU is 0 when they are not executing.
+     */
+    SCHED_POLICY_E        policy;
+    uint64_t              vruntime;
+    uint64_t              fair_exec_start;
+    kernel_rbtree_node_t  fair_node;
+
+    /* Deadline scheduling class: runtime, relative deadline and period in ns,
+     * the period is 0 for the priority scheduled threads. Bandwidth and CPU
+     * reserved at admission, affinity to restore when leaving the class.
+     */
+    uint32_t              dl_runtime;
+    uint32_t              dl_deadline;
+    uint32_t              dl_period;
+    uint32_t              dl_bw;
+    uint32_t              dl_cpu;
+    uint32_t              dl_saved_affinity;
+
+    /* Current period absolute deadline and end (monotonic ns), runtime left
+     * in the period, time the thread got the CPU (0 when not executing) and
+     * next deadline thread of the CPU lists.
+     */
+    uint64_t              dl_abs_deadline;
+    uint64_t              dl_next_period;
+    int64_t               dl_budget;
+    uint64_t              dl_exec_start;
+    struct kernel_thread* dl_next;
+
+    /* Statistics (scheduler), run queue epoch when the thread was enqueued */
+    uint32_t         rq_epoch;
+
+    /* Statistics (scheduler), measured at each switch: executed time and time
+     * waited ready in the run queues in ns, time the thread got the CPU (0
+     * when not executing) and got ready, switches the thread asked for and
+     * preemptions. The slice starts when the thread gets the CPU from an
+     * other thread, woken is set when the ready wait follows a wake up.
+     */
+    uint64_t         cpu_time;
+    uint64_t         ready_time;
+    uint64_t         run_since;
+    uint64_t         ready_since;
+    uint64_t         slice_start;
+    uint8_t          woken;
+    uint32_t         voluntary_switches;
+    uint32_t         involuntary_switches;
 
     /* Statistics */
     uint32_t start_time;
@@ -116,6 +239,17 @@ typedef struct kernel_thread
     uint32_t exec_time;
 } kernel_thread_t;
 
+/*******************************************************************************
+ * MACROS
+ ******************************************************************************/
+
+/* Access the thread local storage block of the current thread. The scheduler
+ * must have been started on the CPU.
+ */
+#define THREAD_LOCAL_READ(field) SEGMENT_LOCAL_READ(fs, thread_tls_t, field)
+#define THREAD_LOCAL_WRITE(field, val) \
+    SEGMENT_LOCAL_WRITE(fs, thread_tls_t, field, val)
+
 typedef kernel_thread_t* thread_t;
 
 /*******************************************************************************
@@ -14,18 +14,30 @@
 
 #include "../lib/stdint.h"      /* Generic int types */
 #include "../lib/stddef.h"      /* OS_RETURN_E, OS_EVENT_ID */
-#include "../lib/string.h"      /* strncpy */
-#include "../memory/heap.h"     /* kmalloc, kfree */
-#include "../cpu/cpu.h"         /* sti, hlt */
+#include "../lib/string.h"      /* strncpy, memcpy, memset */
+#include "../memory/slab.h"     /* kmem_cache_alloc, kmem_cache_free */
+#include "../memory/stack_pool.h" /* stack_pool_alloc, stack_pool_free */
+#include "../memory/paging.h"   /* kernel_tlb_sync */
+#include "../cpu/cpu.h"         /* hlt, cpu_test_and_set, cpu_udiv_64_32,
+                                 cpu_bsr */
+#include "../cpu/smp.h"         /* get_cpu_id, MAX_CPU_COUNT */
+#include "../cpu/cpu_local.h"   /* CPU_LOCAL_READ, CPU_LOCAL_WRITE */
+#include "../cpu/fpu.h"         /* fpu_context_init, fpu_switch */
 #include "../sync/lock.h"       /* spinlock */
 #include "../drivers/graphic.h" /* colorsheme */
 #include "../drivers/vesa.h"    /* vesa_enable_double_buffering */
+#include "../drivers/tsc.h"     /* get_monotonic_ns */
 #include "interrupts.h"         /* register_interrupt_handler,
                                  set_IRQ_EOI, update_tick */
 #include "kernel_output.h"      /* kernel_success, kernel_error */
 #include "kernel_list.h"        /* kernel_list_t, kernel_list_node_t */
+#include "kernel_rbtree.h"      /* kernel_rbtree_insert, kernel_rbtree_remove */
 
 #include "panic.h"              /* kernel_panic */
+#include "workqueue.h"          /* init_workqueues, stop_workqueues */
+#include "thread_pool.h"        /* init_thread_pool, stop_thread_pool */
+
+#include "../tests/core/tests.h" /* test_bank */
 
 #include "../debug.h"           /* DEBUG */
 
@@ -43,19 +55,53 @@ static uint32_t sched_hw_int_line;
 /* Threads management */
 static volatile uint32_t last_given_pid;
 static volatile uint32_t thread_count;
-static volatile uint32_t first_schedule;
+static volatile uint32_t idle_thread_count;
+static volatile uint32_t first_schedule[MAX_CPU_COUNT];
+
+/* Stack pointer of the CPUs boot context, never resumed */
+static uint32_t          boot_esp[MAX_CPU_COUNT];
+static uint32_t          balance_tick[MAX_CPU_COUNT];
+
+/* Set when the CPU is idle and its scheduler ticks are stopped */
+static volatile uint8_t  tickless[MAX_CPU_COUNT];
+
+/* High resolution sleeping threads of each CPU, sorted by wake up time, and
+ * set when the CPU timer is programmed for the first of them. Protected by the
+ * CPU run queue lock.
+ */
+static kernel_thread_t*  hr_sleepers[MAX_CPU_COUNT];
+static volatile uint8_t  hr_armed[MAX_CPU_COUNT];
+
+/* Bandwidth reserved by the deadline threads of each CPU, protected by the
+ * sched_lock
+ */
+static uint32_t          dl_bandwidth[MAX_CPU_COUNT];
+
+/* Scheduler histograms of each CPU, protected by the CPU run queue lock */
+static sched_stats_t     sched_stats[MAX_CPU_COUNT];
 
-/* Kernel thread */
-static kernel_thread_t*    idle_thread;
-static kernel_list_node_t* idle_thread_node;
+/* Kernel threads, one IDLE thread per CPU */
+static kernel_thread_t*    idle_thread[MAX_CPU_COUNT];
+static kernel_list_node_t* idle_thread_node[MAX_CPU_COUNT];
 static kernel_thread_t*    init_thread;
 static kernel_list_node_t* init_thread_node;
 
-/* Active thread */
-static kernel_thread_t*    active_thread;
-static kernel_list_node_t* active_thread_node;
-static kernel_thread_t*    old_thread;
-static kernel_list_node_t* old_thread_node;
+/* Active thread of each CPU */
+static kernel_thread_t*    active_thread[MAX_CPU_COUNT];
+static kernel_list_node_t* active_thread_node[MAX_CPU_COUNT];
+static kernel_thread_t*    old_thread[MAX_CPU_COUNT];
+static kernel_list_node_t* old_thread_node[MAX_CPU_COUNT];
+
+/* Scheduler locks. Lock order is sched_lock, run queue lock, sleep_lock,
+ * migrate_lock, tick_lock. sched_lock protects the global, zombie and children
+ * tables. The threads states are protected by the lock of their run queue.
+ * migrate_lock protects the incoming threads lists.
+ */
+static volatile uint32_t sched_lock;
+static volatile uint32_t sleep_lock;
+static volatile uint32_t migrate_lock;
+static volatile uint32_t tick_lock;
+static volatile uint8_t  scheduler_started;
 
 /* System state */
 static volatile SYSTEM_STATE_E system_state;
@@ -63,17 +109,27 @@ static volatile SYSTEM_STATE_E system_state;
 /*******************************************************
  * THREAD TABLES
  * Sorted by priority:
- *     - active_thread: thread priority
- *     - sleeping_threads: thread wakeup time
+ *     - runqueues: one run queue per CPU, see cpu_runqueue_t
+ *     - sleep_wheel: hierarchical timing wheel of the sleeping
+ *       threads, see sleep_wheel_insert
  *
  * Global thread table used to browse the threads, even those
  * kept in a nutex / semaphore or other structure and that do
  * not appear in the three previous tables.
  *
  *******************************************************/
-static kernel_list_t* active_threads_table;
+static cpu_runqueue_t runqueues[MAX_CPU_COUNT];
 static kernel_list_t* zombie_threads_table;
-static kernel_list_t* sleeping_threads_table;
+static kernel_list_t* sleep_wheel[SLEEP_WHEEL_LEVELS][SLEEP_WHEEL_SIZE];
+
+/* Ready threads moved to a CPU they are allowed on, the CPU enqueues them at
+ * its next schedule
+ */
+static kernel_thread_t* rq_incoming[MAX_CPU_COUNT];
+
+/* Next millisecond to expire in the sleep wheel and sleeping threads count */
+static uint32_t       sleep_wheel_time;
+static uint32_t       sleeping_count;
 static kernel_list_t* global_threads_table;
 
 /*******************************************************************************
@@ -83,745 +139,2730 @@ static kernel_list_t* global_threads_table;
 /* Extern user programm entry point */
 extern int main(int, char**);
 
-/* INIT thread routine. In addition to the IDLE thread, the INIT thread is the
- * last thread to run. The thread will gather all orphan thread and wait for
- * their death before halting the system. The INIT thread routine is also
- * responsible for calling the main function.
+/* Context switch, see context_switch.S */
+extern void switch_to(uint32_t* prev_esp, uint32_t next_esp,
+                      volatile uint32_t* lock);
+
+/* Interrupted context restore, see int_handlers.S */
+extern void interrupt_return(void);
+
+/* Threads entry point */
+static void thread_wrapper(void);
+static void sched_tick_kick(const uint32_t cpu_id);
+
+/* Fair threads weights, from the highest priority to the lowest. A level gets
+ * about 1.25 times the CPU share of the next one.
+ */
+static const uint32_t fair_weights[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,   335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,    36,    29,    23,    18,    15
+};
+
+/* Threads structures cache */
+static kmem_cache_t thread_cache = KMEM_CACHE_INIT("kernel_thread",
+                                                   sizeof(kernel_thread_t),
+                                                   NULL, NULL);
+
+/* Acquire a scheduler lock. Local interrupts must be disabled.
  *
- * @param args The argument to send to the INIT thread, usualy null.
- * @return NULL always
+ * @param lock The lock to acquire.
  */
-static void* init_func(void* args)
+__inline__ static void raw_lock(volatile uint32_t* lock)
 {
-    OS_RETURN_E         err;
-    kernel_list_node_t* thread_node;
-    kernel_thread_t*    thread;
-    char*               argv[2] = {"main", NULL};
-
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("INIT Started\n");
-    #endif
-
-    (void)args;
+    while(cpu_test_and_set(lock) == 1);
+}
 
-    /* Call main */
-    main(1, argv);
+/* Try to acquire a scheduler lock. Local interrupts must be disabled.
+ *
+ * @param lock The lock to acquire.
+ * @returns 1 if the lock was acquired, 0 otherwise.
+ */
+__inline__ static uint8_t raw_trylock(volatile uint32_t* lock)
+{
+    return (cpu_test_and_set(lock) == 0);
+}
 
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("Main returned, INIT waiting for children\n");
-    #endif
+/* Release a scheduler lock.
+ *
+ * @param lock The lock to release.
+ */
+__inline__ static void raw_unlock(volatile uint32_t* lock)
+{
+    __asm__ __volatile__("movl $0, %0" : "=m"(*lock) : : "memory");
+}
 
-    disable_local_interrupt();
+/* Lock the run queue of the thread given as parameter. The thread might be
+ * moved to an other run queue while we wait for the lock, in which case the
+ * function tries again with the new run queue.
+ *
+ * @param thread The thread to lock the run queue of.
+ * @returns The id of the CPU which run queue has been locked.
+ */
+static uint32_t thread_lock_rq(kernel_thread_t* thread)
+{
+    uint32_t cpu_id;
 
-    /* Wait all children */
-    while(thread_count > 2)
+    while(1 < 2)
     {
-        thread_node = kernel_list_delist_data(active_thread->children, &err);
-        while(thread_node != NULL && err == OS_NO_ERR)
+        cpu_id = thread->rq_cpu;
+        raw_lock(&runqueues[cpu_id].lock);
+        if(thread->rq_cpu == cpu_id)
         {
-            enable_local_interrupt();
-
-            thread = (kernel_thread_t*)thread_node->data;
-
-            err = wait_thread(thread, NULL);
-            if(err != OS_NO_ERR)
-            {
-                kernel_error("Error while waiting thread in INIT [%d]\n", err);
-                kernel_panic();
-            }
-
-            err = kernel_list_delete_node(&thread_node);
-            if(err != OS_NO_ERR)
-            {
-                kernel_error("Error while deleting thread node in INIT [%d]\n", err);
-                kernel_panic();
-            }
-
-            disable_local_interrupt();
-
-            thread_node = kernel_list_delist_data(active_thread->children, &err);
+            return cpu_id;
         }
+        raw_unlock(&runqueues[cpu_id].lock);
     }
-    enable_local_interrupt();
+}
 
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("INIT Ended\n");
-    #endif
+/* Clear a thread structure taken from the threads cache. The thread starts
+ * with a clean FPU state, an empty local storage block and without stack.
+ *
+ * @param thread The thread to clear.
+ */
+static void thread_clear(kernel_thread_t* thread)
+{
+    memset(thread, 0, sizeof(kernel_thread_t));
 
-    /* If here, the system is halted */
-    system_state = HALTED;
+    fpu_context_init(&thread->fpu);
 
-    return NULL;
+    thread->tls.self   = &thread->tls;
+    thread->tls.thread = thread;
 }
 
-/* IDLE thread routine. This thread should always be ready, it is the only
- * threa running when no other trhread are ready. It allows better power
- * consumption management. The IDLE thread launches the INIT thread before
- * idling forever.
+/* Set the thread given as parameter as the current thread of the CPU local
+ * area and load its local storage block. The interrupts must be disabled.
  *
- * @param args The argument to send to the IDLE thread, usualy null.
- * @return NULL always, should never return.
+ * @param thread The thread executed by the CPU.
  */
-static void* idle_sys(void* args)
+__inline__ static void thread_set_local(kernel_thread_t* thread)
 {
-    OS_RETURN_E   err;
-    colorscheme_t buffer;
-    colorscheme_t new_scheme;
-    int8_t        notify = 0;
+    CPU_LOCAL_WRITE(current_thread, thread);
+    cpu_set_tls((uint32_t)&thread->tls, sizeof(thread_tls_t));
+}
 
+kernel_thread_t* get_current_thread(void)
+{
+    /* A single read, the thread stays the same if it migrates right after */
+    return CPU_LOCAL_READ(current_thread);
+}
 
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("IDLE Started\n");
-    #endif
+OS_RETURN_E get_last_error(void)
+{
+    if(CPU_LOCAL_READ(current_thread) == NULL)
+    {
+        return OS_NO_ERR;
+    }
 
-    kernel_printf("\nWelcome to ");
+    return THREAD_LOCAL_READ(last_error);
+}
 
-    new_scheme.foreground = FG_CYAN;
-    new_scheme.background = BG_BLACK;
-    new_scheme.vga_color  = 1;
+void set_last_error(const OS_RETURN_E error)
+{
+    /* FS only covers a thread local storage once the scheduler started */
+    if(CPU_LOCAL_READ(current_thread) != NULL)
+    {
+        THREAD_LOCAL_WRITE(last_error, error);
+    }
+}
 
-    /* No need to test return value */
-    save_color_scheme(&buffer);
+/* Tells if the thread given as parameter is the IDLE thread of a CPU.
+ *
+ * @param thread The thread to check.
+ * @returns 1 if the thread is an IDLE thread, 0 otherwise.
+ */
+static uint8_t is_idle_thread(const kernel_thread_t* thread)
+{
+    uint32_t i;
 
-    /* Set REG on BLACK color scheme */
-    set_color_scheme(new_scheme);
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        if(idle_thread[i] == thread)
+        {
+            return 1;
+        }
+    }
 
-    /* Print tag */
-    kernel_printf("AWK\n\n");
+    return 0;
+}
 
-    /* Restore original screen color scheme */
-    set_color_scheme(buffer);
+/* Returns the mask of the CPUs running in the system.
+ *
+ * @returns The running CPUs mask.
+ */
+static uint32_t sched_cpu_mask(void)
+{
+    uint32_t count = get_booted_cpu_count();
 
-    /* We create the init thread */
-    err = create_thread(&init_thread, init_func,
-                        KERNEL_HIGHEST_PRIORITY, "init", args);
-    if(err != OS_NO_ERR)
+    if(count == 0)
     {
-        kernel_error("Error while creating INIT thread [%d]\n", err);
-        kernel_panic();
+        return THREAD_AFFINITY_CPU(0);
+    }
+    if(count >= 32)
+    {
+        return THREAD_AFFINITY_ALL;
     }
 
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("INIT Created\n");
-    #endif
+    return THREAD_AFFINITY_CPU(count) - 1;
+}
 
+/* Returns the online CPU which run queue is the shortest among the CPUs given
+ * as parameter. If none of them schedules threads yet, the first running one is
+ * returned, it will execute its run queue once started.
+ *
+ * @param affinity The mask of the CPUs to choose from.
+ * @returns The id of the least loaded CPU.
+ */
+static uint32_t rq_find_idlest(const uint32_t affinity)
+{
+    uint32_t i;
+    uint32_t idlest = MAX_CPU_COUNT;
 
-    /* Halt forever, hlt for energy consumption */
-    while(1 < 2)
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
     {
-        enable_local_interrupt();
-        if(system_state == HALTED && notify == 0)
+        if(idle_thread[i] != NULL && (affinity & THREAD_AFFINITY_CPU(i)) != 0 &&
+           (idlest == MAX_CPU_COUNT ||
+            runqueues[i].length < runqueues[idlest].length))
         {
-            notify = 1;
-            kernel_info("System HALTED");
-            disable_local_interrupt();
+            idlest = i;
         }
-        hlt();
     }
 
-    /* If we return better go away and cry in a corner */
-    return NULL;
+    if(idlest == MAX_CPU_COUNT)
+    {
+        idlest = cpu_bsf(affinity & sched_cpu_mask());
+    }
+
+    return idlest;
 }
 
-/* Exit point of a thread. The function will release the resources of the thread
- * and manage its children (INIT will inherit them). Put the thread in a ZOMBIE
- * state. If an other thread is already joining the active thread, then the
- * joining thread will switch from blocked to ready state.
+/* Move a ready thread which is not in any run queue to the least loaded CPU
+ * of its affinity mask. The thread joins the CPU incoming list, the CPU
+ * enqueues it at its next schedule.
+ *
+ * @param thread The thread to move.
+ * @param from_cpu The CPU still executing the thread, its run queue lock is
+ * held until it switched to an other thread. -1 if the thread is not
+ * executed.
  */
-static void thread_exit(void)
+static void rq_migrate(kernel_thread_t* thread, const int32_t from_cpu)
 {
-    OS_RETURN_E      err;
-    kernel_thread_t*    thread;
-    kernel_thread_t*    joining_thread = NULL;
-    kernel_list_node_t* node;
+    uint32_t target_cpu;
 
-    disable_local_interrupt();
+    target_cpu = rq_find_idlest(thread->affinity);
+
+    /* The thread is not in a run queue, the target CPU run queue lock protects
+     * it from now on
+     */
+    raw_lock(&migrate_lock);
+    thread->rq_cpu          = target_cpu;
+    thread->migrate_from    = from_cpu;
+    thread->migrate_next    = rq_incoming[target_cpu];
+    rq_incoming[target_cpu] = thread;
+    raw_unlock(&migrate_lock);
+
+    sched_tick_kick(target_cpu);
 
     #ifdef DEBUG_SCHED
-    kernel_serial_debug("Exit thread %d\n", active_thread->pid);
+    kernel_serial_debug("Thread %d migrates to CPU %d\n", thread->pid,
+                        target_cpu);
     #endif
+}
 
-    if(active_thread == init_thread)
-    {
-        active_thread->state = ZOMBIE;
-        enable_local_interrupt();
-
-        /* Schedule thread, should never return since the state is zombie */
-        schedule();
+/* Insert a deadline thread in a CPU deadline list. The ready list is sorted by
+ * absolute deadline, the throttled list by period end. The CPU run queue lock
+ * must be held.
+ *
+ * @param list The list to insert the thread in.
+ * @param thread The thread to insert.
+ * @param throttled Set to 1 for the throttled list.
+ */
+static void dl_list_insert(kernel_thread_t** list, kernel_thread_t* thread,
+                           const uint8_t throttled)
+{
+    kernel_thread_t** cursor;
+    uint64_t          key;
 
-        return;
-    }
+    key = (throttled == 1) ? thread->dl_next_period : thread->dl_abs_deadline;
 
-    if(active_thread->joining_thread != NULL)
+    cursor = list;
+    while(*cursor != NULL &&
+          ((throttled == 1) ? (*cursor)->dl_next_period :
+                              (*cursor)->dl_abs_deadline) <= key)
     {
-        joining_thread = (kernel_thread_t*)active_thread->joining_thread->data;
+        cursor = &(*cursor)->dl_next;
     }
 
-    if(joining_thread != NULL && joining_thread->state == JOINING)
-    {
-        #ifdef DEBUG_SCHED
-        kernel_serial_debug("Woke up joining thread %d\n",
-            joining_thread->pid);
-        #endif
-        joining_thread->state = READY;
+    thread->dl_next = *cursor;
+    *cursor         = thread;
+}
 
-        err = kernel_list_enlist_data(active_thread->joining_thread,
-                                      active_threads_table,
-                                      joining_thread->priority);
-        if(err != OS_NO_ERR)
+/* Remove a thread from a CPU deadline list. The CPU run queue lock must be
+ * held.
+ *
+ * @param list The list to remove the thread from.
+ * @param thread The thread to remove.
+ * @returns 1 if the thread was in the list, 0 otherwise.
+ */
+static uint8_t dl_list_remove(kernel_thread_t** list, kernel_thread_t* thread)
+{
+    kernel_thread_t** cursor;
+
+    for(cursor = list; *cursor != NULL; cursor = &(*cursor)->dl_next)
+    {
+        if(*cursor == thread)
         {
-            kernel_error("Could not enqueue joining thread[%d]\n", err);
-            kernel_panic();
+            *cursor         = thread->dl_next;
+            thread->dl_next = NULL;
+            return 1;
         }
     }
 
-    /* Set new thread state */
-    active_thread->state = ZOMBIE;
+    return 0;
+}
 
-    err = kernel_list_enlist_data(active_thread_node, zombie_threads_table, 0);
-    if(err != OS_NO_ERR)
-    {
-        kernel_error("Could not enqueue zombie thread[%d]\n", err);
-        kernel_panic();
-    }
+/* Start a new period of a deadline thread, the thread gets its full runtime.
+ *
+ * @param thread The deadline thread.
+ * @param start The period start time.
+ */
+static void dl_new_period(kernel_thread_t* thread, const uint64_t start)
+{
+    thread->dl_abs_deadline = start + thread->dl_deadline;
+    thread->dl_next_period  = start + thread->dl_period;
+    thread->dl_budget       = thread->dl_runtime;
+}
 
-    /* All the children of the thread are inherited by init */
-    node = kernel_list_delist_data(active_thread->children, &err);
-    while(node != NULL && err == OS_NO_ERR)
-    {
-        thread = (kernel_thread_t*)node->data;
-        thread->ppid = init_thread->pid;
+/* Add a deadline thread to a CPU. A thread which consumed its runtime is
+ * throttled until its period ends. A woken up thread which remaining runtime
+ * cannot be consumed before its deadline without exceeding its bandwidth
+ * starts a new period, it cannot delay the other deadline threads. The CPU run
+ * queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @param thread The deadline thread.
+ * @param wakeup Set to 1 if the thread was not executing.
+ */
+static void dl_enqueue(const uint32_t cpu_id, kernel_thread_t* thread,
+                       const uint8_t wakeup)
+{
+    cpu_runqueue_t* rq  = &runqueues[cpu_id];
+    uint64_t        now = get_monotonic_ns();
 
-        if(thread->joining_thread->data == active_thread)
-        {
-            thread->joining_thread->data = NULL;
-        }
+    thread->rq_cpu = cpu_id;
 
-        err = kernel_list_enlist_data(node, init_thread->children, 0);
-        if(err != OS_NO_ERR)
+    if(thread->dl_budget <= 0)
+    {
+        if(now < thread->dl_next_period)
         {
-            kernel_error("Could not enqueue thread to init[%d]\n", err);
-            kernel_panic();
+            dl_list_insert(&rq->dl_throttled, thread, 1);
+            return;
         }
-
-        node = kernel_list_delist_data(active_thread->children, &err);
-    }
-    if(err != OS_NO_ERR)
-    {
-        kernel_error("Could not dequeue thread from children[%d]\n", err);
-        kernel_panic();
+        dl_new_period(thread, now);
     }
-
-    /* Delete lsit */
-    err = kernel_list_delete_list(&active_thread->children);
-    if(err != OS_NO_ERR)
+    else if(wakeup == 1 &&
+            (now >= thread->dl_abs_deadline ||
+             (uint64_t)thread->dl_budget * thread->dl_period >
+             (thread->dl_abs_deadline - now) * thread->dl_runtime))
     {
-        kernel_error("Could not delete lsit of children[%d]\n", err);
-        kernel_panic();
+        dl_new_period(thread, now);
     }
 
-    enable_local_interrupt();
-
-    /* Schedule thread */
-    schedule();
+    dl_list_insert(&rq->dl_ready, thread, 0);
+    ++rq->length;
 }
 
-/* Thread launch routine. Wrapper for the actual thread routine. The wrapper
- * will call the thread routine, pass its arguments and gather the return value
- * of the thread function to allow the joining thread to retreive it.
- * Some statistics about the thread might be added in this function.
+/* Remove the earliest deadline ready thread of a CPU. The CPU run queue lock
+ * must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @returns The node of the thread, NULL if no deadline thread is ready.
  */
-static void thread_wrapper(void)
+static kernel_list_node_t* dl_dequeue(const uint32_t cpu_id)
 {
-    /* STAT PROBE OR SOMETHING */
-    active_thread->start_time = get_current_uptime();
+    cpu_runqueue_t*  rq = &runqueues[cpu_id];
+    kernel_thread_t* thread;
 
-    if(active_thread->function == NULL)
+    thread = rq->dl_ready;
+    if(thread == NULL)
     {
-        kernel_error("Thread routine cannot be NULL\n");
-        kernel_panic();
+        return NULL;
     }
-    active_thread->ret_val = active_thread->function(active_thread->args);
 
-    active_thread->end_time = get_current_uptime();
-    active_thread->exec_time = active_thread->end_time -
-                               active_thread->start_time;
+    rq->dl_ready    = thread->dl_next;
+    thread->dl_next = NULL;
+    --rq->length;
 
-    /* Exit thread properly */
-    thread_exit();
+    return thread->sched_node;
 }
 
-/* Clean a thread that is currently being joined by the curent active thread.
- * Remove the thread from all lists and celan the lists nodes. Scheduler lock
- * should be locked before calling this function.
+/* Charge a deadline thread leaving its CPU for the time it executed. The CPU
+ * run queue lock must be held.
  *
- * @param thread The thread to clean.
+ * @param thread The deadline thread.
+ * @param now The current monotonic time in ns.
  */
-static void clean_joined_thread(kernel_thread_t* thread)
+static void dl_charge(kernel_thread_t* thread, const uint64_t now)
 {
-    kernel_list_node_t* node;
-    OS_RETURN_E         err;
-
-    /* Remove node from children table */
-    node = kernel_list_find_node(active_thread->children, thread, &err);
-    if(err != OS_NO_ERR && err != OS_ERR_NO_SUCH_ID)
+    if(thread->dl_exec_start == 0)
     {
-        kernel_error("Could not find joined thread in chlidren table[%d]\n",
-                     err);
-        kernel_panic();
+        return;
     }
-    if(node != NULL && err == OS_NO_ERR)
+
+    thread->dl_budget    -= (int64_t)(now - thread->dl_exec_start);
+    thread->dl_exec_start = 0;
+
+    #ifdef DEBUG_SCHED
+    if(thread->dl_budget <= 0)
     {
-        err = kernel_list_remove_node_from(active_thread->children, node);
-        if(err != OS_NO_ERR)
-        {
-            kernel_error("Could delete thread node in children table[%d]\n",
-                         err);
-            kernel_panic();
-        }
-        err = kernel_list_delete_node(&node);
-        if(err != OS_NO_ERR)
-        {
-            kernel_error("Could delete thread node[%d]\n", err);
-            kernel_panic();
-        }
+        kernel_serial_debug("Deadline thread %d throttled\n", thread->pid);
     }
+    #endif
+}
 
-    /* Remove node from zombie table */
-    node = kernel_list_find_node(zombie_threads_table, thread, &err);
-    if(err != OS_NO_ERR && err != OS_ERR_NO_SUCH_ID)
+/* Give their runtime back to the throttled deadline threads of a CPU which
+ * period ended. The runtime overrun of the previous period is paid on the new
+ * one. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ */
+static void dl_replenish(const uint32_t cpu_id)
+{
+    cpu_runqueue_t*  rq = &runqueues[cpu_id];
+    kernel_thread_t* thread;
+    uint64_t         now;
+    uint64_t         start;
+
+    if(rq->dl_throttled == NULL)
     {
-        kernel_error("Could not find joined thread in zombie table[%d]\n",
-                     err);
-        kernel_panic();
+        return;
     }
-    if(node != NULL && err == OS_NO_ERR)
+
+    now = get_monotonic_ns() + SCHEDULE_HR_SLACK_NS;
+    while(rq->dl_throttled != NULL && rq->dl_throttled->dl_next_period <= now)
     {
-        err = kernel_list_remove_node_from(zombie_threads_table, node);
-        if(err != OS_NO_ERR)
-        {
-            kernel_error("Could delete thread node in zombie table[%d]\n",
-                         err);
-            kernel_panic();
-        }
-        err = kernel_list_delete_node(&node);
-        if(err != OS_NO_ERR)
+        thread           = rq->dl_throttled;
+        rq->dl_throttled = thread->dl_next;
+
+        /* Periods missed while throttled are not given back */
+        start = thread->dl_next_period;
+        if(now - start >= thread->dl_period)
         {
-            kernel_error("Could delete thread node[%d]\n", err);
-            kernel_panic();
+            start = now;
         }
-    }
 
-    /* Remove node from general table */
-    node = kernel_list_find_node(global_threads_table, thread, &err);
-    if(err != OS_NO_ERR && err != OS_ERR_NO_SUCH_ID)
-    {
-        kernel_error("Could not find joined thread in general table[%d]\n",
-                     err);
-        kernel_panic();
-    }
-    if(node != NULL && err == OS_NO_ERR)
-    {
-        err = kernel_list_remove_node_from(global_threads_table, node);
-        if(err != OS_NO_ERR)
+        thread->dl_abs_deadline = start + thread->dl_deadline;
+        thread->dl_next_period  = start + thread->dl_period;
+        thread->dl_budget      += thread->dl_runtime;
+
+        if(thread->dl_budget <= 0)
         {
-            kernel_error("Could delete thread node in general table[%d]\n",
-                         err);
-            kernel_panic();
+            dl_list_insert(&rq->dl_throttled, thread, 1);
         }
-        err = kernel_list_delete_node(&node);
-        if(err != OS_NO_ERR)
+        else
         {
-            kernel_error("Could delete thread node[%d]\n", err);
-            kernel_panic();
+            dl_list_insert(&rq->dl_ready, thread, 0);
+            ++rq->length;
         }
     }
-
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("Thread %d joined thread %d\n",
-                         active_thread->pid,
-                         thread->pid);
-    #endif
-
-    kfree(thread);
-
-    --thread_count;
-
 }
 
-/* Set the old_thread and active_thread pointers. The function will select the
- * next most prioritary thread to be executed.
- * This function also wake up sleeping thread which wake-up time has been
- * reached
+/* Returns the time before the next deadline class event of a CPU: the end of
+ * the runtime of its executing deadline thread or the end of a throttled
+ * thread period. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @returns The time in nanoseconds, at most SCHEDULE_TICKLESS_MAX ms.
  */
-static void select_thread(void)
+static uint32_t dl_next_event(const uint32_t cpu_id)
 {
-    OS_RETURN_E         err;
-    kernel_thread_t*    sleeping;
-    kernel_list_node_t* sleeping_node;
-    uint32_t             current_time = get_current_uptime();
-
-    /* Switch running thread */
-    old_thread = active_thread;
-    old_thread_node = active_thread_node;
+    kernel_thread_t* active = active_thread[cpu_id];
+    kernel_thread_t* first  = runqueues[cpu_id].dl_throttled;
+    uint64_t         event;
+    uint64_t         now;
 
-
-    /* If the thread was not locked */
-    if(old_thread->state == RUNNING)
+    event = 0;
+    if(active->dl_period != 0 && active->dl_exec_start != 0)
     {
-
-        err = kernel_list_enlist_data(old_thread_node,
-                                      active_threads_table,
-                                      old_thread->priority);
-        if(err != OS_NO_ERR)
+        event = active->dl_exec_start;
+        if(active->dl_budget > 0)
         {
-            kernel_error("Could not enqueue old thread[%d]\n", err);
-            kernel_panic();
+            event += (uint64_t)active->dl_budget;
         }
-
-        old_thread->state = READY;
     }
-    else if(old_thread->state == SLEEPING)
+    if(first != NULL && (event == 0 || first->dl_next_period < event))
     {
-        err = kernel_list_enlist_data(old_thread_node,
-                                      sleeping_threads_table,
-                                      old_thread->wakeup_time);
-        if(err != OS_NO_ERR)
-        {
-            kernel_error("Could not enqueue old thread[%d]\n", err);
-            kernel_panic();
-        }
+        event = first->dl_next_period;
     }
 
-    /* Wake up the sleeping threads */
-    do
+    if(event == 0)
     {
-        sleeping_node = kernel_list_delist_data(sleeping_threads_table, &err);
-        if(err != OS_NO_ERR)
-        {
-            kernel_error("Could not dequeue sleeping thread[%d]\n", err);
-            kernel_panic();
-        }
+        return SCHEDULE_TICKLESS_MAX * 1000000;
+    }
 
-        /* If nothing to wakeup */
-        if(sleeping_node == NULL)
-        {
-            break;
-        }
+    now = get_monotonic_ns();
+    if(event <= now)
+    {
+        return 0;
+    }
+    if(event - now > SCHEDULE_TICKLESS_MAX * 1000000ULL)
+    {
+        return SCHEDULE_TICKLESS_MAX * 1000000;
+    }
 
-        sleeping = (kernel_thread_t*)sleeping_node->data;
+    return (uint32_t)(event - now);
+}
 
-        /* If we should wakeup the thread */
-        if(sleeping != NULL && sleeping->wakeup_time < current_time)
-        {
-            err = kernel_list_enlist_data(sleeping_node,
-                                          active_threads_table,
-                                          sleeping->priority);
+/* Returns the weight of a fair thread, given by its priority.
+ *
+ * @param thread The fair thread.
+ * @returns The weight of the thread.
+ */
+static uint32_t fair_weight(const kernel_thread_t* thread)
+{
+    return fair_weights[(thread->priority * 39) / KERNEL_LOWEST_PRIORITY];
+}
 
-            if(err != OS_NO_ERR)
-            {
-                kernel_error("Could not enqueue sleeping thread[%d]\n", err);
-                kernel_panic();
-            }
-            sleeping->state = READY;
+/* Add a fair thread to the fair tree of a CPU. A woken up thread virtual
+ * runtime is brought back close to the CPU minimal virtual runtime: a thread
+ * which slept long cannot monopolize the CPU, a thread coming from a busier CPU
+ * is not penalized. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @param thread The fair thread.
+ * @param wakeup Set to 1 if the thread was not executing.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E fair_enqueue(const uint32_t cpu_id, kernel_thread_t* thread,
+                                const uint8_t wakeup)
+{
+    OS_RETURN_E     err;
+    cpu_runqueue_t* rq = &runqueues[cpu_id];
+
+    if(wakeup == 1)
+    {
+        if(thread->vruntime + SCHEDULE_FAIR_WAKEUP_NS < rq->min_vruntime)
+        {
+            thread->vruntime = rq->min_vruntime - SCHEDULE_FAIR_WAKEUP_NS;
         }
-        else if(sleeping != NULL)
+        else if(thread->vruntime > rq->min_vruntime + SCHEDULE_FAIR_WAKEUP_NS)
         {
-            err = kernel_list_enlist_data(sleeping_node,
-                                          sleeping_threads_table,
-                                          sleeping->wakeup_time);
-            if(err != OS_NO_ERR)
-            {
-                kernel_error("Could not enqueue sleeping thread[%d]\n", err);
-                kernel_panic();
-            }
-            break;
+            thread->vruntime = rq->min_vruntime + SCHEDULE_FAIR_WAKEUP_NS;
         }
-    } while(sleeping_node != NULL);
+    }
 
-    /* Get the new thread */
-    active_thread_node = kernel_list_delist_data(active_threads_table, &err);
-    if(active_thread_node == NULL || err != OS_NO_ERR)
+    /* The fair class starts aging when it gets ready */
+    if(kernel_rbtree_first(&rq->fair_tree) == NULL)
     {
-        kernel_error("Could not dequeue next thread[%d]\n", err);
-        kernel_panic();
+        rq->fair_epoch = rq->epoch;
     }
 
-    active_thread = (kernel_thread_t*)active_thread_node->data;
-
-    if(active_thread == NULL)
+    thread->fair_node.data = thread;
+    err = kernel_rbtree_insert(&rq->fair_tree, &thread->fair_node,
+                               thread->vruntime);
+    if(err != OS_NO_ERR)
     {
-        kernel_error("Next thread to schedule should not be NULL\n");
-        kernel_panic();
+        return err;
     }
-    active_thread->state = RUNNING;
+
+    ++rq->length;
+    thread->rq_cpu = cpu_id;
+
+    return OS_NO_ERR;
 }
 
-/* !!! THIS FUNCTION SHOULD NEVER BE CALLED OUTSIDE OF AN INTERRUPT !!!
- * Scheduling function, will the interrupt saved the registers in the current
- * thread stack. The function will call the select_thread function and then
- * set the CPU registers with the values on the new active_thread stack.
- * Then the function manage interruption and return from interrupt.
+/* Remove the fair thread of lowest virtual runtime allowed on a CPU from a CPU
+ * fair tree. The run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU owning the run queue.
+ * @param for_cpu The id of the CPU that will execute the thread.
+ * @param error A pointer to the variable that contains the function success
+ * state. May be NULL.
+ * @returns The node of the thread, NULL if no fair thread is ready.
  */
-static void schedule_int(cpu_state_t *cpu_state, uint32_t int_id,
-                         stack_state_t *stack_state)
+static kernel_list_node_t* fair_dequeue(const uint32_t cpu_id,
+                                        const uint32_t for_cpu,
+                                        OS_RETURN_E* error)
 {
-    OS_RETURN_E err;
-
-    if(get_local_interrupt_enabled() != 1)
+    OS_RETURN_E           err;
+    kernel_rbtree_node_t* node;
+    kernel_thread_t*      thread;
+    cpu_runqueue_t*       rq = &runqueues[cpu_id];
+
+    node = kernel_rbtree_first(&rq->fair_tree);
+    while(node != NULL &&
+          (((kernel_thread_t*)node->data)->affinity &
+           THREAD_AFFINITY_CPU(for_cpu)) == 0)
     {
-        kernel_error("Interrupts should not be disabled when calling the\
- scheduler\n");
-        kernel_panic();
+        node = kernel_rbtree_next(node);
     }
 
-#if SCHEDULE_DYN_PRIORITY
-    kernel_list_node_t *cursor;
-    kernel_thread_t* thread;
-
-    if(active_thread != idle_thread && active_thread != init_thread)
+    if(node == NULL)
     {
-        if(int_id == PIT_INTERRUPT_LINE)
-        {
-            /* Here the thread consumed all its time slice so it get its init
-             * priority.
-             */
-             active_thread->priority = active_thread->init_prio;
-        }
-         /* Upgrade process priority by 1 if the thread has not been executed since
-          * the last 100 ticks. Note that the actual change will be seen when more
-          * prioritary threads will be puck bakc in the queue later.
-          */
-        cursor = active_threads_table->head;
-        while(cursor != NULL)
+        if(error != NULL)
         {
-            if(cursor->data == idle_thread || cursor->data == init_thread)
-            {
-                cursor = cursor->next;
-                continue;
-            }
-
-            thread = (kernel_thread_t*)cursor->data;
-
-            ++thread->last_sched;
-            if(thread->last_sched >= 25)
-            {
-                if(thread->priority > KERNEL_HIGHEST_PRIORITY)
-                {
-                    --(thread->priority);
-                    --(cursor->priority);
-                }
-                thread->last_sched = 0;
-            }
-
-            cursor = cursor->next;
+            *error = OS_NO_ERR;
         }
-
-        active_thread->last_sched = 0;
+        return NULL;
     }
 
-#endif /* SCHEDULE_DYN_PRIORITY */
-
-    (void) stack_state;
+    thread = (kernel_thread_t*)node->data;
 
-    /* If not first schedule */
-    if(first_schedule == 1)
+    err = kernel_rbtree_remove(&rq->fair_tree, node);
+    if(error != NULL)
     {
-        /* Save the actual ESP */
-        active_thread->esp = cpu_state->esp - 4;
-
-        /* Search for next thread */
-        select_thread();
+        *error = err;
     }
-    else
+    if(err != OS_NO_ERR)
     {
-        first_schedule = 1;
+        return NULL;
     }
 
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("Sched %d -> %d\n",
-                         old_thread->pid,
-                         active_thread->pid);
-    #endif
+    --rq->length;
 
-    if(int_id == sched_hw_int_line)
-    {
-        /* Update TIMER tick count */
-        update_tick();
+    return thread->sched_node;
+}
 
-        /* Send EOI signal */
-        err = set_IRQ_EOI(sched_irq);
-        if(err != OS_NO_ERR)
-        {
-            kernel_error("Could not EIO scheduler timer[%d]\n", err);
-            kernel_panic();
-        }
+/* Charge a fair thread leaving its CPU for the time it executed, scaled by its
+ * weight. Executions longer than SCHEDULE_FAIR_MAX_DELTA_NS only happen with
+ * the interrupts disabled and are capped. The CPU run queue lock must be held.
+ *
+ * @param thread The fair thread.
+ * @param now The current monotonic time in ns.
+ */
+static void fair_charge(kernel_thread_t* thread, const uint64_t now)
+{
+    uint64_t delta;
+
+    if(thread->fair_exec_start == 0)
+    {
+        return;
     }
 
-    /* Restore thread esp */
-    __asm__ __volatile__("mov %%eax, %%esp": :"a"(active_thread->esp));
-    __asm__ __volatile__("pop %esp");
-    __asm__ __volatile__("pop %ebp");
-    __asm__ __volatile__("pop %edi");
-    __asm__ __volatile__("pop %esi");
-    __asm__ __volatile__("pop %edx");
-    __asm__ __volatile__("pop %ecx");
-    __asm__ __volatile__("pop %ebx");
-    __asm__ __volatile__("pop %eax");
+    delta = now - thread->fair_exec_start;
+    if(delta > SCHEDULE_FAIR_MAX_DELTA_NS)
+    {
+        delta = SCHEDULE_FAIR_MAX_DELTA_NS;
+    }
 
-    __asm__ __volatile__("pop %ss");
-    __asm__ __volatile__("pop %gs");
-    __asm__ __volatile__("pop %fs");
-    __asm__ __volatile__("pop %es");
-    __asm__ __volatile__("pop %ds");
-    __asm__ __volatile__("add $8, %esp");
-    __asm__ __volatile__("iret");
+    thread->vruntime += cpu_udiv_64_32(delta * SCHEDULE_FAIR_WEIGHT_BASE,
+                                       fair_weight(thread));
+    thread->fair_exec_start = 0;
 }
 
-SYSTEM_STATE_E get_system_state(void)
+/* Advance the minimal virtual runtime of a CPU to the one of its first fair
+ * thread. The minimal virtual runtime never decreases. The CPU run queue lock
+ * must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ */
+static void fair_update_min(const uint32_t cpu_id)
 {
-    return system_state;
+    kernel_rbtree_node_t* first;
+    cpu_runqueue_t*       rq = &runqueues[cpu_id];
+
+    first = kernel_rbtree_first(&rq->fair_tree);
+    if(first != NULL && first->key > rq->min_vruntime)
+    {
+        rq->min_vruntime = first->key;
+    }
 }
 
-OS_RETURN_E init_scheduler(void)
+/* Add a thread node to a CPU run queue. The node is inserted at the list head
+ * of the FIFO corresponding to the priority, FIFOs are dequeued from the list
+ * tail, and the priority is marked as ready in the run queue bitmap. Deadline
+ * threads join the deadline lists and fair threads the fair tree. The run
+ * queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU owning the run queue.
+ * @param node The node containing the thread to enqueue.
+ * @param priority The priority of the thread.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E rq_enqueue(const uint32_t cpu_id, kernel_list_node_t* node,
+                              const uint32_t priority)
 {
-    OS_RETURN_E err;
-    kernel_list_node_t* second_idle_thread_node;
-
-    /* Init scheduler settings */
-    last_given_pid  = 0;
-    thread_count    = 0;
-    first_schedule  = 0;
-
-    idle_thread   = NULL;
-    idle_thread_node  = NULL;
-    init_thread  = NULL;
-    init_thread_node  = NULL;
-
-    active_thread      = NULL;
-    active_thread_node = NULL;
-    old_thread         = NULL;
-    old_thread_node    = NULL;
-    idle_thread        = NULL;
-    idle_thread_node   = NULL;
-    init_thread        = NULL;
-    init_thread_node   = NULL;
+    OS_RETURN_E      err;
+    cpu_runqueue_t*  rq     = &runqueues[cpu_id];
+    kernel_thread_t* thread = (kernel_thread_t*)node->data;
 
-    /* Init thread tables */
-    global_threads_table     = kernel_list_create_list(&err);
-    if(err != OS_NO_ERR)
-    {
-        kernel_error("Could not create global_threads_table[%d]\n", err);
-        kernel_panic();
-    }
-    active_threads_table     = kernel_list_create_list(&err);
-    if(err != OS_NO_ERR)
+    if(priority > KERNEL_LOWEST_PRIORITY)
     {
-        kernel_error("Could not create active_threads_table[%d]\n", err);
-        kernel_panic();
+        return OS_ERR_FORBIDEN_PRIORITY;
     }
-    zombie_threads_table     = kernel_list_create_list(&err);
-    if(err != OS_NO_ERR)
+
+    /* The thread is not allowed on the CPU, an allowed CPU enqueues it */
+    if((thread->affinity & THREAD_AFFINITY_CPU(cpu_id)) == 0)
     {
-        kernel_error("Could not create zombie_threads_table[%d]\n", err);
-        kernel_panic();
+        thread->priority = priority;
+        rq_migrate(thread, -1);
+        return OS_NO_ERR;
     }
-    sleeping_threads_table   = kernel_list_create_list(&err);
-    if(err != OS_NO_ERR)
+
+    if(thread->dl_period != 0)
     {
-        kernel_error("Could not create sleeping_threads_table[%d]\n", err);
-        kernel_panic();
+        thread->priority = priority;
+        dl_enqueue(cpu_id, thread, 1);
+        return OS_NO_ERR;
     }
 
-    /* Create idle thread */
-    idle_thread = kmalloc(sizeof(kernel_thread_t));
-    idle_thread_node = kernel_list_create_node(idle_thread, &err);
-
-    if(err != OS_NO_ERR || idle_thread == NULL || idle_thread_node == NULL)
+    if(thread->policy == SCHED_POLICY_FAIR)
     {
-        kernel_error("Could not create IDLE thread\n");
-        kernel_panic();
+        thread->priority = priority;
+        return fair_enqueue(cpu_id, thread, 1);
     }
 
-    memset(idle_thread, 0, sizeof(kernel_thread_t));
-
-    /* Init thread settings */
-    idle_thread->pid            = last_given_pid;
-    idle_thread->ppid           = last_given_pid;
-    idle_thread->priority       = IDLE_THREAD_PRIORITY;
-    idle_thread->init_prio      = IDLE_THREAD_PRIORITY;
-    idle_thread->args           = 0;
-    idle_thread->function       = idle_sys;
-    idle_thread->joining_thread = NULL;
-    idle_thread->state          = RUNNING;
-
-    idle_thread->children = kernel_list_create_list(&err);
+    /* All the nodes of a FIFO share the same list priority, the node is
+     * directly inserted at the list head, no need to walk the list.
+     */
+    err = kernel_list_enlist_data(node, rq->table[priority], 0);
     if(err != OS_NO_ERR)
     {
-        kernel_error("Could not create children table[%d]\n", err);
-        kernel_panic();
+        return err;
     }
 
-    /* Init thread context */
-    idle_thread->eip = (uint32_t) thread_wrapper;
-    idle_thread->esp =
-        (uint32_t)&idle_thread->kernel_stack[THREAD_STACK_SIZE - 18];
-    idle_thread->ebp =
-        (uint32_t)&idle_thread->kernel_stack[THREAD_STACK_SIZE - 1];
-
-    /* Init thread stack */
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 1] = 0x00000002;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 2] = THREAD_INIT_CS;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 3] = idle_thread->eip;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 4] = 0; /* UNUSED (error core) */
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 5] = 0; /* UNUSED (int id) */
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 6] = THREAD_INIT_DS;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 7] = THREAD_INIT_ES;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 8] = THREAD_INIT_FS;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 9] = THREAD_INIT_GS;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 10] = THREAD_INIT_SS;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 11] = THREAD_INIT_EAX;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 12] = THREAD_INIT_EBX;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 13] = THREAD_INIT_ECX;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 14] = THREAD_INIT_EDX;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 15] = THREAD_INIT_ESI;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 16] = THREAD_INIT_EDI;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 17] = idle_thread->ebp;
-    idle_thread->kernel_stack[THREAD_STACK_SIZE - 18] =
-        (uint32_t)&idle_thread->kernel_stack[THREAD_STACK_SIZE - 17];
-
-    strncpy(idle_thread->name, "idle\0", 5);
-
-    active_thread = idle_thread;
-    active_thread_node = idle_thread_node;
-    old_thread = active_thread;
-    old_thread_node = active_thread_node;
+    rq->bitmap[priority >> 5] |= (1 << (priority & 0x1F));
+    ++rq->length;
 
-    system_state = RUNNING;
-    ++thread_count;
+    thread->rq_cpu   = cpu_id;
+    thread->rq_epoch = rq->epoch;
 
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("IDLE thread created\n");
-    #endif
+    return OS_NO_ERR;
+}
 
-    second_idle_thread_node = kernel_list_create_node(idle_thread, &err);
+/* Enqueue the threads moved to the CPU given as parameter. A thread which
+ * context is not saved yet by the CPU it left is kept for the next schedule.
+ * The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ */
+static void rq_drain_incoming(const uint32_t cpu_id)
+{
+    OS_RETURN_E      err;
+    kernel_thread_t* thread;
+    kernel_thread_t* next;
+    kernel_thread_t* retry;
 
-    if(err != OS_NO_ERR || second_idle_thread_node == NULL)
+    if(rq_incoming[cpu_id] == NULL)
     {
-        kernel_error("Could not create second IDLE thread node\n");
-        kernel_panic();
+        return;
     }
 
-    err = kernel_list_enlist_data(second_idle_thread_node, global_threads_table,
-                                  idle_thread->priority);
-    if(err != OS_NO_ERR)
-    {
-        kernel_error("Could not enqueue thread in global table[%d]\n", err);
-        kernel_panic();
-    }
+    raw_lock(&migrate_lock);
+    thread              = rq_incoming[cpu_id];
+    rq_incoming[cpu_id] = NULL;
+    raw_unlock(&migrate_lock);
 
-    sched_irq         = (uint32_t)get_IRQ_SCHED_TIMER();
-    sched_hw_int_line = (uint32_t)get_line_SCHED_HW();
+    retry = NULL;
+    while(thread != NULL)
+    {
+        next = thread->migrate_next;
+
+        /* The previous CPU releases its run queue lock once it saved the
+         * thread context
+         */
+        if(thread->migrate_from != -1)
+        {
+            if(raw_trylock(&runqueues[thread->migrate_from].lock) == 0)
+            {
+                thread->migrate_next = retry;
+                retry                = thread;
+                thread               = next;
+                continue;
+            }
+            raw_unlock(&runqueues[thread->migrate_from].lock);
+            thread->migrate_from = -1;
+        }
+
+        thread->migrate_next = NULL;
+
+        err = rq_enqueue(cpu_id, thread->sched_node, thread->priority);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not enqueue migrated thread[%d]\n", err);
+            kernel_panic();
+        }
+
+        thread = next;
+    }
+
+    while(retry != NULL)
+    {
+        next = retry->migrate_next;
+
+        raw_lock(&migrate_lock);
+        retry->migrate_next = rq_incoming[cpu_id];
+        rq_incoming[cpu_id] = retry;
+        raw_unlock(&migrate_lock);
+
+        retry = next;
+    }
+}
+
+/* Remove a ready thread from a CPU run queue. The thread must be enqueued in
+ * the run queue. The run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU owning the run queue.
+ * @param thread The thread to remove.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E rq_remove(const uint32_t cpu_id, kernel_thread_t* thread)
+{
+    OS_RETURN_E     err;
+    cpu_runqueue_t* rq = &runqueues[cpu_id];
+
+    if(thread->fair_node.linked != 0)
+    {
+        err = kernel_rbtree_remove(&rq->fair_tree, &thread->fair_node);
+        if(err == OS_NO_ERR)
+        {
+            --rq->length;
+        }
+        return err;
+    }
+
+    err = kernel_list_unlink_node(rq->table[thread->priority],
+                                  thread->sched_node);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    if(rq->table[thread->priority]->head == NULL)
+    {
+        rq->bitmap[thread->priority >> 5] &= ~(1 << (thread->priority & 0x1F));
+    }
+    --rq->length;
+
+    return OS_NO_ERR;
+}
+
+/* Returns the priority of a ready thread once aged. A thread gains one
+ * priority level every SCHEDULE_AGING_PERIOD epochs spent in the run queue, the
+ * aging is computed when needed instead of at each schedule. INIT is not aged.
+ *
+ * @param rq The run queue containing the thread.
+ * @param thread The thread to get the priority of.
+ * @returns The aged priority of the thread.
+ */
+static uint32_t rq_aged_priority(const cpu_runqueue_t* rq,
+                                 const kernel_thread_t* thread)
+{
+#if SCHEDULE_DYN_PRIORITY
+    uint32_t boost;
+
+    if(thread == init_thread)
+    {
+        return thread->priority;
+    }
+
+    boost = (rq->epoch - thread->rq_epoch) / SCHEDULE_AGING_PERIOD;
+    if(boost >= thread->priority - KERNEL_HIGHEST_PRIORITY)
+    {
+        return KERNEL_HIGHEST_PRIORITY;
+    }
+
+    return thread->priority - boost;
+#else
+    (void)rq;
+
+    return thread->priority;
+#endif /* SCHEDULE_DYN_PRIORITY */
+}
+
+/* Returns the priority of the fair class once aged. The class ages like a
+ * ready thread, since a fair thread last got the CPU or since the class got
+ * ready.
+ *
+ * @param rq The run queue containing the fair threads.
+ * @returns The aged priority of the fair class.
+ */
+static uint32_t rq_fair_aged_priority(const cpu_runqueue_t* rq)
+{
+#if SCHEDULE_DYN_PRIORITY
+    uint32_t boost;
+
+    boost = (rq->epoch - rq->fair_epoch) / SCHEDULE_AGING_PERIOD;
+    if(boost >= SCHEDULE_FAIR_PRIORITY - KERNEL_HIGHEST_PRIORITY)
+    {
+        return KERNEL_HIGHEST_PRIORITY;
+    }
+
+    return SCHEDULE_FAIR_PRIORITY - boost;
+#else
+    (void)rq;
+
+    return SCHEDULE_FAIR_PRIORITY;
+#endif /* SCHEDULE_DYN_PRIORITY */
+}
+
+/* Remove the most prioritary thread node allowed on a CPU from a CPU run
+ * queue. Nodes are inserted at the list head and dequeued from the list tail,
+ * the tail of a FIFO is its oldest thread, hence its most aged one. Only
+ * the tails of the non empty FIFOs, found with the run queue bitmap, are
+ * compared. A FIFO is only walked when its tail is not allowed on the CPU,
+ * which only happens when a thread is stolen. The priority of the removed
+ * thread is updated with its aging. The fair class competes as a single entry,
+ * see rq_fair_aged_priority: the first fair thread is removed if the class is
+ * strictly more prioritary than the best priority thread or if no priority
+ * thread is ready. The run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU owning the run queue.
+ * @param for_cpu The id of the CPU that will execute the thread.
+ * @param error A pointer to the variable that contains the function success
+ * state. May be NULL.
+ * @returns The node of the most prioritary ready thread, NULL if no thread is
+ * ready.
+ */
+static kernel_list_node_t* rq_dequeue(const uint32_t cpu_id,
+                                      const uint32_t for_cpu,
+                                      OS_RETURN_E* error)
+{
+    kernel_list_node_t* node;
+    kernel_list_node_t* best_node;
+    kernel_thread_t*    thread;
+    OS_RETURN_E         err;
+    cpu_runqueue_t*     rq = &runqueues[cpu_id];
+    uint32_t            bitmap;
+    uint32_t            priority;
+    uint32_t            aged;
+    uint32_t            best;
+    uint32_t            best_aged;
+    uint32_t            i;
+
+    best      = KERNEL_LOWEST_PRIORITY + 1;
+    best_aged = KERNEL_LOWEST_PRIORITY + 1;
+    best_node = NULL;
+
+    for(i = 0;
+        i < PRIORITY_BITMAP_SIZE && best_aged != KERNEL_HIGHEST_PRIORITY;
+        ++i)
+    {
+        bitmap = rq->bitmap[i];
+        while(bitmap != 0 && best_aged != KERNEL_HIGHEST_PRIORITY)
+        {
+            priority = (i << 5) + cpu_bsf(bitmap);
+            bitmap  &= ~(1 << (priority & 0x1F));
+
+            node = rq->table[priority]->tail;
+            while(node != NULL &&
+                  (((kernel_thread_t*)node->data)->affinity &
+                   THREAD_AFFINITY_CPU(for_cpu)) == 0)
+            {
+                node = node->prev;
+            }
+            if(node == NULL)
+            {
+                continue;
+            }
+
+            thread = (kernel_thread_t*)node->data;
+            aged   = rq_aged_priority(rq, thread);
+            if(aged < best_aged)
+            {
+                best      = priority;
+                best_aged = aged;
+                best_node = node;
+            }
+        }
+    }
+
+    /* The fair class competes with the best priority thread */
+    if(kernel_rbtree_first(&rq->fair_tree) != NULL &&
+       (best_node == NULL || rq_fair_aged_priority(rq) < best_aged))
+    {
+        node = fair_dequeue(cpu_id, for_cpu, &err);
+        if(node != NULL)
+        {
+            rq->fair_epoch = rq->epoch;
+        }
+        if(node != NULL || err != OS_NO_ERR || best_node == NULL)
+        {
+            if(error != NULL)
+            {
+                *error = err;
+            }
+            return node;
+        }
+    }
+    else if(best_node == NULL)
+    {
+        if(error != NULL)
+        {
+            *error = OS_NO_ERR;
+        }
+        return NULL;
+    }
+
+    err = kernel_list_unlink_node(rq->table[best], best_node);
+    if(error != NULL)
+    {
+        *error = err;
+    }
+    if(err != OS_NO_ERR)
+    {
+        return NULL;
+    }
+
+    if(rq->table[best]->head == NULL)
+    {
+        rq->bitmap[best >> 5] &= ~(1 << (best & 0x1F));
+    }
+
+    --rq->length;
+    ((kernel_thread_t*)best_node->data)->priority = best_aged;
+
+    return best_node;
+}
+
+/* Returns the online CPU which run queue is the longest, the CPU given as
+ * parameter excluded. Lengths are read without locking, the result is a hint.
+ *
+ * @param cpu_id The id of the CPU looking for a busier CPU.
+ * @returns The id of the busiest CPU, cpu_id if no other CPU has ready threads.
+ */
+static uint32_t rq_find_busiest(const uint32_t cpu_id)
+{
+    uint32_t i;
+    uint32_t busiest = cpu_id;
+    uint32_t length  = 0;
+
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        if(i != cpu_id && idle_thread[i] != NULL &&
+           runqueues[i].length > length)
+        {
+            busiest = i;
+            length  = runqueues[i].length;
+        }
+    }
+
+    return busiest;
+}
+
+/* Steal the most prioritary ready thread of the busiest CPU allowed on the
+ * CPU given as parameter. The stolen thread is moved to the run queue of the
+ * CPU given as parameter but not enqueued.
+ * The local run queue lock must be held, the busiest run queue lock is only
+ * tried to respect the locks order.
+ *
+ * @param cpu_id The id of the CPU stealing a thread.
+ * @param min_length The minimal length of the busiest run queue to steal from.
+ * @returns The node of the stolen thread, NULL if no thread was stolen.
+ */
+static kernel_list_node_t* rq_steal(const uint32_t cpu_id,
+                                    const uint32_t min_length)
+{
+    kernel_list_node_t* node;
+    kernel_thread_t*    thread;
+    OS_RETURN_E         err;
+    uint32_t            busiest;
+    int64_t             lag;
+
+    busiest = rq_find_busiest(cpu_id);
+    if(busiest == cpu_id || runqueues[busiest].length < min_length)
+    {
+        return NULL;
+    }
+
+    if(raw_trylock(&runqueues[busiest].lock) == 0)
+    {
+        return NULL;
+    }
+
+    node = rq_dequeue(busiest, cpu_id, &err);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not steal thread[%d]\n", err);
+        kernel_panic();
+    }
+
+    /* The thread changes of run queue while both locks are held, a fair
+     * thread keeps its virtual runtime relative to the CPU minimal one
+     */
+    if(node != NULL)
+    {
+        thread         = (kernel_thread_t*)node->data;
+        thread->rq_cpu = cpu_id;
+
+        if(thread->policy == SCHED_POLICY_FAIR)
+        {
+            lag = (int64_t)(thread->vruntime -
+                            runqueues[busiest].min_vruntime);
+            if(lag < 0 && (uint64_t)(-lag) > runqueues[cpu_id].min_vruntime)
+            {
+                thread->vruntime = 0;
+            }
+            else
+            {
+                thread->vruntime = runqueues[cpu_id].min_vruntime + lag;
+            }
+        }
+    }
+
+    raw_unlock(&runqueues[busiest].lock);
+
+    #ifdef DEBUG_SCHED
+    if(node != NULL)
+    {
+        kernel_serial_debug("CPU %d stole thread %d from CPU %d\n", cpu_id,
+                            ((kernel_thread_t*)node->data)->pid, busiest);
+    }
+    #endif
+
+    return node;
+}
+
+/* Balance the load between the CPU given as parameter and the busiest CPU. If
+ * the busiest run queue has at least two more ready threads than the local one,
+ * its most prioritary thread is moved to the local run queue. The local run
+ * queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU to balance.
+ */
+static void rq_balance(const uint32_t cpu_id)
+{
+    kernel_list_node_t* node;
+    OS_RETURN_E         err;
+
+    node = rq_steal(cpu_id, runqueues[cpu_id].length + 2);
+    if(node == NULL)
+    {
+        return;
+    }
+
+    err = rq_enqueue(cpu_id, node, ((kernel_thread_t*)node->data)->priority);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not enqueue balanced thread[%d]\n", err);
+        kernel_panic();
+    }
+}
+
+/* Add a sleeping thread to the sleep wheel. Level n of the wheel has slots of
+ * SLEEP_WHEEL_SIZE^n milliseconds, the thread is put in the slot of the lowest
+ * level that can hold its wakeup time. Threads of upper levels are moved down
+ * when the wheel time reaches their slot. Wakeup times too far in the future
+ * are put in the last slot reachable and re-inserted later. The sleep lock
+ * must be held.
+ *
+ * @param node The node containing the sleeping thread.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E sleep_wheel_insert(kernel_list_node_t* node)
+{
+    kernel_thread_t* thread = (kernel_thread_t*)node->data;
+    uint32_t         expire = thread->wakeup_time;
+    uint32_t         delta;
+    uint32_t         level;
+
+    /* Already expired, wakeup at the next wheel step */
+    if((int32_t)(expire - sleep_wheel_time) < 0)
+    {
+        expire = sleep_wheel_time;
+    }
+
+    delta = expire - sleep_wheel_time;
+    for(level = 0; level < SLEEP_WHEEL_LEVELS - 1; ++level)
+    {
+        if(delta < (1U << (SLEEP_WHEEL_BITS * (level + 1))))
+        {
+            break;
+        }
+    }
+
+    if(level == SLEEP_WHEEL_LEVELS - 1 &&
+       delta >= (1U << (SLEEP_WHEEL_BITS * SLEEP_WHEEL_LEVELS)) - 1)
+    {
+        expire = sleep_wheel_time +
+                 (1U << (SLEEP_WHEEL_BITS * SLEEP_WHEEL_LEVELS)) - 1;
+    }
+
+    return kernel_list_enlist_data(node,
+                                   sleep_wheel[level][(expire >>
+                                   (SLEEP_WHEEL_BITS * level)) &
+                                   (SLEEP_WHEEL_SIZE - 1)],
+                                   0);
+}
+
+/* Advance the sleep wheel up to the current time. Every thread which wake-up
+ * time is before the current time is set ready and put in the run queue of the
+ * CPU given as parameter. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU waking up the threads.
+ * @param current_time The current uptime.
+ * @param now The current monotonic time in ns, start of the woken up threads
+ * ready wait.
+ */
+static void sleep_wheel_expire(const uint32_t cpu_id,
+                               const uint32_t current_time,
+                               const uint64_t now)
+{
+    OS_RETURN_E         err;
+    kernel_list_node_t* node;
+    kernel_list_t*      slot;
+    kernel_thread_t*    thread;
+    int32_t             level;
+    uint32_t            index;
+
+    /* Nothing to wake up, the wheel directly jumps to the current time */
+    if(sleeping_count == 0)
+    {
+        sleep_wheel_time = current_time;
+        return;
+    }
+
+    while((int32_t)(current_time - sleep_wheel_time) > 0)
+    {
+        /* Move down the threads of the upper levels slots starting now */
+        for(level = SLEEP_WHEEL_LEVELS - 1; level > 0; --level)
+        {
+            if((sleep_wheel_time &
+                ((1U << (SLEEP_WHEEL_BITS * level)) - 1)) != 0)
+            {
+                continue;
+            }
+
+            index = (sleep_wheel_time >> (SLEEP_WHEEL_BITS * level)) &
+                    (SLEEP_WHEEL_SIZE - 1);
+            slot = sleep_wheel[level][index];
+            while((node = kernel_list_delist_data(slot, &err)) != NULL)
+            {
+                err = sleep_wheel_insert(node);
+                if(err != OS_NO_ERR)
+                {
+                    kernel_error("Could not cascade sleeping thread[%d]\n",
+                                 err);
+                    kernel_panic();
+                }
+            }
+        }
+
+        /* Wake up the threads of the current slot */
+        slot = sleep_wheel[0][sleep_wheel_time & (SLEEP_WHEEL_SIZE - 1)];
+        while((node = kernel_list_delist_data(slot, &err)) != NULL)
+        {
+            thread = (kernel_thread_t*)node->data;
+
+            err = rq_enqueue(cpu_id, node, thread->priority);
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not enqueue sleeping thread[%d]\n", err);
+                kernel_panic();
+            }
+            thread->state       = READY;
+            thread->ready_since = now;
+            thread->woken       = 1;
+            --sleeping_count;
+        }
+
+        ++sleep_wheel_time;
+
+        if(sleeping_count == 0)
+        {
+            sleep_wheel_time = current_time;
+        }
+    }
+}
+
+/* Returns the time before the next sleep wheel event. The event is either the
+ * wake-up of a thread or the move down of an upper level slot.
+ * The sleep lock must be held.
+ *
+ * @param current_time The current uptime.
+ * @returns The time before the next event in milliseconds, at most
+ * SCHEDULE_TICKLESS_MAX.
+ */
+static uint32_t sleep_wheel_next(const uint32_t current_time)
+{
+    uint32_t level;
+    uint32_t shift;
+    uint32_t index;
+    uint32_t offset;
+    uint32_t event;
+    uint32_t next;
+
+    next = current_time + SCHEDULE_TICKLESS_MAX;
+
+    if(sleeping_count == 0)
+    {
+        return SCHEDULE_TICKLESS_MAX;
+    }
+
+    for(level = 0; level < SLEEP_WHEEL_LEVELS; ++level)
+    {
+        shift = SLEEP_WHEEL_BITS * level;
+        index = (sleep_wheel_time >> shift) & (SLEEP_WHEEL_SIZE - 1);
+
+        for(offset = 0; offset < SLEEP_WHEEL_SIZE; ++offset)
+        {
+            if(sleep_wheel[level][(index + offset) &
+                                  (SLEEP_WHEEL_SIZE - 1)]->head != NULL)
+            {
+                break;
+            }
+        }
+        if(offset == SLEEP_WHEEL_SIZE)
+        {
+            continue;
+        }
+
+        /* An upper level current slot already moved down belongs to the next
+         * wheel turn.
+         */
+        if(level > 0 && offset == 0 &&
+           (sleep_wheel_time & ((1U << shift) - 1)) != 0)
+        {
+            offset = SLEEP_WHEEL_SIZE;
+        }
+
+        event = ((sleep_wheel_time >> shift) + offset) << shift;
+        if((int32_t)(event - next) < 0)
+        {
+            next = event;
+        }
+    }
+
+    /* Threads are woken up once the current time passed their wake-up time */
+    if((int32_t)(next - current_time) < 0)
+    {
+        return 1;
+    }
+
+    return next - current_time + 1;
+}
+
+/* Add a thread to the high resolution sleeping threads of a CPU, sorted by
+ * wake up time. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU the thread sleeps on.
+ * @param thread The sleeping thread.
+ */
+static void hr_sleep_insert(const uint32_t cpu_id, kernel_thread_t* thread)
+{
+    kernel_thread_t** cursor;
+
+    cursor = &hr_sleepers[cpu_id];
+    while(*cursor != NULL && (*cursor)->wakeup_ns <= thread->wakeup_ns)
+    {
+        cursor = &(*cursor)->hr_next;
+    }
+
+    thread->hr_next = *cursor;
+    *cursor         = thread;
+}
+
+/* Wake up the high resolution sleeping threads of a CPU which wake up time is
+ * reached, they join the CPU run queue. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @param now The current monotonic time in ns.
+ */
+static void hr_sleep_expire(const uint32_t cpu_id, const uint64_t now)
+{
+    OS_RETURN_E      err;
+    kernel_thread_t* thread;
+
+    while(hr_sleepers[cpu_id] != NULL &&
+          hr_sleepers[cpu_id]->wakeup_ns <= now + SCHEDULE_HR_SLACK_NS)
+    {
+        thread              = hr_sleepers[cpu_id];
+        hr_sleepers[cpu_id] = thread->hr_next;
+
+        thread->hr_next   = NULL;
+        thread->wakeup_ns = 0;
+
+        err = rq_enqueue(cpu_id, thread->sched_node, thread->priority);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not enqueue sleeping thread[%d]\n", err);
+            kernel_panic();
+        }
+        thread->state       = READY;
+        thread->ready_since = now;
+        thread->woken       = 1;
+    }
+}
+
+/* Returns the time before the next high resolution wake up of a CPU. The CPU
+ * run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @returns The time in nanoseconds, at most SCHEDULE_TICKLESS_MAX ms.
+ */
+static uint32_t hr_sleep_next(const uint32_t cpu_id)
+{
+    uint64_t now;
+    uint64_t delta;
+
+    if(hr_sleepers[cpu_id] == NULL)
+    {
+        return SCHEDULE_TICKLESS_MAX * 1000000;
+    }
+
+    now = get_monotonic_ns();
+    if(hr_sleepers[cpu_id]->wakeup_ns <= now)
+    {
+        return 0;
+    }
+
+    delta = hr_sleepers[cpu_id]->wakeup_ns - now;
+    if(delta > SCHEDULE_TICKLESS_MAX * 1000000ULL)
+    {
+        return SCHEDULE_TICKLESS_MAX * 1000000;
+    }
+
+    return (uint32_t)delta;
+}
+
+/* Program the timer of a CPU for its next high resolution wake up or deadline
+ * class event if it comes before the next scheduler tick. Idle CPUs which ticks
+ * are stopped already programmed it. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ */
+static void sched_hrtimer_arm(const uint32_t cpu_id)
+{
+    uint32_t time_ns;
+    uint32_t dl_ns;
+
+    if(tickless[cpu_id] == 1)
+    {
+        return;
+    }
+
+    time_ns = hr_sleep_next(cpu_id);
+    dl_ns   = dl_next_event(cpu_id);
+    if(dl_ns < time_ns)
+    {
+        time_ns = dl_ns;
+    }
+
+    if(time_ns < SCHEDULE_TICKLESS_MAX * 1000000)
+    {
+        hr_armed[cpu_id] = set_sched_timer_deadline(time_ns);
+    }
+}
+
+/* Restart the scheduler ticks of a CPU which timer was programmed for a high
+ * resolution wake up. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @returns 1 if the timer was programmed for a wake up, 0 otherwise.
+ */
+static uint8_t sched_hrtimer_cancel(const uint32_t cpu_id)
+{
+    if(hr_armed[cpu_id] == 0)
+    {
+        return 0;
+    }
+
+    set_sched_timer_periodic();
+    hr_armed[cpu_id] = 0;
+
+    return 1;
+}
+
+/* Send the scheduler IPI to the CPU given as parameter if its ticks are
+ * stopped, the CPU then schedules the threads of its run queue. A CPU which
+ * ticks are stopped only executes its IDLE thread or an interrupt handler, the
+ * IPI is sent to the current CPU if needed.
+ *
+ * @param cpu_id The id of the CPU to wake up.
+ */
+static void sched_tick_kick(const uint32_t cpu_id)
+{
+    OS_RETURN_E err;
+
+    if(tickless[cpu_id] == 0)
+    {
+        return;
+    }
+
+    err = send_sched_ipi(cpu_id);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not wake up CPU %d[%d]\n", cpu_id, err);
+        kernel_panic();
+    }
+}
+
+/* Wake up one of the CPUs which ticks are stopped so it can steal threads
+ * from the busy CPUs.
+ */
+static void sched_tick_kick_idle(void)
+{
+    uint32_t i;
+    uint32_t cpu_id = get_cpu_id();
+
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        if(tickless[i] == 1 && i != cpu_id)
+        {
+            sched_tick_kick(i);
+            return;
+        }
+    }
+}
+
+/* Stop the scheduler ticks of the idle CPU given as parameter. The timer is
+ * programmed for the next sleep wheel event. The main CPU drives the uptime,
+ * its ticks are only stopped when all the other CPUs are idle. The CPU run
+ * queue lock must be held.
+ *
+ * @param cpu_id The id of the idle CPU.
+ */
+static void sched_tick_stop(const uint32_t cpu_id)
+{
+    OS_RETURN_E err;
+    uint32_t    time_ms;
+    uint32_t    time_ns;
+    uint32_t    dl_ns;
+    uint32_t    i;
+
+    raw_lock(&sleep_lock);
+    time_ms = sleep_wheel_next(get_current_uptime());
+    raw_unlock(&sleep_lock);
+
+    time_ns = hr_sleep_next(cpu_id);
+    dl_ns   = dl_next_event(cpu_id);
+    if(dl_ns < time_ns)
+    {
+        time_ns = dl_ns;
+    }
+
+    /* Keep the ticks until the incoming threads are enqueued */
+    if(rq_incoming[cpu_id] != NULL)
+    {
+        return;
+    }
+
+    raw_lock(&tick_lock);
+    if(cpu_id == 0)
+    {
+        for(i = 1; i < MAX_CPU_COUNT; ++i)
+        {
+            if(idle_thread[i] != NULL && tickless[i] == 0)
+            {
+                raw_unlock(&tick_lock);
+                return;
+            }
+        }
+    }
+
+    /* The next high resolution wake up keeps its precision */
+    if((uint64_t)time_ns < (uint64_t)time_ms * 1000000ULL)
+    {
+        err = set_sched_timer_oneshot_ns(time_ns);
+    }
+    else
+    {
+        err = set_sched_timer_oneshot(time_ms);
+    }
+    if(err == OS_NO_ERR)
+    {
+        tickless[cpu_id] = 1;
+    }
+    raw_unlock(&tick_lock);
+
+    #ifdef DEBUG_SCHED
+    if(err == OS_NO_ERR)
+    {
+        kernel_serial_debug("CPU %d tickless for %dms\n", cpu_id, time_ms);
+    }
+    #endif
+}
+
+/* Restart the scheduler ticks of the CPU given as parameter if they were
+ * stopped. The main CPU is woken up if an other CPU gets work while the main
+ * CPU ticks are stopped. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU.
+ * @returns 1 if the ticks were stopped, 0 otherwise.
+ */
+static uint8_t sched_tick_resume(const uint32_t cpu_id)
+{
+    uint8_t main_tickless;
+
+    if(tickless[cpu_id] == 0)
+    {
+        return 0;
+    }
+
+    raw_lock(&tick_lock);
+    set_sched_timer_periodic();
+    tickless[cpu_id] = 0;
+    main_tickless    = tickless[0];
+    raw_unlock(&tick_lock);
+
+    if(main_tickless == 1)
+    {
+        sched_tick_kick(0);
+    }
+
+    return 1;
+}
+
+/* Set a thread ready to be executed. The thread is put in its run queue
+ * unless a CPU still executes it, in which case the CPU will put it in the
+ * queue when switching to an other thread. The thread run queue lock must be
+ * held.
+ *
+ * @param node The node containing the thread to set ready.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E thread_set_ready(kernel_list_node_t* node)
+{
+    OS_RETURN_E      err;
+    kernel_thread_t* thread = (kernel_thread_t*)node->data;
+
+    thread->state       = READY;
+    thread->ready_since = get_monotonic_ns();
+    thread->woken       = 1;
+
+    if(thread->cpu_id != -1)
+    {
+        return OS_NO_ERR;
+    }
+
+    err = rq_enqueue(thread->rq_cpu, node, thread->priority);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    /* Wake up the CPU if idle, an other idle CPU can steal the thread */
+    sched_tick_kick(thread->rq_cpu);
+    if(runqueues[thread->rq_cpu].length > 1)
+    {
+        sched_tick_kick_idle();
+    }
+
+    return OS_NO_ERR;
+}
+
+/* Initialize the thread stack so that the first schedule of the thread starts
+ * the thread wrapper. The stack holds an interrupted context returning to the
+ * thread wrapper and a switch_to frame returning to interrupt_return.
+ *
+ * @param thread The thread to initialize, its stack must be allocated.
+ * @param eflags The initial EFLAGS value of the thread.
+ */
+static void init_thread_context(kernel_thread_t* thread, const uint32_t eflags)
+{
+    uint32_t* stack = thread->kernel_stack.base;
+    uint32_t  top   = thread->kernel_stack.size / sizeof(uint32_t);
+
+    /* Init thread context */
+    thread->eip = (uint32_t) thread_wrapper;
+    thread->esp = (uint32_t)&stack[top - 23];
+    thread->ebp = (uint32_t)&stack[top - 1];
+
+    /* Init thread stack */
+    stack[top - 1] = eflags;
+    stack[top - 2] = THREAD_INIT_CS;
+    stack[top - 3] = thread->eip;
+    stack[top - 4] = 0; /* UNUSED (error core) */
+    stack[top - 5] = 0; /* UNUSED (int id) */
+    stack[top - 6] = THREAD_INIT_DS;
+    stack[top - 7] = THREAD_INIT_ES;
+    stack[top - 8] = THREAD_INIT_FS;
+    stack[top - 9] = THREAD_INIT_GS;
+    stack[top - 10] = THREAD_INIT_SS;
+    stack[top - 11] = THREAD_INIT_EAX;
+    stack[top - 12] = THREAD_INIT_EBX;
+    stack[top - 13] = THREAD_INIT_ECX;
+    stack[top - 14] = THREAD_INIT_EDX;
+    stack[top - 15] = THREAD_INIT_ESI;
+    stack[top - 16] = THREAD_INIT_EDI;
+    stack[top - 17] = thread->ebp;
+    stack[top - 18] = (uint32_t)&stack[top - 17];
+
+    /* Init switch_to frame */
+    stack[top - 19] = (uint32_t)interrupt_return;
+    stack[top - 20] = thread->ebp;
+    stack[top - 21] = THREAD_INIT_EBX;
+    stack[top - 22] = THREAD_INIT_ESI;
+    stack[top - 23] = THREAD_INIT_EDI;
+}
+
+/* INIT thread routine. In addition to the IDLE thread, the INIT thread is the
+ * last thread to run. The thread will gather all orphan thread and wait for
+ * their death before halting the system. The INIT thread routine is also
+ * responsible for calling the main function.
+ *
+ * @param args The argument to send to the INIT thread, usualy null.
+ * @return NULL always
+ */
+static void* init_func(void* args)
+{
+    OS_RETURN_E         err;
+    kernel_list_node_t* thread_node;
+    kernel_thread_t*    thread;
+    kernel_thread_t*    current;
+    char*               argv[2] = {"main", NULL};
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("INIT Started\n");
+    #endif
+
+    (void)args;
+
+    /* Interrupt handlers defer their work to the worker threads */
+    err = init_workqueues(WORKQUEUE_THREAD_PRIORITY);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Error while creating worker threads [%d]\n", err);
+        kernel_panic();
+    }
+
+    err = init_thread_pool(THREAD_POOL_PRIORITY);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Error while creating thread pool [%d]\n", err);
+        kernel_panic();
+    }
+
+#ifdef TESTS
+    test_sched_fair();
+    test_tls();
+    test_mutex_pi();
+    test_sched_sleep();
+    test_sched_wheel();
+    test_sched_affinity();
+    test_sched_balance();
+    test_sched_deadline();
+    test_sched_period();
+    test_sched_accounting();
+    test_sched_hist();
+    test_sched_teardown();
+    test_mutex_adaptive();
+    test_futex_contended();
+    test_workqueue();
+    test_fpu();
+#endif
+
+    /* Call main */
+    main(1, argv);
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Main returned, INIT waiting for children\n");
+    #endif
+
+    /* The worker threads are joined when stopped */
+    err = stop_workqueues();
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Error while stopping worker threads [%d]\n", err);
+        kernel_panic();
+    }
+
+    err = stop_thread_pool();
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Error while stopping thread pool [%d]\n", err);
+        kernel_panic();
+    }
+
+    current = get_current_thread();
+
+    disable_local_interrupt();
+    raw_lock(&sched_lock);
+
+    /* Wait all children, only the IDLE threads and INIT should remain */
+    while(thread_count > idle_thread_count + 1)
+    {
+        thread_node = kernel_list_delist_data(current->children, &err);
+        while(thread_node != NULL && err == OS_NO_ERR)
+        {
+            raw_unlock(&sched_lock);
+            enable_local_interrupt();
+
+            thread = (kernel_thread_t*)thread_node->data;
+
+            /* The thread children node is released when it is joined */
+            err = wait_thread(thread, NULL);
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Error while waiting thread in INIT [%d]\n", err);
+                kernel_panic();
+            }
+
+            disable_local_interrupt();
+            raw_lock(&sched_lock);
+
+            thread_node = kernel_list_delist_data(current->children, &err);
+        }
+
+        /* Let the other threads run until new orphans are inherited */
+        if(thread_count > idle_thread_count + 1)
+        {
+            raw_unlock(&sched_lock);
+            enable_local_interrupt();
+
+            schedule();
+
+            disable_local_interrupt();
+            raw_lock(&sched_lock);
+        }
+    }
+    raw_unlock(&sched_lock);
+    enable_local_interrupt();
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("INIT Ended\n");
+    #endif
+
+    /* If here, the system is halted */
+    system_state = HALTED;
+
+    return NULL;
+}
+
+/* IDLE thread routine. This thread should always be ready, it is the only
+ * threa running when no other trhread are ready. It allows better power
+ * consumption management. The IDLE thread launches the INIT thread before
+ * idling forever.
+ *
+ * @param args The argument to send to the IDLE thread, usualy null.
+ * @return NULL always, should never return.
+ */
+static void* idle_sys(void* args)
+{
+    OS_RETURN_E   err;
+    colorscheme_t buffer;
+    colorscheme_t new_scheme;
+    int8_t        notify = 0;
+
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("IDLE Started\n");
+    #endif
+
+    kernel_printf("\nWelcome to ");
+
+    new_scheme.foreground = FG_CYAN;
+    new_scheme.background = BG_BLACK;
+    new_scheme.vga_color  = 1;
+
+    /* No need to test return value */
+    save_color_scheme(&buffer);
+
+    /* Set REG on BLACK color scheme */
+    set_color_scheme(new_scheme);
+
+    /* Print tag */
+    kernel_printf("AWK\n\n");
+
+    /* Restore original screen color scheme */
+    set_color_scheme(buffer);
+
+    /* We create the init thread */
+    err = create_thread(&init_thread, init_func,
+                        KERNEL_HIGHEST_PRIORITY, "init", args);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Error while creating INIT thread [%d]\n", err);
+        kernel_panic();
+    }
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("INIT Created\n");
+    #endif
+
+
+    /* Halt forever, hlt for energy consumption */
+    while(1 < 2)
+    {
+        enable_local_interrupt();
+        if(system_state == HALTED && notify == 0)
+        {
+            notify = 1;
+            kernel_info("System HALTED");
+            disable_local_interrupt();
+        }
+        hlt();
+    }
+
+    /* If we return better go away and cry in a corner */
+    return NULL;
+}
+
+/* IDLE thread routine of the application processors. The thread is only
+ * executed when no other thread is ready.
+ *
+ * @param args The argument to send to the IDLE thread, usualy null.
+ * @return NULL always, should never return.
+ */
+static void* ap_idle_sys(void* args)
+{
+    (void)args;
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("CPU %d IDLE Started\n", get_cpu_id());
+    #endif
+
+    /* Halt forever, hlt for energy consumption */
+    while(1 < 2)
+    {
+        enable_local_interrupt();
+        hlt();
+    }
+
+    /* If we return better go away and cry in a corner */
+    return NULL;
+}
+
+/* Exit point of a thread. The function will release the resources of the thread
+ * and manage its children (INIT will inherit them). Put the thread in a ZOMBIE
+ * state. If an other thread is already joining the active thread, then the
+ * joining thread will switch from blocked to ready state.
+ */
+static void thread_exit(void)
+{
+    OS_RETURN_E         err;
+    kernel_thread_t*    thread;
+    kernel_thread_t*    current;
+    kernel_list_node_t* current_node;
+    kernel_thread_t*    joining_thread = NULL;
+    kernel_list_node_t* node;
+    uint32_t            cpu_id;
+    uint32_t            joining_cpu_id;
+
+    disable_local_interrupt();
+
+    cpu_id       = get_cpu_id();
+    current      = active_thread[cpu_id];
+    current_node = active_thread_node[cpu_id];
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Exit thread %d\n", current->pid);
+    #endif
+
+    raw_lock(&sched_lock);
+
+    if(current == init_thread)
+    {
+        raw_lock(&runqueues[cpu_id].lock);
+        current->state = ZOMBIE;
+        raw_unlock(&runqueues[cpu_id].lock);
+        raw_unlock(&sched_lock);
+        enable_local_interrupt();
+
+        /* Schedule thread, should never return since the state is zombie */
+        schedule();
+
+        return;
+    }
+
+    if(current->joining_thread != NULL)
+    {
+        joining_thread = (kernel_thread_t*)current->joining_thread->data;
+    }
+
+    if(joining_thread != NULL)
+    {
+        joining_cpu_id = thread_lock_rq(joining_thread);
+        if(joining_thread->state == JOINING)
+        {
+            #ifdef DEBUG_SCHED
+            kernel_serial_debug("Woke up joining thread %d\n",
+                joining_thread->pid);
+            #endif
+
+            err = thread_set_ready(current->joining_thread);
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not enqueue joining thread[%d]\n", err);
+                kernel_panic();
+            }
+        }
+        raw_unlock(&runqueues[joining_cpu_id].lock);
+    }
+
+    /* Release the deadline class bandwidth */
+    if(current->dl_period != 0)
+    {
+        dl_bandwidth[current->dl_cpu] -= current->dl_bw;
+    }
+
+    /* Set new thread state */
+    raw_lock(&runqueues[cpu_id].lock);
+    current->state = ZOMBIE;
+    raw_unlock(&runqueues[cpu_id].lock);
+
+    err = kernel_list_enlist_data(current_node, zombie_threads_table, 0);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not enqueue zombie thread[%d]\n", err);
+        kernel_panic();
+    }
+
+    /* All the children of the thread are inherited by init */
+    node = kernel_list_delist_data(current->children, &err);
+    while(node != NULL && err == OS_NO_ERR)
+    {
+        thread = (kernel_thread_t*)node->data;
+        thread->ppid   = init_thread->pid;
+        thread->parent = init_thread;
+
+        if(thread->joining_thread != NULL &&
+           thread->joining_thread->data == current)
+        {
+            thread->joining_thread->data = NULL;
+        }
+
+        err = kernel_list_enlist_data(node, init_thread->children, 0);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not enqueue thread to init[%d]\n", err);
+            kernel_panic();
+        }
+
+        node = kernel_list_delist_data(current->children, &err);
+    }
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not dequeue thread from children[%d]\n", err);
+        kernel_panic();
+    }
+
+    /* Delete lsit */
+    err = kernel_list_delete_list(&current->children);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not delete lsit of children[%d]\n", err);
+        kernel_panic();
+    }
+
+    raw_unlock(&sched_lock);
+    enable_local_interrupt();
+
+    /* Schedule thread */
+    schedule();
+}
+
+/* Thread launch routine. Wrapper for the actual thread routine. The wrapper
+ * will call the thread routine, pass its arguments and gather the return value
+ * of the thread function to allow the joining thread to retreive it.
+ * Some statistics about the thread might be added in this function.
+ */
+static void thread_wrapper(void)
+{
+    kernel_thread_t* current = get_current_thread();
+
+    /* STAT PROBE OR SOMETHING */
+    current->start_time = get_current_uptime();
+
+    if(current->function == NULL)
+    {
+        kernel_error("Thread routine cannot be NULL\n");
+        kernel_panic();
+    }
+    current->ret_val = current->function(current->args);
+
+    current->end_time = get_current_uptime();
+    current->exec_time = current->end_time -
+                         current->start_time;
+
+    /* Exit thread properly */
+    thread_exit();
+}
+
+/* Clean a thread that is currently being joined by the curent active thread.
+ * Remove the thread from all lists and celan the lists nodes. Scheduler lock
+ * should be locked before calling this function.
+ *
+ * @param thread The thread to clean.
+ */
+static void clean_joined_thread(kernel_thread_t* thread)
+{
+    OS_RETURN_E         err;
+
+    /* Remove node from its parent children table, INIT delists its children
+     * before joining them.
+     */
+    if(thread->child_node->enlisted != 0)
+    {
+        err = kernel_list_unlink_node(thread->parent->children,
+                                      thread->child_node);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could delete thread node in children table[%d]\n",
+                         err);
+            kernel_panic();
+        }
+    }
+    err = kernel_list_delete_node(&thread->child_node);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could delete thread node[%d]\n", err);
+        kernel_panic();
+    }
+
+    /* Remove node from zombie table */
+    if(thread->sched_node->enlisted != 0)
+    {
+        err = kernel_list_unlink_node(zombie_threads_table, thread->sched_node);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could delete thread node in zombie table[%d]\n",
+                         err);
+            kernel_panic();
+        }
+    }
+    err = kernel_list_delete_node(&thread->sched_node);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could delete thread node[%d]\n", err);
+        kernel_panic();
+    }
+
+    /* Remove node from general table */
+    err = kernel_list_unlink_node(global_threads_table, thread->global_node);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could delete thread node in general table[%d]\n",
+                     err);
+        kernel_panic();
+    }
+    err = kernel_list_delete_node(&thread->global_node);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could delete thread node[%d]\n", err);
+        kernel_panic();
+    }
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Thread %d joined thread %d\n",
+                         active_thread[get_cpu_id()]->pid,
+                         thread->pid);
+    #endif
+
+    err = stack_pool_free(&thread->kernel_stack);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not release thread stack[%d]\n", err);
+        kernel_panic();
+    }
+    kmem_cache_free(&thread_cache, thread);
+
+    --thread_count;
+
+}
+
+void sched_hist_add(sched_histogram_t* hist, const uint64_t value)
+{
+    uint32_t bucket;
+
+    if(value == 0)
+    {
+        bucket = 0;
+    }
+    else if((value >> 32) != 0)
+    {
+        bucket = SCHEDULE_HIST_BUCKETS - 1;
+    }
+    else
+    {
+        bucket = cpu_bsr((uint32_t)value) + 1;
+        if(bucket >= SCHEDULE_HIST_BUCKETS)
+        {
+            bucket = SCHEDULE_HIST_BUCKETS - 1;
+        }
+    }
+
+    ++hist->buckets[bucket];
+    ++hist->count;
+    if(value > hist->max)
+    {
+        hist->max = ((value >> 32) != 0) ? 0xFFFFFFFF : (uint32_t)value;
+    }
+}
+
+/* Set the old_thread and active_thread pointers of the CPU given as parameter.
+ * The function will select the next most prioritary thread to be executed.
+ * This function also wake up sleeping thread which wake-up time has been
+ * reached. If the CPU run queue is empty, a thread is stolen from the busiest
+ * CPU. The CPU run queue lock must be held.
+ *
+ * @param cpu_id The id of the CPU to select a thread for.
+ */
+static void select_thread(const uint32_t cpu_id)
+{
+    OS_RETURN_E         err;
+    kernel_thread_t*    old;
+    kernel_thread_t*    new;
+    uint64_t            now;
+    uint8_t             preempted;
+
+    /* Switch running thread */
+    old_thread[cpu_id]      = active_thread[cpu_id];
+    old_thread_node[cpu_id] = active_thread_node[cpu_id];
+    old = old_thread[cpu_id];
+
+    /* One TSC read times the whole switch. A thread leaving the CPU while
+     * still executing was preempted or yielded, otherwise it blocked, slept
+     * or exited.
+     */
+    now       = get_monotonic_ns();
+    preempted = (old->state == RUNNING && old != idle_thread[cpu_id]);
+
+    if(old->dl_period != 0)
+    {
+        dl_charge(old, now);
+    }
+    else if(old->policy == SCHED_POLICY_FAIR)
+    {
+        fair_charge(old, now);
+    }
+
+    /* The first schedule of a CPU does not come from its IDLE thread */
+    if(old->run_since != 0)
+    {
+        old->cpu_time += now - old->run_since;
+    }
+    old->run_since = 0;
+
+    if(old == idle_thread[cpu_id])
+    {
+        /* IDLE threads are never stored in the run queues */
+        old->state = READY;
+    }
+    /* If the thread was not locked or was woken up before leaving the CPU */
+    else if(old->state == RUNNING || old->state == READY)
+    {
+        old->state       = READY;
+        old->ready_since = now;
+
+        /* The CPU is no longer allowed, the thread context is saved before
+         * the run queue lock is released
+         */
+        if((old->affinity & THREAD_AFFINITY_CPU(cpu_id)) == 0)
+        {
+            rq_migrate(old, cpu_id);
+        }
+        else if(old->dl_period != 0)
+        {
+            /* A preempted deadline thread keeps its period */
+            dl_enqueue(cpu_id, old, 0);
+        }
+        else
+        {
+            /* A preempted fair thread keeps its virtual runtime */
+            if(old->policy == SCHED_POLICY_FAIR)
+            {
+                err = fair_enqueue(cpu_id, old, 0);
+            }
+            else
+            {
+                err = rq_enqueue(cpu_id, old_thread_node[cpu_id],
+                                 old->priority);
+            }
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not enqueue old thread[%d]\n", err);
+                kernel_panic();
+            }
+        }
+    }
+    else if(old->state == SLEEPING && old->wakeup_ns != 0)
+    {
+        /* High resolution sleeps stay on the CPU */
+        hr_sleep_insert(cpu_id, old);
+    }
+    else if(old->state == SLEEPING)
+    {
+        raw_lock(&sleep_lock);
+        err = sleep_wheel_insert(old_thread_node[cpu_id]);
+        if(err == OS_NO_ERR)
+        {
+            ++sleeping_count;
+        }
+        raw_unlock(&sleep_lock);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not enqueue old thread[%d]\n", err);
+            kernel_panic();
+        }
+    }
+    old->cpu_id = -1;
+
+    /* Wake up the sleeping threads, they join the local run queue */
+    raw_lock(&sleep_lock);
+    sleep_wheel_expire(cpu_id, get_current_uptime(), now);
+    raw_unlock(&sleep_lock);
+    hr_sleep_expire(cpu_id, now);
+    dl_replenish(cpu_id);
+
+    /* Enqueue the threads moved to the CPU */
+    rq_drain_incoming(cpu_id);
+    fair_update_min(cpu_id);
+
+    sched_hist_add(&sched_stats[cpu_id].rq_depth, runqueues[cpu_id].length);
+
+    /* Get the new thread, the deadline threads come first. Steal one if the
+     * run queue is empty. The CPU IDLE thread runs if no thread is ready.
+     */
+    active_thread_node[cpu_id] = dl_dequeue(cpu_id);
+    if(active_thread_node[cpu_id] == NULL)
+    {
+        active_thread_node[cpu_id] = rq_dequeue(cpu_id, cpu_id, &err);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not dequeue next thread[%d]\n", err);
+            kernel_panic();
+        }
+    }
+    if(active_thread_node[cpu_id] == NULL)
+    {
+        active_thread_node[cpu_id] = rq_steal(cpu_id, 1);
+    }
+    if(active_thread_node[cpu_id] == NULL)
+    {
+        active_thread_node[cpu_id] = idle_thread_node[cpu_id];
+    }
+
+    active_thread[cpu_id] = (kernel_thread_t*)active_thread_node[cpu_id]->data;
+    new = active_thread[cpu_id];
+
+    if(new == NULL)
+    {
+        kernel_error("Next thread to schedule should not be NULL\n");
+        kernel_panic();
+    }
+    new->state  = RUNNING;
+    new->cpu_id = cpu_id;
+
+    /* The IDLE threads never wait in the run queues, their executions are
+     * not timed.
+     */
+    if(new != old)
+    {
+        if(preempted == 1)
+        {
+            ++old->involuntary_switches;
+        }
+        else
+        {
+            ++old->voluntary_switches;
+        }
+
+        if(old != idle_thread[cpu_id] && old->slice_start != 0)
+        {
+            sched_hist_add(&sched_stats[cpu_id].timeslice[old->priority /
+                                                   SCHEDULE_HIST_BAND_SIZE],
+                           now - old->slice_start);
+        }
+
+        if(new != idle_thread[cpu_id] && now > new->ready_since)
+        {
+            new->ready_time += now - new->ready_since;
+            if(new->woken == 1)
+            {
+                sched_hist_add(&sched_stats[cpu_id].wakeup_latency[
+                                   new->priority / SCHEDULE_HIST_BAND_SIZE],
+                               now - new->ready_since);
+            }
+        }
+
+        new->slice_start = now;
+    }
+    new->woken = 0;
+
+    /* 0 means the thread is not executing, the 1ns error is negligible */
+    new->run_since = now | 1;
+    if(new->dl_period != 0)
+    {
+        new->dl_exec_start = now | 1;
+    }
+    else if(new->policy == SCHED_POLICY_FAIR)
+    {
+        new->fair_exec_start = now | 1;
+    }
+}
+
+/* Prepare the switch of the CPU given as parameter to its next thread. The
+ * priorities are updated, the next thread is selected and the FPU context is
+ * switched. The CPU run queue lock must be held and local interrupts must be
+ * disabled.
+ *
+ * @param cpu_id The id of the CPU to prepare the switch of.
+ * @param int_id The interrupt that triggered the schedule,
+ * SCHEDULER_SW_INT_LINE for voluntary switches.
+ * @returns The location where the current stack pointer is saved.
+ */
+static uint32_t* schedule_prepare(const uint32_t cpu_id, const uint32_t int_id)
+{
+    uint32_t* save_esp;
+
+#if SCHEDULE_DYN_PRIORITY
+    if(active_thread[cpu_id] != idle_thread[cpu_id] &&
+       active_thread[cpu_id] != init_thread)
+    {
+        if(int_id == sched_hw_int_line)
+        {
+            /* Here the thread consumed all its time slice so it get its init
+             * priority, or the priority it inherited if higher.
+             */
+            if(active_thread[cpu_id]->inherited_prio <
+               active_thread[cpu_id]->init_prio)
+            {
+                active_thread[cpu_id]->priority =
+                    active_thread[cpu_id]->inherited_prio;
+            }
+            else
+            {
+                active_thread[cpu_id]->priority =
+                    active_thread[cpu_id]->init_prio;
+            }
+        }
+        /* The ready threads of the run queue get one epoch older, their
+         * priority is upgraded by 1 every SCHEDULE_AGING_PERIOD epochs when
+         * they are dequeued, see rq_aged_priority.
+         */
+        ++runqueues[cpu_id].epoch;
+    }
+
+#endif /* SCHEDULE_DYN_PRIORITY */
+
+    /* Periodically pull work from the busiest CPU */
+    if(int_id == sched_hw_int_line &&
+       ++balance_tick[cpu_id] >= SCHEDULE_BALANCE_PERIOD)
+    {
+        balance_tick[cpu_id] = 0;
+        rq_balance(cpu_id);
+    }
+
+    /* If not first schedule */
+    if(first_schedule[cpu_id] == 1)
+    {
+        save_esp = &active_thread[cpu_id]->esp;
+
+        /* Search for next thread */
+        select_thread(cpu_id);
+
+        /* The FPU state is only restored when the thread uses it */
+        fpu_switch(&old_thread[cpu_id]->fpu, &active_thread[cpu_id]->fpu);
+    }
+    else
+    {
+        first_schedule[cpu_id] = 1;
+        save_esp = &boot_esp[cpu_id];
+
+        fpu_switch(&active_thread[cpu_id]->fpu, &active_thread[cpu_id]->fpu);
+    }
+
+    /* Pages unmapped by an other CPU may still be in the TLB, a thread stack
+     * guard page must fault before the thread executes
+     */
+    kernel_tlb_sync(cpu_id);
+
+    if(active_thread[cpu_id] != old_thread[cpu_id])
+    {
+        thread_set_local(active_thread[cpu_id]);
+    }
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("CPU %d Sched %d -> %d\n",
+                         cpu_id,
+                         old_thread[cpu_id]->pid,
+                         active_thread[cpu_id]->pid);
+    #endif
+
+    return save_esp;
+}
+
+/* Switch the CPU given as parameter to its active thread and release the run
+ * queue lock once the current stack is not used anymore. The function returns
+ * when the current thread is scheduled again.
+ *
+ * @param cpu_id The id of the CPU to switch.
+ * @param save_esp The location where the current stack pointer is saved.
+ * @param rq_lock The CPU run queue lock.
+ */
+static void schedule_switch(const uint32_t cpu_id, uint32_t* save_esp,
+                            volatile uint32_t* rq_lock)
+{
+    /* The same thread is selected again, nothing to switch */
+    if(save_esp == &active_thread[cpu_id]->esp)
+    {
+        raw_unlock(rq_lock);
+        return;
+    }
+
+    switch_to(save_esp, active_thread[cpu_id]->esp, rq_lock);
+}
+
+/* !!! THIS FUNCTION SHOULD NEVER BE CALLED OUTSIDE OF AN INTERRUPT !!!
+ * Preemptive scheduling function. The interrupted context stays on the current
+ * thread stack, the function switches to the next thread with switch_to and
+ * the context is restored by the interrupt handler when the thread is
+ * scheduled again. The function also manages the interrupt acknowledgment.
+ */
+static void schedule_int(cpu_state_t *cpu_state, uint32_t int_id,
+                         stack_state_t *stack_state)
+{
+    OS_RETURN_E        err;
+    uint32_t           cpu_id;
+    uint8_t            was_tickless;
+    uint8_t            was_armed;
+    uint32_t*          save_esp;
+    volatile uint32_t* rq_lock;
+
+    (void) cpu_state;
+    (void) stack_state;
+
+    if(get_local_interrupt_enabled() != 1)
+    {
+        kernel_error("Interrupts should not be disabled when calling the\
+ scheduler\n");
+        kernel_panic();
+    }
+
+    cpu_id  = get_cpu_id();
+    rq_lock = &runqueues[cpu_id].lock;
+
+    /* The lock is released once the CPU left the old thread stack */
+    raw_lock(rq_lock);
+
+    /* The CPU has work again, restart its ticks */
+    was_tickless = sched_tick_resume(cpu_id);
+    was_armed    = sched_hrtimer_cancel(cpu_id);
+
+    /* A high resolution wake up does not end the time slice */
+    if(was_armed == 1 && int_id == sched_hw_int_line)
+    {
+        save_esp = schedule_prepare(cpu_id, SCHEDULER_SW_INT_LINE);
+    }
+    else
+    {
+        save_esp = schedule_prepare(cpu_id, int_id);
+    }
+
+    if(int_id == sched_hw_int_line)
+    {
+        /* Update TIMER tick count, the main CPU timer drives the uptime. The
+         * time spent without ticks was accounted when they restarted.
+         */
+        if(cpu_id == 0 && was_tickless == 0 && was_armed == 0)
+        {
+            update_tick();
+        }
+
+        /* Send EOI signal */
+        err = set_IRQ_EOI(sched_irq);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not EIO scheduler timer[%d]\n", err);
+            kernel_panic();
+        }
+    }
+
+    else if(int_id == SCHEDULER_IPI_INT_LINE)
+    {
+        err = set_IRQ_EOI(int_id);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not EIO scheduler IPI[%d]\n", err);
+            kernel_panic();
+        }
+    }
+
+    /* Stop the ticks while the CPU is idle */
+    if(active_thread[cpu_id] == idle_thread[cpu_id])
+    {
+        sched_tick_stop(cpu_id);
+    }
+    sched_hrtimer_arm(cpu_id);
+
+    schedule_switch(cpu_id, save_esp, rq_lock);
+}
+
+/* Create the IDLE thread of the CPU given as parameter and set it as the CPU
+ * active thread. The IDLE thread is never stored in the active threads table,
+ * it is only executed when no other thread is ready. Scheduler lock must be
+ * held when application processors are running.
+ *
+ * @param cpu_id The id of the CPU to create the IDLE thread for.
+ */
+static void create_idle_thread(const uint32_t cpu_id)
+{
+    OS_RETURN_E         err;
+    kernel_thread_t*    thread;
+    kernel_list_node_t* second_idle_thread_node;
+
+    /* Create idle thread */
+    thread = kmem_cache_alloc(&thread_cache);
+    idle_thread_node[cpu_id] = kernel_list_create_node(thread, &err);
+
+    if(err != OS_NO_ERR || thread == NULL || idle_thread_node[cpu_id] == NULL)
+    {
+        kernel_error("Could not create IDLE thread\n");
+        kernel_panic();
+    }
+
+    thread_clear(thread);
+
+    /* Init thread settings, the main CPU IDLE thread is the first thread */
+    if(cpu_id != 0)
+    {
+        ++last_given_pid;
+    }
+    thread->pid            = last_given_pid;
+    thread->ppid           = 0;
+    thread->priority       = IDLE_THREAD_PRIORITY;
+    thread->init_prio      = IDLE_THREAD_PRIORITY;
+    thread->args           = 0;
+    thread->function       = (cpu_id == 0) ? idle_sys : ap_idle_sys;
+    thread->joining_thread = NULL;
+    thread->state          = RUNNING;
+    thread->cpu_id         = cpu_id;
+    thread->rq_cpu         = cpu_id;
+    thread->parent         = NULL;
+    thread->sched_node     = idle_thread_node[cpu_id];
+    thread->inherited_prio = KERNEL_LOWEST_PRIORITY;
+    thread->affinity       = THREAD_AFFINITY_CPU(cpu_id);
+
+    thread->children = kernel_list_create_list(&err);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not create children table[%d]\n", err);
+        kernel_panic();
+    }
+
+    err = stack_pool_alloc(THREAD_STACK_SIZE, &thread->kernel_stack);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not allocate IDLE thread stack[%d]\n", err);
+        kernel_panic();
+    }
+
+    /* Interrupts are enabled by the IDLE routine */
+    init_thread_context(thread, 0x00000002);
+
+    strncpy(thread->name, "idle\0", 5);
+
+    idle_thread[cpu_id]        = thread;
+    active_thread[cpu_id]      = thread;
+    active_thread_node[cpu_id] = idle_thread_node[cpu_id];
+    old_thread[cpu_id]         = thread;
+    old_thread_node[cpu_id]    = idle_thread_node[cpu_id];
+
+    /* The function is executed by the CPU the IDLE thread belongs to */
+    thread_set_local(thread);
+
+    ++thread_count;
+    ++idle_thread_count;
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("CPU %d IDLE thread created\n", cpu_id);
+    #endif
+
+    second_idle_thread_node = kernel_list_create_node(thread, &err);
+
+    if(err != OS_NO_ERR || second_idle_thread_node == NULL)
+    {
+        kernel_error("Could not create second IDLE thread node\n");
+        kernel_panic();
+    }
+
+    thread->global_node = second_idle_thread_node;
+
+    err = kernel_list_enlist_data(second_idle_thread_node, global_threads_table,
+                                  thread->priority);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not enqueue thread in global table[%d]\n", err);
+        kernel_panic();
+    }
+}
+
+SYSTEM_STATE_E get_system_state(void)
+{
+    return system_state;
+}
+
+OS_RETURN_E init_scheduler(void)
+{
+    OS_RETURN_E err;
+    uint32_t    i;
+    uint32_t    j;
+
+    /* Init scheduler settings */
+    last_given_pid    = 0;
+    thread_count      = 0;
+    idle_thread_count = 0;
+    sched_lock        = 0;
+    sleep_lock        = 0;
+    tick_lock         = 0;
+    scheduler_started = 0;
+
+    init_thread      = NULL;
+    init_thread_node = NULL;
+
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        first_schedule[i]     = 0;
+        balance_tick[i]       = 0;
+        tickless[i]           = 0;
+        idle_thread[i]        = NULL;
+        idle_thread_node[i]   = NULL;
+        active_thread[i]      = NULL;
+        active_thread_node[i] = NULL;
+        old_thread[i]         = NULL;
+        old_thread_node[i]    = NULL;
+    }
+
+    /* Init thread tables */
+    global_threads_table     = kernel_list_create_list(&err);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not create global_threads_table[%d]\n", err);
+        kernel_panic();
+    }
+    memset(runqueues, 0, sizeof(runqueues));
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        for(j = 0; j <= KERNEL_LOWEST_PRIORITY; ++j)
+        {
+            runqueues[i].table[j] = kernel_list_create_list(&err);
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not create run queue[%d]\n", err);
+                kernel_panic();
+            }
+        }
+    }
+    zombie_threads_table     = kernel_list_create_list(&err);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not create zombie_threads_table[%d]\n", err);
+        kernel_panic();
+    }
+    for(i = 0; i < SLEEP_WHEEL_LEVELS; ++i)
+    {
+        for(j = 0; j < SLEEP_WHEEL_SIZE; ++j)
+        {
+            sleep_wheel[i][j] = kernel_list_create_list(&err);
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not create sleep wheel[%d]\n", err);
+                kernel_panic();
+            }
+        }
+    }
+    sleep_wheel_time = get_current_uptime();
+    sleeping_count   = 0;
+
+    /* Create the main CPU idle thread */
+    create_idle_thread(0);
+
+    system_state = RUNNING;
+
+    sched_irq         = (uint32_t)get_IRQ_SCHED_TIMER();
+    sched_hw_int_line = (uint32_t)get_line_SCHED_HW();
 
     /* Register SW interrupt scheduling */
     err = register_interrupt_handler(SCHEDULER_SW_INT_LINE, schedule_int);
@@ -845,8 +2886,37 @@ OS_RETURN_E init_scheduler(void)
         return err;
     }
 
+    /* Register the IPI used to wake up the CPUs which ticks are stopped */
+    err = register_interrupt_handler(SCHEDULER_IPI_INT_LINE, schedule_int);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
     kernel_success("SCHEDULER Initialized\n");
 
+    /* Release the application processors */
+    scheduler_started = 1;
+
+    enable_local_interrupt();
+
+    schedule();
+
+    /* We should never return fron this function */
+    return OS_ERR_UNAUTHORIZED_ACTION;
+}
+
+OS_RETURN_E init_ap_scheduler(void)
+{
+    uint32_t cpu_id = get_cpu_id();
+
+    /* Wait for the main CPU to init the scheduler */
+    while(scheduler_started == 0);
+
+    raw_lock(&sched_lock);
+    create_idle_thread(cpu_id);
+    raw_unlock(&sched_lock);
+
     enable_local_interrupt();
 
     schedule();
@@ -857,24 +2927,124 @@ OS_RETURN_E init_scheduler(void)
 
 void schedule(void)
 {
-    /* Raise scheduling interrupt */
-    __asm__ __volatile__("int %0" :: "i" (SCHEDULER_SW_INT_LINE));
+    uint32_t           cpu_id;
+    uint32_t           flags;
+    uint32_t*          save_esp;
+    volatile uint32_t* rq_lock;
+
+    if(get_local_interrupt_enabled() != 1)
+    {
+        kernel_error("Interrupts should not be disabled when calling the\
+ scheduler\n");
+        kernel_panic();
+    }
+
+    /* Mask the interrupts as an interrupt gate would, the interrupts nesting
+     * level is left untouched since the thread can be resumed by an interrupt
+     * return.
+     */
+    flags = save_flags();
+    cli();
+
+    cpu_id  = get_cpu_id();
+    rq_lock = &runqueues[cpu_id].lock;
+
+    /* The lock is released once the CPU left the old thread stack */
+    raw_lock(rq_lock);
+
+    sched_tick_resume(cpu_id);
+    sched_hrtimer_cancel(cpu_id);
+
+    save_esp = schedule_prepare(cpu_id, SCHEDULER_SW_INT_LINE);
+
+    /* Stop the ticks while the CPU is idle */
+    if(active_thread[cpu_id] == idle_thread[cpu_id])
+    {
+        sched_tick_stop(cpu_id);
+    }
+    sched_hrtimer_arm(cpu_id);
+
+    schedule_switch(cpu_id, save_esp, rq_lock);
+
+    /* The thread may have been resumed on an other CPU */
+    restore_flags(flags);
 }
 
 OS_RETURN_E sleep(const unsigned int time_ms)
 {
+    kernel_thread_t* current;
+    uint32_t         cpu_id;
+
+    disable_local_interrupt();
+
+    cpu_id  = get_cpu_id();
+    current = active_thread[cpu_id];
+
+    /* We cannot sleep in idle */
+    if(current == idle_thread[cpu_id])
+    {
+        enable_local_interrupt();
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    raw_lock(&runqueues[cpu_id].lock);
+
+    current->wakeup_time = get_current_uptime() + time_ms;
+    current->state = SLEEPING;
+
+    raw_unlock(&runqueues[cpu_id].lock);
+    enable_local_interrupt();
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("%d Thread %d asleep until %d\n", get_current_uptime(),
+                        current->pid, current->wakeup_time);
+    #endif
+
+    schedule();
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E nanosleep(const uint64_t time_ns)
+{
+    return nanosleep_until(get_monotonic_ns() + time_ns);
+}
+
+OS_RETURN_E usleep(const uint32_t time_us)
+{
+    return nanosleep((uint64_t)time_us * 1000ULL);
+}
+
+OS_RETURN_E nanosleep_until(const uint64_t wakeup_ns)
+{
+    kernel_thread_t* current;
+    uint32_t         cpu_id;
+
+    disable_local_interrupt();
+
+    cpu_id  = get_cpu_id();
+    current = active_thread[cpu_id];
+
     /* We cannot sleep in idle */
-    if(active_thread == idle_thread)
+    if(current == idle_thread[cpu_id])
     {
+        enable_local_interrupt();
         return OS_ERR_UNAUTHORIZED_ACTION;
     }
 
-    active_thread->wakeup_time = get_current_uptime() + time_ms;
-    active_thread->state = SLEEPING;
+    raw_lock(&runqueues[cpu_id].lock);
+
+    /* 0 means a sleep on the sleep wheel */
+    current->wakeup_ns = (wakeup_ns != 0) ? wakeup_ns : 1;
+    current->state     = SLEEPING;
+
+    raw_unlock(&runqueues[cpu_id].lock);
+    enable_local_interrupt();
 
     #ifdef DEBUG_SCHED
-    kernel_serial_debug("%d Thread %d asleep until %d\n", get_current_uptime(), active_thread->pid,
-                        active_thread->wakeup_time );
+    kernel_serial_debug("%d Thread %d asleep until %dns\n",
+                        get_current_uptime(), current->pid,
+                        (uint32_t)wakeup_ns);
     #endif
 
     schedule();
@@ -882,6 +3052,75 @@ OS_RETURN_E sleep(const unsigned int time_ms)
     return OS_NO_ERR;
 }
 
+OS_RETURN_E thread_period_init(thread_period_t* period,
+                               const uint32_t period_us)
+{
+    if(period == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    /* The period in ns must fit 32 bits */
+    if(period_us == 0 || period_us > 0xFFFFFFFF / 1000)
+    {
+        return OS_ERR_OUT_OF_BOUND;
+    }
+
+    period->period       = period_us * 1000;
+    period->next_release = get_monotonic_ns() + period->period;
+    period->releases     = 0;
+    period->overruns     = 0;
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E thread_period_wait(thread_period_t* period)
+{
+    OS_RETURN_E err;
+    uint64_t    now;
+    uint64_t    late;
+    uint32_t    missed;
+
+    if(period == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    /* A call made at the release time is on time */
+    now = get_monotonic_ns();
+    if(now > period->next_release)
+    {
+        late = now - period->next_release;
+
+        /* The missed releases are skipped, a thread late by more than 2^16
+         * periods restarts its timeline
+         */
+        if(late < ((uint64_t)period->period << 16))
+        {
+            missed = cpu_udiv_64_32(late, period->period) + 1;
+            period->next_release += (uint64_t)missed * period->period;
+        }
+        else
+        {
+            missed               = 1;
+            period->next_release = now + period->period;
+        }
+        period->overruns += missed;
+
+        #ifdef DEBUG_SCHED
+        kernel_serial_debug("Thread %d overrun, %d releases missed\n",
+                            get_pid(), missed);
+        #endif
+    }
+
+    err = nanosleep_until(period->next_release);
+
+    ++period->releases;
+    period->next_release += period->period;
+
+    return err;
+}
+
 uint32_t get_thread_count(void)
 {
     return thread_count;
@@ -889,17 +3128,17 @@ uint32_t get_thread_count(void)
 
 int32_t get_pid(void)
 {
-    return active_thread->pid;
+    return get_current_thread()->pid;
 }
 
 int32_t get_ppid(void)
 {
-    return active_thread->ppid;
+    return get_current_thread()->ppid;
 }
 
 uint32_t get_priority(void)
 {
-    return active_thread->priority;
+    return get_current_thread()->priority;
 }
 
 OS_RETURN_E create_thread(thread_t* thread,
@@ -907,12 +3146,26 @@ OS_RETURN_E create_thread(thread_t* thread,
                           const uint32_t priority,
                           const char *name,
                           void* args)
+{
+    return create_thread_affinity(thread, function, priority, name, args,
+                                  THREAD_AFFINITY_ALL, THREAD_STACK_SIZE);
+}
+
+OS_RETURN_E create_thread_affinity(thread_t* thread,
+                                   void* (*function)(void*),
+                                   const uint32_t priority,
+                                   const char *name,
+                                   void* args,
+                                   const uint32_t affinity,
+                                   const uint32_t stack_size)
 {
     OS_RETURN_E         err;
+    kernel_thread_t*    current;
     kernel_thread_t*    new_thread;
     kernel_list_node_t* new_thread_node;
     kernel_list_node_t* seconde_new_thread_node;
     kernel_list_node_t* children_new_thread_node;
+    uint32_t            target_cpu;
 
     if(thread != NULL)
     {
@@ -925,16 +3178,28 @@ OS_RETURN_E create_thread(thread_t* thread,
         return OS_ERR_FORBIDEN_PRIORITY;
     }
 
+    if((affinity & sched_cpu_mask()) == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    if(stack_size < STACK_POOL_MIN_SIZE || stack_size > STACK_POOL_MAX_SIZE)
+    {
+        return OS_ERR_OUT_OF_BOUND;
+    }
+
     disable_local_interrupt();
 
-    new_thread = kmalloc(sizeof(kernel_thread_t));
+    current = active_thread[get_cpu_id()];
+
+    new_thread = kmem_cache_alloc(&thread_cache);
     new_thread_node = kernel_list_create_node(new_thread, &err);
 
     if(err != OS_NO_ERR || new_thread == NULL)
     {
         if(new_thread != NULL)
         {
-            kfree(new_thread);
+            kmem_cache_free(&thread_cache, new_thread);
         }
 
         if(err == OS_NO_ERR)
@@ -945,55 +3210,42 @@ OS_RETURN_E create_thread(thread_t* thread,
         return err;
     }
 
-    memset(new_thread, 0, sizeof(kernel_thread_t));
+    thread_clear(new_thread);
 
     /* Init thread settings */
-    new_thread->pid            = ++last_given_pid;
-    new_thread->ppid           = active_thread->pid;
+    new_thread->ppid           = current->pid;
     new_thread->priority       = priority;
     new_thread->init_prio      = priority;
     new_thread->args           = args;
     new_thread->function       = function;
     new_thread->joining_thread = NULL;
     new_thread->state          = READY;
-    new_thread->last_sched     = 0;
+    new_thread->ready_since    = get_monotonic_ns();
+    new_thread->cpu_id         = -1;
+    new_thread->rq_epoch       = 0;
+    new_thread->inherited_prio = KERNEL_LOWEST_PRIORITY;
+    new_thread->affinity       = affinity;
 
-    new_thread->children = kernel_list_create_list(&err);
+    err = stack_pool_alloc(stack_size, &new_thread->kernel_stack);
     if(err != OS_NO_ERR)
     {
         kernel_list_delete_node(&new_thread_node);
-        kfree(new_thread);
+        kmem_cache_free(&thread_cache, new_thread);
         enable_local_interrupt();
         return err;
     }
 
-     /* Init thread context */
-    new_thread->eip = (uint32_t) thread_wrapper;
-    new_thread->esp =
-        (uint32_t) &new_thread->kernel_stack[THREAD_STACK_SIZE - 18];
-    new_thread->ebp =
-        (uint32_t) &new_thread->kernel_stack[THREAD_STACK_SIZE - 1];
+    new_thread->children = kernel_list_create_list(&err);
+    if(err != OS_NO_ERR)
+    {
+        stack_pool_free(&new_thread->kernel_stack);
+        kernel_list_delete_node(&new_thread_node);
+        kmem_cache_free(&thread_cache, new_thread);
+        enable_local_interrupt();
+        return err;
+    }
 
-    /* Init thread stack */
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 1] = THREAD_INIT_EFLAGS;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 2] = THREAD_INIT_CS;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 3] = new_thread->eip;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 4] = 0; /* UNUSED (error core) */
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 5] = 0; /* UNUSED (int id) */
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 6] = THREAD_INIT_DS;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 7] = THREAD_INIT_ES;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 8] = THREAD_INIT_FS;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 9] = THREAD_INIT_GS;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 10] = THREAD_INIT_SS;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 11] = THREAD_INIT_EAX;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 12] = THREAD_INIT_EBX;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 13] = THREAD_INIT_ECX;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 14] = THREAD_INIT_EDX;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 15] = THREAD_INIT_ESI;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 16] = THREAD_INIT_EDI;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 17] = new_thread->ebp;
-    new_thread->kernel_stack[THREAD_STACK_SIZE - 18] =
-        (uint32_t)&new_thread->kernel_stack[THREAD_STACK_SIZE - 17];
+    init_thread_context(new_thread, THREAD_INIT_EFLAGS);
 
     strncpy(new_thread->name, name, THREAD_MAX_NAME_LENGTH);
 
@@ -1002,7 +3254,8 @@ OS_RETURN_E create_thread(thread_t* thread,
     {
         kernel_list_delete_list(&new_thread->children);
         kernel_list_delete_node(&new_thread_node);
-        kfree(new_thread);
+        stack_pool_free(&new_thread->kernel_stack);
+        kmem_cache_free(&thread_cache, new_thread);
         enable_local_interrupt();
         return err;
     }
@@ -1013,209 +3266,680 @@ OS_RETURN_E create_thread(thread_t* thread,
         kernel_list_delete_list(&new_thread->children);
         kernel_list_delete_node(&new_thread_node);
         kernel_list_delete_node(&seconde_new_thread_node);
-        kfree(new_thread);
+        stack_pool_free(&new_thread->kernel_stack);
+        kmem_cache_free(&thread_cache, new_thread);
+        enable_local_interrupt();
+        return err;
+    }
+
+    raw_lock(&sched_lock);
+
+    err = kernel_list_enlist_data(seconde_new_thread_node,
+                                  global_threads_table,
+                                  new_thread->priority);
+    if(err != OS_NO_ERR)
+    {
+        raw_unlock(&sched_lock);
+        kernel_list_delete_list(&new_thread->children);
+        kernel_list_delete_node(&children_new_thread_node);
+        kernel_list_delete_node(&new_thread_node);
+        kernel_list_delete_node(&seconde_new_thread_node);
+        stack_pool_free(&new_thread->kernel_stack);
+        kmem_cache_free(&thread_cache, new_thread);
+        enable_local_interrupt();
+        return err;
+    }
+
+    err = kernel_list_enlist_data(children_new_thread_node,
+                                  current->children, 0);
+    if(err != OS_NO_ERR)
+    {
+        kernel_list_unlink_node(global_threads_table,
+                                seconde_new_thread_node);
+        raw_unlock(&sched_lock);
+        kernel_list_delete_list(&new_thread->children);
+        kernel_list_delete_node(&children_new_thread_node);
+        kernel_list_delete_node(&new_thread_node);
+        kernel_list_delete_node(&seconde_new_thread_node);
+        stack_pool_free(&new_thread->kernel_stack);
+        kmem_cache_free(&thread_cache, new_thread);
         enable_local_interrupt();
         return err;
     }
 
-    err = kernel_list_enlist_data(new_thread_node, active_threads_table,
-                                  priority);
-    if(err != OS_NO_ERR)
+    new_thread->parent      = current;
+    new_thread->sched_node  = new_thread_node;
+    new_thread->global_node = seconde_new_thread_node;
+    new_thread->child_node  = children_new_thread_node;
+
+    new_thread->pid = ++last_given_pid;
+    ++thread_count;
+
+    /* Set the handle before any CPU can execute the thread */
+    if(thread != NULL)
+    {
+        *thread = new_thread;
+    }
+
+    /* Give the thread to the least loaded allowed CPU */
+    target_cpu = rq_find_idlest(affinity);
+
+    raw_lock(&runqueues[target_cpu].lock);
+    err = rq_enqueue(target_cpu, new_thread_node, priority);
+    if(err == OS_NO_ERR)
+    {
+        sched_tick_kick(target_cpu);
+    }
+    raw_unlock(&runqueues[target_cpu].lock);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not enqueue new thread[%d]\n", err);
+        kernel_panic();
+    }
+
+    raw_unlock(&sched_lock);
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Created thread %d\n", new_thread->pid);
+    #endif
+
+    enable_local_interrupt();
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E wait_thread(thread_t thread, void** ret_val)
+{
+    kernel_thread_t*    current;
+    kernel_list_node_t* current_node;
+    uint32_t            cpu_id;
+    uint32_t            thread_cpu_id;
+
+    if(thread == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    disable_local_interrupt();
+
+    cpu_id       = get_cpu_id();
+    current      = active_thread[cpu_id];
+    current_node = active_thread_node[cpu_id];
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Thread %d waiting for thread %d\n",
+                         current->pid,
+                         thread->pid);
+    #endif
+
+    raw_lock(&sched_lock);
+
+    if(thread->state == DEAD)
+    {
+        raw_unlock(&sched_lock);
+        enable_local_interrupt();
+        return OS_ERR_NO_SUCH_ID;
+    }
+
+    /* Wait for the thread to finish */
+    if(thread->state != ZOMBIE)
+    {
+        thread->joining_thread = current_node;
+
+        raw_lock(&runqueues[cpu_id].lock);
+        current->state = JOINING;
+        raw_unlock(&runqueues[cpu_id].lock);
+
+        raw_unlock(&sched_lock);
+        enable_local_interrupt();
+
+        /* Schedule thread */
+        schedule();
+
+        disable_local_interrupt();
+        raw_lock(&sched_lock);
+    }
+
+    /* The thread might still be leaving an other CPU, its stack cannot be
+     * released before. The CPU releases the run queue lock once it left the
+     * thread stack.
+     */
+    while(1 < 2)
+    {
+        thread_cpu_id = thread_lock_rq(thread);
+        if(thread->cpu_id == -1)
+        {
+            raw_unlock(&runqueues[thread_cpu_id].lock);
+            break;
+        }
+        raw_unlock(&runqueues[thread_cpu_id].lock);
+    }
+
+    /* Remove the thread from the thread table */
+    thread->state = DEAD;
+    if(ret_val != NULL)
+    {
+        *ret_val = thread->ret_val;
+    }
+
+    clean_joined_thread(thread);
+
+    raw_unlock(&sched_lock);
+    enable_local_interrupt();
+
+    return OS_NO_ERR;
+}
+
+kernel_list_node_t* lock_thread(const BLOCK_TYPE_E block_type)
+{
+    kernel_list_node_t* current_thread_node;
+    kernel_thread_t*    current;
+    uint32_t            cpu_id;
+
+    disable_local_interrupt();
+
+    cpu_id  = get_cpu_id();
+    current = active_thread[cpu_id];
+
+    /* Cant lock kernel thread */
+    if(current == idle_thread[cpu_id])
+    {
+        enable_local_interrupt();
+        return NULL;
+    }
+
+    current_thread_node = active_thread_node[cpu_id];
+
+    /* Lock the thread */
+    raw_lock(&runqueues[cpu_id].lock);
+    current->state      = BLOCKED;
+    current->block_type = block_type;
+    raw_unlock(&runqueues[cpu_id].lock);
+
+    enable_local_interrupt();
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Thread %d locked, reason: %d\n",
+                        current->pid,
+                        block_type);
+    #endif
+
+    return current_thread_node;
+}
+
+OS_RETURN_E unlock_thread(kernel_list_node_t* node,
+                          const BLOCK_TYPE_E block_type,
+                          const uint8_t do_schedule)
+{
+    OS_RETURN_E err;
+    uint32_t    cpu_id;
+    kernel_thread_t* thread = (kernel_thread_t*)node->data;
+
+    /* Check thread value */
+    if(thread == NULL || is_idle_thread(thread) == 1)
+    {
+        return OS_ERR_NO_SUCH_ID;
+    }
+
+    disable_local_interrupt();
+    cpu_id = thread_lock_rq(thread);
+
+    /* Check thread state */
+    if(thread->state != BLOCKED ||
+       thread->block_type != block_type)
+    {
+        raw_unlock(&runqueues[cpu_id].lock);
+        enable_local_interrupt();
+
+        switch(block_type)
+        {
+            case SEM:
+                return OS_ERR_NO_SEM_BLOCKED;
+            case MUTEX:
+                return OS_ERR_NO_MUTEX_BLOCKED;
+            case QUEUE:
+                return OS_ERR_NO_QUEUE_BLOCKED;
+            default:
+                return OS_ERR_NULL_POINTER;
+        }
+
+    }
+
+    /* Unlock thread state */
+    err = thread_set_ready(node);
+
+    raw_unlock(&runqueues[cpu_id].lock);
+    enable_local_interrupt();
+
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not enqueue thread in active table[%d]\n", err);
+        kernel_panic();
+    }
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Thread %d unlocked, reason: %d\n",
+                         thread->pid,
+                         block_type);
+    #endif
+
+    if(do_schedule)
+    {
+        schedule();
+    }
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E set_thread_affinity(thread_t thread, const uint32_t affinity)
+{
+    OS_RETURN_E err;
+    uint32_t    cpu_id;
+    int32_t     running_cpu;
+
+    if(thread == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    if(is_idle_thread(thread) == 1 || (affinity & sched_cpu_mask()) == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    disable_local_interrupt();
+    cpu_id = thread_lock_rq(thread);
+
+    if(thread->dl_period != 0)
+    {
+        raw_unlock(&runqueues[cpu_id].lock);
+        enable_local_interrupt();
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    thread->affinity = affinity;
+
+    err         = OS_NO_ERR;
+    running_cpu = -1;
+    if((affinity & THREAD_AFFINITY_CPU(cpu_id)) == 0)
+    {
+        /* A queued thread moves now, a running one when it leaves its CPU.
+         * The other threads move when they are woken up.
+         */
+        if(thread->state == READY && thread->cpu_id == -1 &&
+           (thread->sched_node->enlisted != 0 ||
+            thread->fair_node.linked != 0))
+        {
+            err = rq_remove(cpu_id, thread);
+            if(err == OS_NO_ERR)
+            {
+                rq_migrate(thread, -1);
+            }
+        }
+        else if(thread->cpu_id != -1)
+        {
+            running_cpu = thread->cpu_id;
+        }
+    }
+
+    raw_unlock(&runqueues[cpu_id].lock);
+
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Thread %d affinity set to 0x%08x\n", thread->pid,
+                        affinity);
+    #endif
+
+    if(running_cpu == (int32_t)get_cpu_id())
+    {
+        enable_local_interrupt();
+        schedule();
+    }
+    else
+    {
+        if(running_cpu != -1)
+        {
+            err = send_sched_ipi(running_cpu);
+        }
+        enable_local_interrupt();
+    }
+
+    return err;
+}
+
+OS_RETURN_E set_thread_policy(thread_t thread, const SCHED_POLICY_E policy)
+{
+    OS_RETURN_E err;
+    uint32_t    cpu_id;
+
+    if(thread == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    if(policy != SCHED_POLICY_PRIORITY && policy != SCHED_POLICY_FAIR)
     {
-        kernel_list_delete_list(&new_thread->children);
-        kernel_list_delete_node(&children_new_thread_node);
-        kernel_list_delete_node(&new_thread_node);
-        kernel_list_delete_node(&seconde_new_thread_node);
-        kfree(new_thread);
-        enable_local_interrupt();
-        return err;
+        return OS_ERR_UNAUTHORIZED_ACTION;
     }
 
-     err = kernel_list_enlist_data(seconde_new_thread_node,
-                                   global_threads_table,
-                                   new_thread->priority);
-     if(err != OS_NO_ERR)
-     {
-         kernel_list_delete_list(&new_thread->children);
-         kernel_list_delete_node(&children_new_thread_node);
-         kernel_list_delete_node(&new_thread_node);
-         kernel_list_delete_node(&seconde_new_thread_node);
-         kfree(new_thread);
-         enable_local_interrupt();
-         return err;
-     }
-
-    err = kernel_list_enlist_data(children_new_thread_node,
-                                  active_thread->children, 0);
-    if(err != OS_NO_ERR)
+    if(is_idle_thread(thread) == 1 || thread == init_thread)
     {
-        kernel_list_delete_list(&new_thread->children);
-        kernel_list_delete_node(&children_new_thread_node);
-        kernel_list_delete_node(&new_thread_node);
-        kernel_list_delete_node(&seconde_new_thread_node);
-        kfree(new_thread);
-        enable_local_interrupt();
-        return err;
+        return OS_ERR_UNAUTHORIZED_ACTION;
     }
 
-    ++thread_count;
-
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("Created thread %d\n", new_thread->pid);
-    #endif
+    disable_local_interrupt();
+    cpu_id = thread_lock_rq(thread);
 
-    if(thread != NULL)
+    err = OS_NO_ERR;
+    if(thread->policy != policy)
     {
-        *thread = new_thread;
+        /* A thread joining the fair threads starts where the CPU fair threads
+         * are, it is charged from its next execution
+         */
+        if(policy == SCHED_POLICY_FAIR)
+        {
+            thread->vruntime = runqueues[cpu_id].min_vruntime;
+        }
+        thread->fair_exec_start = 0;
+
+        /* A queued thread changes of structure in its run queue */
+        if(thread->state == READY && thread->cpu_id == -1 &&
+           (thread->sched_node->enlisted != 0 ||
+            thread->fair_node.linked != 0))
+        {
+            err = rq_remove(cpu_id, thread);
+            if(err == OS_NO_ERR)
+            {
+                thread->policy = policy;
+                err = rq_enqueue(cpu_id, thread->sched_node, thread->priority);
+                sched_tick_kick(cpu_id);
+            }
+        }
+        else
+        {
+            thread->policy = policy;
+        }
     }
 
+    raw_unlock(&runqueues[cpu_id].lock);
     enable_local_interrupt();
 
-    return OS_NO_ERR;
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Thread %d policy set to %d\n", thread->pid, policy);
+    #endif
+
+    return err;
 }
 
-OS_RETURN_E wait_thread(thread_t thread, void** ret_val)
+OS_RETURN_E set_thread_deadline(thread_t thread, const uint32_t runtime,
+                                const uint32_t deadline, const uint32_t period)
 {
+    OS_RETURN_E err;
+    uint32_t    bw;
+    uint32_t    affinity;
+    uint32_t    target_cpu;
+    uint32_t    cpu_id;
+    uint32_t    i;
+    uint8_t     queued;
+    int32_t     running_cpu;
+
     if(thread == NULL)
     {
         return OS_ERR_NULL_POINTER;
     }
 
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("Thread %d waiting for thread %d\n",
-                         active_thread->pid,
-                         thread->pid);
-    #endif
+    if(is_idle_thread(thread) == 1 || thread == init_thread)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    bw = 0;
+    if(runtime != 0)
+    {
+        if(runtime > deadline || deadline > period ||
+           period > SCHEDULE_DL_MAX_PERIOD)
+        {
+            return OS_ERR_OUT_OF_BOUND;
+        }
+
+        /* The density is used, the deadline can be shorter than the period */
+        bw = cpu_udiv_64_32((uint64_t)runtime << SCHEDULE_DL_BW_SHIFT,
+                            deadline);
+    }
 
     disable_local_interrupt();
+    raw_lock(&sched_lock);
 
-    if(thread->state == DEAD)
+    if(thread->state == ZOMBIE || thread->state == DEAD)
     {
+        raw_unlock(&sched_lock);
         enable_local_interrupt();
         return OS_ERR_NO_SUCH_ID;
     }
 
-    /* If thread already done then remove it from the thread table */
-    if(thread->state == ZOMBIE)
+    /* The current reservation is released before the admission */
+    affinity = thread->affinity;
+    if(thread->dl_period != 0)
+    {
+        dl_bandwidth[thread->dl_cpu] -= thread->dl_bw;
+        affinity = thread->dl_saved_affinity;
+    }
+
+    /* Admission control: the allowed CPU with the least reserved bandwidth
+     * which stays under SCHEDULE_DL_BW_MAX
+     */
+    target_cpu = MAX_CPU_COUNT;
+    if(runtime != 0)
     {
-        thread->state = DEAD;
-        if(ret_val != NULL)
+        for(i = 0; i < MAX_CPU_COUNT; ++i)
         {
-            *ret_val = thread->ret_val;
+            if(idle_thread[i] != NULL &&
+               (affinity & THREAD_AFFINITY_CPU(i)) != 0 &&
+               dl_bandwidth[i] + bw <= SCHEDULE_DL_BW_MAX &&
+               (target_cpu == MAX_CPU_COUNT ||
+                dl_bandwidth[i] < dl_bandwidth[target_cpu]))
+            {
+                target_cpu = i;
+            }
         }
 
-        clean_joined_thread(thread);
-
-        enable_local_interrupt();
+        if(target_cpu == MAX_CPU_COUNT)
+        {
+            if(thread->dl_period != 0)
+            {
+                dl_bandwidth[thread->dl_cpu] += thread->dl_bw;
+            }
+            raw_unlock(&sched_lock);
+            enable_local_interrupt();
+            return OS_ERR_UNAUTHORIZED_ACTION;
+        }
 
-        return OS_NO_ERR;
+        dl_bandwidth[target_cpu] += bw;
     }
 
-    /* Wait for the thread to finish */
-    thread->joining_thread = active_thread_node;
-    active_thread->state   = JOINING;
+    cpu_id = thread_lock_rq(thread);
 
-    enable_local_interrupt();
+    /* A queued thread is enqueued again in its new class */
+    err    = OS_NO_ERR;
+    queued = 0;
+    if(thread->state == READY && thread->cpu_id == -1)
+    {
+        if(thread->dl_period != 0)
+        {
+            queued = dl_list_remove(&runqueues[cpu_id].dl_ready, thread);
+            if(queued == 1)
+            {
+                --runqueues[cpu_id].length;
+            }
+            else
+            {
+                queued = dl_list_remove(&runqueues[cpu_id].dl_throttled,
+                                        thread);
+            }
+        }
+        else if(thread->sched_node->enlisted != 0 ||
+                thread->fair_node.linked != 0)
+        {
+            err    = rq_remove(cpu_id, thread);
+            queued = 1;
+        }
+    }
 
-    /* Schedule thread */
-    schedule();
+    if(runtime != 0)
+    {
+        if(thread->dl_period == 0)
+        {
+            thread->dl_saved_affinity = thread->affinity;
+        }
 
-    disable_local_interrupt();
+        /* The first period starts when the thread is enqueued */
+        thread->dl_runtime     = runtime * 1000;
+        thread->dl_deadline    = deadline * 1000;
+        thread->dl_period      = period * 1000;
+        thread->dl_bw          = bw;
+        thread->dl_cpu         = target_cpu;
+        thread->dl_budget      = 0;
+        thread->dl_next_period = 0;
+        thread->dl_exec_start  = 0;
+        thread->affinity       = THREAD_AFFINITY_CPU(target_cpu);
+    }
+    else if(thread->dl_period != 0)
+    {
+        thread->dl_runtime    = 0;
+        thread->dl_deadline   = 0;
+        thread->dl_period     = 0;
+        thread->dl_bw         = 0;
+        thread->dl_exec_start = 0;
+        thread->affinity      = thread->dl_saved_affinity;
+    }
 
-    if(ret_val != NULL)
+    running_cpu = -1;
+    if(queued == 1 && err == OS_NO_ERR)
     {
-        *ret_val = thread->ret_val;
+        err = rq_enqueue(cpu_id, thread->sched_node, thread->priority);
+        sched_tick_kick(cpu_id);
+    }
+    else if(thread->cpu_id != -1)
+    {
+        running_cpu = thread->cpu_id;
     }
 
-    clean_joined_thread(thread);
+    raw_unlock(&runqueues[cpu_id].lock);
+    raw_unlock(&sched_lock);
 
-    enable_local_interrupt();
+    #ifdef DEBUG_SCHED
+    kernel_serial_debug("Thread %d deadline %d/%d/%dus on CPU %d\n",
+                        thread->pid, runtime, deadline, period, target_cpu);
+    #endif
 
-    return OS_NO_ERR;
+    /* A running thread changes of class at its next schedule */
+    if(running_cpu == (int32_t)get_cpu_id())
+    {
+        enable_local_interrupt();
+        schedule();
+    }
+    else
+    {
+        if(running_cpu != -1)
+        {
+            err = send_sched_ipi(running_cpu);
+        }
+        enable_local_interrupt();
+    }
+
+    return err;
 }
 
-kernel_list_node_t* lock_thread(const BLOCK_TYPE_E block_type)
+OS_RETURN_E set_thread_inherited_priority(thread_t thread,
+                                          const uint32_t priority)
 {
-    kernel_list_node_t* current_thread_node;
-    /* Cant lock kernel thread */
-    if(active_thread == idle_thread)
+    OS_RETURN_E err;
+    uint32_t    cpu_id;
+    uint32_t    new_prio;
+
+    if(thread == NULL)
     {
-        return NULL;
+        return OS_ERR_NULL_POINTER;
+    }
+
+    if(priority > KERNEL_LOWEST_PRIORITY)
+    {
+        return OS_ERR_FORBIDEN_PRIORITY;
+    }
+
+    if(is_idle_thread(thread) == 1)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
     }
 
     disable_local_interrupt();
+    cpu_id = thread_lock_rq(thread);
 
-    current_thread_node = active_thread_node;
+    /* A boost never lowers the current priority, a restore gives the thread
+     * its own priority back.
+     */
+    if(priority <= thread->inherited_prio)
+    {
+        new_prio = (priority < thread->priority) ? priority : thread->priority;
+    }
+    else
+    {
+        new_prio = (priority < thread->init_prio) ? priority : thread->init_prio;
+    }
+    thread->inherited_prio = priority;
 
-    /* Lock the thread */
-    active_thread->state      = BLOCKED;
-    active_thread->block_type = block_type;
+    err = OS_NO_ERR;
+    if(new_prio != thread->priority)
+    {
+        /* A ready thread changes of FIFO in its run queue */
+        if(thread->state == READY && thread->cpu_id == -1 &&
+           thread->sched_node->enlisted != 0)
+        {
+            err = rq_remove(cpu_id, thread);
+            if(err == OS_NO_ERR)
+            {
+                thread->priority = new_prio;
+                err = rq_enqueue(cpu_id, thread->sched_node, new_prio);
+                sched_tick_kick(cpu_id);
+            }
+        }
+        else
+        {
+            thread->priority = new_prio;
+        }
+    }
 
+    raw_unlock(&runqueues[cpu_id].lock);
     enable_local_interrupt();
 
     #ifdef DEBUG_SCHED
-    kernel_serial_debug("Thread %d locked, reason: %d\n",
-                        active_thread->pid,
-                        block_type);
+    kernel_serial_debug("Thread %d inherited priority %d (%d)\n",
+                        thread->pid, priority, new_prio);
     #endif
 
-    return current_thread_node;
+    return err;
 }
 
-OS_RETURN_E unlock_thread(kernel_list_node_t* node,
-                          const BLOCK_TYPE_E block_type,
-                          const uint8_t do_schedule)
+uint8_t is_thread_running(const kernel_thread_t* thread)
 {
-    OS_RETURN_E err;
-    kernel_thread_t* thread = (kernel_thread_t*)node->data;
+    uint32_t count;
+    uint32_t i;
 
-    /* Check thread value */
-    if(thread == NULL || thread == idle_thread)
+    if(thread == NULL)
     {
-        return OS_ERR_NO_SUCH_ID;
+        return 0;
     }
 
-    /* Check thread state */
-    if(thread->state != BLOCKED ||
-       thread->block_type != block_type)
+    /* Lockless read, the thread may leave its CPU right after */
+    count = get_booted_cpu_count();
+    for(i = 0; i < count && i < MAX_CPU_COUNT; ++i)
     {
-        switch(block_type)
+        if(active_thread[i] == thread)
         {
-            case SEM:
-                return OS_ERR_NO_SEM_BLOCKED;
-            case MUTEX:
-                return OS_ERR_NO_MUTEX_BLOCKED;
-            case QUEUE:
-                return OS_ERR_NO_QUEUE_BLOCKED;
-            default:
-                return OS_ERR_NULL_POINTER;
+            return 1;
         }
-
-    }
-    disable_local_interrupt();
-    /* Unlock thread state */
-    thread->state = READY;
-    err = kernel_list_enlist_data(node, active_threads_table, thread->priority);
-    enable_local_interrupt();
-
-    if(err != OS_NO_ERR)
-    {
-        kernel_error("Could not enqueue thread in active table[%d]\n", err);
-        kernel_panic();
-    }
-
-    #ifdef DEBUG_SCHED
-    kernel_serial_debug("Thread %d unlocked, reason: %d\n",
-                         thread->pid,
-                         block_type);
-    #endif
-
-    if(do_schedule)
-    {
-        schedule();
     }
 
-    return OS_NO_ERR;
+    return 0;
 }
 
 OS_RETURN_E get_threads_info(thread_info_t* threads, int32_t* size)
@@ -1223,6 +3947,8 @@ OS_RETURN_E get_threads_info(thread_info_t* threads, int32_t* size)
     int32_t          i;
     kernel_list_node_t*  cursor;
     kernel_thread_t* cursor_thread;
+    uint64_t         now;
+    uint64_t         run_since;
 
     if(threads == NULL)
     {
@@ -1234,6 +3960,9 @@ OS_RETURN_E get_threads_info(thread_info_t* threads, int32_t* size)
     }
 
     disable_local_interrupt();
+    raw_lock(&sched_lock);
+
+    now = get_monotonic_ns();
 
     if(*size > (int)thread_count)
     {
@@ -1242,15 +3971,35 @@ OS_RETURN_E get_threads_info(thread_info_t* threads, int32_t* size)
 
     /* Walk the thread list and fill the structures */
     cursor = global_threads_table->head;
-    cursor_thread = (kernel_thread_t*)cursor->data;
     for(i = 0; cursor != NULL && i < *size; ++i)
     {
         thread_info_t *current = &threads[i];
+        cursor_thread = (kernel_thread_t*)cursor->data;
+
         current->pid = cursor_thread->pid;
         current->ppid = cursor_thread->ppid;
         strncpy(current->name, cursor_thread->name, THREAD_MAX_NAME_LENGTH);
         current->priority = cursor_thread->priority;
+        current->policy = cursor_thread->policy;
         current->state = cursor_thread->state;
+        current->cpu_id = cursor_thread->rq_cpu;
+        current->cpu_queue_length = runqueues[cursor_thread->rq_cpu].length;
+        current->affinity = cursor_thread->affinity;
+        current->dl_runtime = cursor_thread->dl_runtime / 1000;
+        current->dl_period = cursor_thread->dl_period / 1000;
+        current->cpu_time = cursor_thread->cpu_time;
+        /* Executing threads are charged at their next switch */
+        run_since = cursor_thread->run_since;
+        if(run_since != 0 && now > run_since)
+        {
+            current->cpu_time += now - run_since;
+        }
+        current->ready_time = cursor_thread->ready_time;
+        current->voluntary_switches = cursor_thread->voluntary_switches;
+        current->involuntary_switches = cursor_thread->involuntary_switches;
+        current->stack_size = cursor_thread->kernel_stack.size;
+        current->stack_used =
+            stack_pool_high_water(&cursor_thread->kernel_stack);
         current->start_time = cursor_thread->start_time;
         if(current->state != ZOMBIE)
         {
@@ -1264,10 +4013,123 @@ OS_RETURN_E get_threads_info(thread_info_t* threads, int32_t* size)
         }
 
         cursor = cursor->next;
-        cursor_thread = (kernel_thread_t*)cursor->data;
     }
 
+    raw_unlock(&sched_lock);
+    enable_local_interrupt();
+
+    return OS_NO_ERR;
+}
+
+/* Output a scheduler histogram on the serial port. The histogram is copied
+ * with the CPU run queue lock held and output without it.
+ *
+ * @param cpu_id The id of the CPU the histogram belongs to.
+ * @param name The name of the histogram.
+ * @param band The priority band of the histogram, -1 for no band.
+ * @param hist The histogram to output.
+ */
+static void sched_hist_dump(const uint32_t cpu_id, const char* name,
+                            const int32_t band, const sched_histogram_t* hist)
+{
+    sched_histogram_t copy;
+    uint32_t          i;
+
+    disable_local_interrupt();
+    raw_lock(&runqueues[cpu_id].lock);
+    memcpy(&copy, hist, sizeof(sched_histogram_t));
+    raw_unlock(&runqueues[cpu_id].lock);
+    enable_local_interrupt();
+
+    if(copy.count == 0)
+    {
+        return;
+    }
+
+    if(band == -1)
+    {
+        kernel_serial_debug("CPU %d %s: %u values, max %u\n",
+                            cpu_id, name, copy.count, copy.max);
+    }
+    else
+    {
+        kernel_serial_debug("CPU %d %s priorities %d-%d: %u values, max %u\n",
+                            cpu_id, name, band * SCHEDULE_HIST_BAND_SIZE,
+                            band * SCHEDULE_HIST_BAND_SIZE +
+                            SCHEDULE_HIST_BAND_SIZE - 1,
+                            copy.count, copy.max);
+    }
+
+    if(copy.buckets[0] != 0)
+    {
+        kernel_serial_debug("    0: %u\n", copy.buckets[0]);
+    }
+    for(i = 1; i < SCHEDULE_HIST_BUCKETS; ++i)
+    {
+        if(copy.buckets[i] != 0)
+        {
+            kernel_serial_debug("    %u+: %u\n",
+                                1U << (i - 1), copy.buckets[i]);
+        }
+    }
+}
+
+OS_RETURN_E get_sched_stats(const uint32_t cpu_id, sched_stats_t* stats)
+{
+    if(stats == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+    if(cpu_id >= MAX_CPU_COUNT || idle_thread[cpu_id] == NULL)
+    {
+        return OS_ERR_NO_SUCH_ID;
+    }
+
+    disable_local_interrupt();
+    raw_lock(&runqueues[cpu_id].lock);
+    memcpy(stats, &sched_stats[cpu_id], sizeof(sched_stats_t));
+    raw_unlock(&runqueues[cpu_id].lock);
     enable_local_interrupt();
 
     return OS_NO_ERR;
 }
+
+void reset_sched_stats(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        disable_local_interrupt();
+        raw_lock(&runqueues[i].lock);
+        memset(&sched_stats[i], 0, sizeof(sched_stats_t));
+        raw_unlock(&runqueues[i].lock);
+        enable_local_interrupt();
+    }
+}
+
+void dump_sched_stats(void)
+{
+    uint32_t i;
+    int32_t  band;
+
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        if(idle_thread[i] == NULL)
+        {
+            continue;
+        }
+
+        for(band = 0; band < SCHEDULE_HIST_BANDS; ++band)
+        {
+            sched_hist_dump(i, "wakeup latency (ns)", band,
+                            &sched_stats[i].wakeup_latency[band]);
+        }
+        for(band = 0; band < SCHEDULE_HIST_BANDS; ++band)
+        {
+            sched_hist_dump(i, "timeslice (ns)", band,
+                            &sched_stats[i].timeslice[band]);
+        }
+        sched_hist_dump(i, "run queue depth", -1, &sched_stats[i].rq_depth);
+    }
+}
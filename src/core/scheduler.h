@@ -18,6 +18,7 @@
 #include "../lib/stddef.h"  /* OS_RETURN_E */
 #include "../lib/stdint.h"  /* Generic int types */
 #include "kernel_thread.h"  /* thread_t */
+#include "kernel_list.h"    /* kernel_list_t */
 
 /*******************************************************************************
  * CONSTANTS
@@ -28,8 +29,70 @@
 #define KERNEL_HIGHEST_PRIORITY 0
 #define IDLE_THREAD_PRIORITY    KERNEL_LOWEST_PRIORITY
 
+/* One bit per priority level in the active threads bitmap */
+#define PRIORITY_BITMAP_SIZE    ((KERNEL_LOWEST_PRIORITY + 32) / 32)
+
 #define SCHEDULE_DYN_PRIORITY   1
 
+/* Number of run queue epochs a ready thread waits to gain one priority level */
+#define SCHEDULE_AGING_PERIOD   25
+
+/* Priority of the fair class. The fair threads of a run queue compete with the
+ * priority threads as a single entry of this priority, aged since a fair thread
+ * last got the CPU. The priority threads win the ties.
+ */
+#define SCHEDULE_FAIR_PRIORITY  32
+
+/* Sleeping threads timing wheel: SLEEP_WHEEL_LEVELS levels of
+ * SLEEP_WHEEL_SIZE slots, a slot of level n spans SLEEP_WHEEL_SIZE^n ms.
+ */
+#define SLEEP_WHEEL_BITS        6
+#define SLEEP_WHEEL_SIZE        (1 << SLEEP_WHEEL_BITS)
+#define SLEEP_WHEEL_LEVELS      4
+
+/* Threads affinity masks, bit n allows the thread on the CPU n */
+#define THREAD_AFFINITY_ALL     0xFFFFFFFF
+#define THREAD_AFFINITY_CPU(id) (1U << (id))
+
+/* Maximal time an idle CPU stays without scheduler ticks (in ms) */
+#define SCHEDULE_TICKLESS_MAX   1000
+
+/* Number of scheduler timer ticks between two run queues balancing */
+#define SCHEDULE_BALANCE_PERIOD 20
+
+/* High resolution sleeping threads are woken up this early (in ns) rather than
+ * programming an other timer interrupt
+ */
+#define SCHEDULE_HR_SLACK_NS    10000
+
+/* Fair threads: a thread of weight SCHEDULE_FAIR_WEIGHT_BASE gets virtual
+ * runtime at the wall clock speed. Woken up threads are placed at most
+ * SCHEDULE_FAIR_WAKEUP_NS away from the CPU minimal virtual runtime and an
+ * execution is charged at most SCHEDULE_FAIR_MAX_DELTA_NS.
+ */
+#define SCHEDULE_FAIR_WEIGHT_BASE  1024
+#define SCHEDULE_FAIR_WAKEUP_NS    3000000
+#define SCHEDULE_FAIR_MAX_DELTA_NS 50000000
+
+/* Deadline threads: maximal period (in us) and share of a CPU they can
+ * reserve (in percent). Bandwidths are fixed point values of
+ * SCHEDULE_DL_BW_SHIFT bits.
+ */
+#define SCHEDULE_DL_MAX_PERIOD  1000000
+#define SCHEDULE_DL_MAX_SHARE   90
+#define SCHEDULE_DL_BW_SHIFT    20
+#define SCHEDULE_DL_BW_MAX      \
+    (((1U << SCHEDULE_DL_BW_SHIFT) / 100) * SCHEDULE_DL_MAX_SHARE)
+
+/* Scheduler histograms: the bucket 0 counts the null values, the bucket n
+ * counts the values in [2^(n-1), 2^n[ and the last one the greater values.
+ * Threads are grouped in bands of SCHEDULE_HIST_BAND_SIZE priorities.
+ */
+#define SCHEDULE_HIST_BUCKETS   32
+#define SCHEDULE_HIST_BAND_SIZE 16
+#define SCHEDULE_HIST_BANDS     \
+    (KERNEL_LOWEST_PRIORITY / SCHEDULE_HIST_BAND_SIZE + 1)
+
 /*******************************************************************************
  * STRUCTURES
  ******************************************************************************/
@@ -41,6 +104,72 @@ typedef enum SYSTEM_STATE
     HALTED
 } SYSTEM_STATE_E;
 
+/* CPU run queue: one FIFO per priority, the bitmap tells which FIFOs are not
+ * empty. Deadline threads are executed before the FIFOs, the ready ones are
+ * sorted by absolute deadline and the ones which consumed their runtime by
+ * period end. The fair threads compete with the FIFOs as a single entry of
+ * priority SCHEDULE_FAIR_PRIORITY and are executed lowest virtual runtime
+ * first. The lock is held by the CPU while it switches threads.
+ */
+typedef struct cpu_runqueue
+{
+    kernel_list_t*    table[KERNEL_LOWEST_PRIORITY + 1];
+    uint32_t          bitmap[PRIORITY_BITMAP_SIZE];
+
+    kernel_thread_t*  dl_ready;
+    kernel_thread_t*  dl_throttled;
+
+    /* Fair threads and virtual runtime the CPU fair threads reached */
+    kernel_rbtree_t   fair_tree;
+    uint64_t          min_vruntime;
+
+    /* Epoch at which a fair thread last got the CPU, ages the fair class */
+    uint32_t          fair_epoch;
+
+    /* Number of ready threads in the queue */
+    volatile uint32_t length;
+
+    /* Incremented at each schedule, used to age the ready threads */
+    uint32_t          epoch;
+
+    volatile uint32_t lock;
+} cpu_runqueue_t;
+
+/* Log scale histogram, see SCHEDULE_HIST_BUCKETS */
+typedef struct sched_histogram
+{
+    uint32_t buckets[SCHEDULE_HIST_BUCKETS];
+
+    /* Number of values and greatest value, saturated to 32 bits */
+    uint32_t count;
+    uint32_t max;
+} sched_histogram_t;
+
+/* Scheduler statistics of a CPU */
+typedef struct sched_stats
+{
+    /* Time between a thread wake up and its execution and time a thread
+     * executes before an other thread gets the CPU, in ns, per priority band
+     */
+    sched_histogram_t wakeup_latency[SCHEDULE_HIST_BANDS];
+    sched_histogram_t timeslice[SCHEDULE_HIST_BANDS];
+
+    /* Number of ready threads in the run queue at each schedule */
+    sched_histogram_t rq_depth;
+} sched_stats_t;
+
+/* Periodic thread release timeline, see thread_period_wait */
+typedef struct thread_period
+{
+    /* Period in ns and next release time (monotonic ns) */
+    uint32_t period;
+    uint64_t next_release;
+
+    /* Number of releases and number of releases missed by overruns */
+    uint32_t releases;
+    uint32_t overruns;
+} thread_period_t;
+
 /* Thread information struct */
 typedef struct thread_info
 {
@@ -49,9 +178,33 @@ typedef struct thread_info
     char             name[THREAD_MAX_NAME_LENGTH];
 
     uint32_t         priority;
+    SCHED_POLICY_E   policy;
 
     THREAD_STATE_E   state;
 
+    /* CPU run queue of the thread and its length */
+    uint32_t         cpu_id;
+    uint32_t         cpu_queue_length;
+
+    /* CPUs allowed to execute the thread */
+    uint32_t         affinity;
+
+    /* Deadline class runtime and period in us, 0 if not a deadline thread */
+    uint32_t         dl_runtime;
+    uint32_t         dl_period;
+
+    /* Executed time and time waited ready in the run queues in ns, switches
+     * the thread asked for (block, sleep, exit) and preemptions
+     */
+    uint64_t         cpu_time;
+    uint64_t         ready_time;
+    uint32_t         voluntary_switches;
+    uint32_t         involuntary_switches;
+
+    /* Stack size and high water mark in bytes */
+    uint32_t         stack_size;
+    uint32_t         stack_used;
+
     uint32_t start_time;
     uint32_t end_time;
     uint32_t exec_time;
@@ -76,8 +229,19 @@ SYSTEM_STATE_E get_system_state(void);
  */
 OS_RETURN_E init_scheduler(void);
 
-/* Call the scheduler, use interrupt since we should never call the
- * scheduler outside of an interrupt context
+/* Init the scheduler on an application processor. The function waits for the
+ * main CPU to initialize the scheduler, then creates the CPU's IDLE thread and
+ * starts scheduling threads.
+ * !!!! IT SHOULD NEVER RETURN !!!!
+ *
+ * @return If the function returns, it means the init failed, the error code is
+ * set accordingly.
+ */
+OS_RETURN_E init_ap_scheduler(void);
+
+/* Call the scheduler, the current thread gives the CPU to the next thread to
+ * execute. The switch is done directly, without raising the scheduler
+ * software interrupt. Local interrupts must be enabled.
  */
 void schedule(void);
 
@@ -88,6 +252,51 @@ void schedule(void);
  */
 OS_RETURN_E sleep(const uint32_t time_ms);
 
+/* Put the calling thread to sleep with a nanosecond resolution. The thread is
+ * woken up by a timer interrupt programmed for its deadline, it stays on the
+ * CPU it slept on.
+ *
+ * @param time_ns The number of nanoseconds to wait.
+ * @returns The success or error code.
+ */
+OS_RETURN_E nanosleep(const uint64_t time_ns);
+
+/* Put the calling thread to sleep with a microsecond resolution, see
+ * nanosleep.
+ *
+ * @param time_us The number of microseconds to wait.
+ * @returns The success or error code.
+ */
+OS_RETURN_E usleep(const uint32_t time_us);
+
+/* Put the calling thread to sleep until an absolute time, see nanosleep.
+ *
+ * @param wakeup_ns The monotonic time to wake up at in nanoseconds.
+ * @returns The success or error code.
+ */
+OS_RETURN_E nanosleep_until(const uint64_t wakeup_ns);
+
+/* Initialize a periodic release timeline, the first release is one period
+ * after the call.
+ *
+ * @param period The timeline to initialize.
+ * @param period_us The period in microseconds.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E thread_period_init(thread_period_t* period,
+                               const uint32_t period_us);
+
+/* Put the calling thread to sleep until its next release. Releases are
+ * computed from the timeline, not from the wake up time, the work time and the
+ * wake up latency do not add up. The releases which passed while the thread
+ * was working are counted as overruns and skipped, the timeline keeps its
+ * phase. A call made at the release time is not an overrun.
+ *
+ * @param period The timeline of the thread.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E thread_period_wait(thread_period_t* period);
+
 /* Returns the number of existing threads
  *
  * @returns The number of alive thread (all but dead).
@@ -112,7 +321,31 @@ int32_t get_ppid(void);
  */
 uint32_t get_priority(void);
 
-/* Create a new thread in the thread table.
+/* Returns the thread executed by the current CPU. The thread is read from the
+ * CPU local area with a single instruction, it stays the same if the thread
+ * migrates right after.
+ *
+ * @returns The thread executed by the current CPU.
+ */
+kernel_thread_t* get_current_thread(void);
+
+/* Returns the last error reported to the current thread, read from its thread
+ * local storage.
+ *
+ * @returns The last error reported to the current thread, OS_NO_ERR if no
+ * error was reported.
+ */
+OS_RETURN_E get_last_error(void);
+
+/* Report an error to the current thread, the error is stored in its thread
+ * local storage. Nothing is stored before the scheduler is started on the CPU.
+ *
+ * @param error The error to report.
+ */
+void set_last_error(const OS_RETURN_E error);
+
+/* Create a new thread in the thread table, the thread can be executed by all
+ * the CPUs and gets a THREAD_STACK_SIZE bytes stack.
  *
  * @param thread The pointer to the thread structure.
  * @param function The thread routine to be executed.
@@ -127,6 +360,69 @@ OS_RETURN_E create_thread(thread_t* thread,
                           const char* name,
                           void* args);
 
+/* Create a new thread in the thread table, the thread is only executed by the
+ * CPUs of its affinity mask. The thread stack is allocated from the stacks
+ * pool, its size is rounded up to a power of two number of pages.
+ *
+ * @param thread The pointer to the thread structure.
+ * @param function The thread routine to be executed.
+ * @param priority The desired priority of the thread.
+ * @param name The name of the thread.
+ * @param args The arguments to be used by the thread.
+ * @param affinity The CPUs allowed to execute the thread, see
+ * THREAD_AFFINITY_CPU. At least one running CPU must be allowed.
+ * @param stack_size The size of the thread stack in bytes, between
+ * STACK_POOL_MIN_SIZE and STACK_POOL_MAX_SIZE.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E create_thread_affinity(thread_t* thread,
+                                   void* (*function)(void*),
+                                   const uint32_t priority,
+                                   const char* name,
+                                   void* args,
+                                   const uint32_t affinity,
+                                   const uint32_t stack_size);
+
+/* Set the CPUs allowed to execute a thread. A ready thread queued on a CPU it
+ * is no longer allowed on is moved to an allowed CPU, a running thread leaves
+ * its CPU at once. Deadline threads stay on the CPU they were admitted on.
+ *
+ * @param thread The thread to set the affinity of.
+ * @param affinity The CPUs allowed to execute the thread, see
+ * THREAD_AFFINITY_CPU. At least one running CPU must be allowed.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E set_thread_affinity(thread_t thread, const uint32_t affinity);
+
+/* Set the scheduling policy of a thread. Priority threads are executed by
+ * priority, fair threads share the CPU time given to the fair class, see
+ * SCHEDULE_FAIR_PRIORITY, in proportion of a weight given by their priority.
+ * Threads are created with the priority policy.
+ *
+ * @param thread The thread to set the policy of.
+ * @param policy The scheduling policy.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E set_thread_policy(thread_t thread, const SCHED_POLICY_E policy);
+
+/* Move a thread to the deadline scheduling class. Every period, the thread is
+ * guaranteed runtime microseconds of CPU before its relative deadline. Ready
+ * deadline threads are executed before the priority scheduled threads, earliest
+ * deadline first, a thread which consumed its runtime waits for its next
+ * period. The thread is pinned to the allowed CPU with the least reserved
+ * bandwidth. A runtime of 0 gives the thread back to the priority scheduler.
+ *
+ * @param thread The thread to set the deadline parameters of.
+ * @param runtime The CPU time given each period in microseconds.
+ * @param deadline The deadline relative to the period start in microseconds.
+ * @param period The period in microseconds, at most SCHEDULE_DL_MAX_PERIOD.
+ * @returns OS_NO_ERR on success, OS_ERR_OUT_OF_BOUND if the parameters do not
+ * satisfy runtime <= deadline <= period, OS_ERR_UNAUTHORIZED_ACTION if no
+ * allowed CPU has enough bandwidth left.
+ */
+OS_RETURN_E set_thread_deadline(thread_t thread, const uint32_t runtime,
+                                const uint32_t deadline, const uint32_t period);
+
 /* Remove a thread from the threads table. Wait for the thread to finish.
  *
  * @param thread The pointer to the thread structure.
@@ -156,6 +452,28 @@ OS_RETURN_E unlock_thread(kernel_list_node_t* node,
  */
 kernel_list_node_t* lock_thread(const BLOCK_TYPE_E block_type);
 
+/* Set the priority a thread inherits from the threads waiting for the mutexes
+ * it holds. The thread priority is raised to the inherited priority if it is
+ * higher. When the inherited priority is lowered, the thread gets back its
+ * initial priority or the new inherited priority if it is higher. A ready
+ * thread is moved to the FIFO of its new priority.
+ *
+ * @param thread The thread to set the inherited priority of.
+ * @param priority The inherited priority, KERNEL_LOWEST_PRIORITY when the
+ * thread does not inherit any priority.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E set_thread_inherited_priority(thread_t thread,
+                                          const uint32_t priority);
+
+/* Tells if a thread is executed by a CPU. The result is a hint, the thread may
+ * leave or get a CPU right after the check.
+ *
+ * @param thread The thread to check.
+ * @returns 1 if the thread is executed by a CPU, 0 otherwise.
+ */
+uint8_t is_thread_running(const kernel_thread_t* thread);
+
 /* Get all the system threads information.
  * The function will fill the structure given as parameter until there is no
  * more thread to gather information from or the function already gathered
@@ -170,4 +488,30 @@ kernel_list_node_t* lock_thread(const BLOCK_TYPE_E block_type);
  */
 OS_RETURN_E get_threads_info(thread_info_t* threads, int32_t* size);
 
+/* Add a value to a scheduler histogram, see SCHEDULE_HIST_BUCKETS. The
+ * histogram must not be updated concurrently.
+ *
+ * @param hist The histogram to update.
+ * @param value The value to add.
+ */
+void sched_hist_add(sched_histogram_t* hist, const uint64_t value);
+
+/* Get the scheduler statistics of a CPU, see sched_stats_t.
+ *
+ * @param cpu_id The id of the CPU.
+ * @param stats The buffer receiving the statistics.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E get_sched_stats(const uint32_t cpu_id, sched_stats_t* stats);
+
+/* Clear the scheduler statistics of all the CPUs, used to measure a tuning
+ * change from a clean state.
+ */
+void reset_sched_stats(void);
+
+/* Output the non empty scheduler histograms of all the CPUs on the serial
+ * port.
+ */
+void dump_sched_stats(void);
+
 #endif /* __SCHEDULER_H_ */
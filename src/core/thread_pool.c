@@ -0,0 +1,508 @@
+/*******************************************************************************
+ *
+ * File: thread_pool.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel thread pool. Tasks are submitted to a set of worker threads created
+ * once, one per CPU. parallel_for and parallel_reduce split an index range in
+ * chunks executed by the workers and the calling thread.
+ ******************************************************************************/
+
+#include "../lib/stdint.h"      /* Generic int types */
+#include "../lib/stddef.h"      /* OS_RETURN_E */
+#include "../cpu/smp.h"         /* get_booted_cpu_count, MAX_CPU_COUNT */
+#include "../sync/lock.h"       /* spinlock */
+#include "../sync/semaphore.h"  /* semaphore_t */
+#include "kernel_output.h"      /* kernel_error */
+#include "kernel_thread.h"      /* thread_t */
+#include "panic.h"              /* kernel_panic */
+#include "scheduler.h"          /* create_thread_affinity */
+
+#include "../debug.h"           /* kernel_serial_debug */
+
+/* Header file */
+#include "thread_pool.h"
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* parallel_for and parallel_reduce range chunk */
+typedef struct thread_pool_chunk
+{
+    thread_pool_task_t task;
+
+    /* Chunk range [first, last[ */
+    uint32_t           first;
+    uint32_t           last;
+
+    /* Chunk routine, parallel_for or parallel_reduce flavour */
+    void               (*for_body)(uint32_t, uint32_t, void*);
+    uint32_t           (*reduce_body)(uint32_t, uint32_t, void*);
+    void*              args;
+
+    uint32_t           result;
+} thread_pool_chunk_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************/
+
+/* Submitted tasks, FIFO */
+static thread_pool_task_t* tasks_head;
+static thread_pool_task_t* tasks_tail;
+static lock_t              tasks_lock;
+
+/* Counts the submitted tasks, the worker threads wait on it */
+static semaphore_t         tasks_sem;
+
+/* Set while the worker threads accept new tasks */
+static volatile uint8_t    pool_running;
+
+/* Worker threads */
+static thread_t            workers[MAX_CPU_COUNT];
+static uint32_t            worker_count;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Remove the first submitted task from the pool.
+ *
+ * @returns The task, NULL if no task is submitted.
+ */
+static thread_pool_task_t* thread_pool_pop(void)
+{
+    thread_pool_task_t* task;
+
+    spinlock_lock(&tasks_lock);
+    task = tasks_head;
+    if(task != NULL)
+    {
+        tasks_head = task->next;
+        if(tasks_head == NULL)
+        {
+            tasks_tail = NULL;
+        }
+    }
+    spinlock_unlock(&tasks_lock);
+
+    return task;
+}
+
+/* Execute a task and signal its completion to its group.
+ *
+ * @param task The task to execute.
+ */
+static void thread_pool_run(thread_pool_task_t* task)
+{
+    OS_RETURN_E          err;
+    thread_pool_group_t* group = task->group;
+
+    task->routine(task->args);
+
+    /* The group may be released as soon as the lock is released */
+    spinlock_lock(&group->lock);
+    if(--group->pending == 0)
+    {
+        err = sem_post(&group->done);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Thread pool group failure[%d]\n", err);
+            kernel_panic();
+        }
+    }
+    spinlock_unlock(&group->lock);
+}
+
+/* Pool worker thread routine. Executes the submitted tasks until the pool is
+ * stopped and empty.
+ *
+ * @param args Unused.
+ * @returns NULL always.
+ */
+static void* thread_pool_worker(void* args)
+{
+    OS_RETURN_E         err;
+    thread_pool_task_t* task;
+
+    (void)args;
+
+    while(1)
+    {
+        err = sem_pend(&tasks_sem);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Thread pool worker failure[%d]\n", err);
+            kernel_panic();
+        }
+
+        /* Waiting threads also execute tasks, the queue may be empty */
+        task = thread_pool_pop();
+        if(task != NULL)
+        {
+            thread_pool_run(task);
+        }
+        else if(pool_running == 0)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+OS_RETURN_E init_thread_pool(const uint32_t priority)
+{
+    OS_RETURN_E err;
+    uint32_t    count;
+    uint32_t    affinity;
+    uint32_t    i;
+
+    tasks_head = NULL;
+    tasks_tail = NULL;
+    spinlock_init(&tasks_lock);
+
+    err = sem_init(&tasks_sem, 0);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    count = get_booted_cpu_count();
+    if(count == 0 || count > MAX_CPU_COUNT)
+    {
+        count = 1;
+    }
+
+    /* The last CPU is kept for the latency critical threads (display) */
+    affinity = THREAD_AFFINITY_ALL;
+    if(count > 1)
+    {
+        --count;
+        affinity = THREAD_AFFINITY_CPU(count) - 1;
+    }
+
+    for(i = 0; i < count; ++i)
+    {
+        err = create_thread_affinity(&workers[i], thread_pool_worker, priority,
+                                     "pool", NULL, affinity,
+                                     THREAD_STACK_SIZE);
+        if(err != OS_NO_ERR)
+        {
+            break;
+        }
+        ++worker_count;
+    }
+
+    /* Keep the created workers, they are stopped with the pool */
+    pool_running = (worker_count > 0) ? 1 : 0;
+
+    #ifdef DEBUG_THREAD_POOL
+    kernel_serial_debug("Thread pool started, %d workers\n", worker_count);
+    #endif
+
+    return err;
+}
+
+OS_RETURN_E stop_thread_pool(void)
+{
+    OS_RETURN_E err;
+    uint32_t    i;
+
+    spinlock_lock(&tasks_lock);
+    if(pool_running == 0)
+    {
+        spinlock_unlock(&tasks_lock);
+        return OS_NO_ERR;
+    }
+    pool_running = 0;
+    spinlock_unlock(&tasks_lock);
+
+    /* Wake up each worker so it sees the pool is stopped */
+    for(i = 0; i < worker_count; ++i)
+    {
+        err = sem_post(&tasks_sem);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+    }
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E thread_pool_group_init(thread_pool_group_t* group)
+{
+    if(group == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    group->pending = 0;
+    spinlock_init(&group->lock);
+
+    return sem_init(&group->done, 0);
+}
+
+OS_RETURN_E thread_pool_submit(thread_pool_group_t* group,
+                               thread_pool_task_t* task)
+{
+    if(group == NULL || task == NULL || task->routine == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    task->group = group;
+    task->next  = NULL;
+
+    spinlock_lock(&group->lock);
+    ++group->pending;
+    spinlock_unlock(&group->lock);
+
+    spinlock_lock(&tasks_lock);
+    if(pool_running == 0)
+    {
+        spinlock_unlock(&tasks_lock);
+        thread_pool_run(task);
+        return OS_NO_ERR;
+    }
+
+    if(tasks_tail != NULL)
+    {
+        tasks_tail->next = task;
+    }
+    else
+    {
+        tasks_head = task;
+    }
+    tasks_tail = task;
+    spinlock_unlock(&tasks_lock);
+
+    return sem_post(&tasks_sem);
+}
+
+OS_RETURN_E thread_pool_wait(thread_pool_group_t* group)
+{
+    OS_RETURN_E         err;
+    thread_pool_task_t* task;
+
+    if(group == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    /* Help the workers instead of blocking, this also avoids deadlocks when
+     * a task waits for other tasks.
+     */
+    while(group->pending != 0)
+    {
+        task = thread_pool_pop();
+        if(task != NULL)
+        {
+            thread_pool_run(task);
+            continue;
+        }
+
+        /* The semaphore may have been posted for an earlier completion */
+        err = sem_pend(&group->done);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+    }
+
+    /* Wait for the last task to release the group */
+    spinlock_lock(&group->lock);
+    spinlock_unlock(&group->lock);
+
+    return sem_destroy(&group->done);
+}
+
+/* Parallel for chunk task routine.
+ *
+ * @param args The chunk to execute.
+ */
+static void parallel_for_chunk(void* args)
+{
+    thread_pool_chunk_t* chunk = (thread_pool_chunk_t*)args;
+
+    chunk->for_body(chunk->first, chunk->last, chunk->args);
+}
+
+/* Parallel reduce chunk task routine.
+ *
+ * @param args The chunk to execute.
+ */
+static void parallel_reduce_chunk(void* args)
+{
+    thread_pool_chunk_t* chunk = (thread_pool_chunk_t*)args;
+
+    chunk->result = chunk->reduce_body(chunk->first, chunk->last, chunk->args);
+}
+
+/* Split the range [start, end[ in chunks and execute them. The first chunk is
+ * executed by the calling thread.
+ *
+ * @param chunks The chunks buffer, its body and args fields must be set for
+ * the THREAD_POOL_MAX_CHUNKS chunks.
+ * @param start The first index of the range.
+ * @param end The index following the last index of the range.
+ * @param grain The minimal number of indexes of a chunk.
+ * @param routine The chunk task routine.
+ * @param count The buffer receiving the number of chunks used.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E parallel_run(thread_pool_chunk_t* chunks,
+                                const uint32_t start, const uint32_t end,
+                                const uint32_t grain,
+                                void (*routine)(void*),
+                                uint32_t* count)
+{
+    OS_RETURN_E         err;
+    thread_pool_group_t group;
+    uint32_t            size;
+    uint32_t            base;
+    uint32_t            extra;
+    uint32_t            i;
+
+    size = end - start;
+
+    /* One chunk per worker plus the calling thread */
+    *count = (pool_running == 1) ? worker_count + 1 : 1;
+    if(*count > THREAD_POOL_MAX_CHUNKS)
+    {
+        *count = THREAD_POOL_MAX_CHUNKS;
+    }
+    if(grain > 1 && *count > size / grain)
+    {
+        *count = (size / grain > 0) ? size / grain : 1;
+    }
+    if(*count > size)
+    {
+        *count = size;
+    }
+
+    /* The first chunks get the remaining indexes */
+    base  = size / *count;
+    extra = size % *count;
+    for(i = 0; i < *count; ++i)
+    {
+        chunks[i].task.routine = routine;
+        chunks[i].task.args    = &chunks[i];
+        chunks[i].first        = start + i * base + ((i < extra) ? i : extra);
+        chunks[i].last         = chunks[i].first + base + ((i < extra) ? 1 : 0);
+    }
+
+    if(*count == 1)
+    {
+        routine(&chunks[0]);
+        return OS_NO_ERR;
+    }
+
+    err = thread_pool_group_init(&group);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    for(i = 1; i < *count; ++i)
+    {
+        err = thread_pool_submit(&group, &chunks[i].task);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not submit parallel chunk[%d]\n", err);
+            kernel_panic();
+        }
+    }
+
+    routine(&chunks[0]);
+
+    return thread_pool_wait(&group);
+}
+
+OS_RETURN_E parallel_for(const uint32_t start, const uint32_t end,
+                         const uint32_t grain,
+                         void (*body)(uint32_t, uint32_t, void*),
+                         void* args)
+{
+    thread_pool_chunk_t chunks[THREAD_POOL_MAX_CHUNKS];
+    uint32_t            count;
+    uint32_t            i;
+
+    if(body == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+    if(start > end)
+    {
+        return OS_ERR_OUT_OF_BOUND;
+    }
+    if(start == end)
+    {
+        return OS_NO_ERR;
+    }
+
+    for(i = 0; i < THREAD_POOL_MAX_CHUNKS; ++i)
+    {
+        chunks[i].for_body = body;
+        chunks[i].args     = args;
+    }
+
+    return parallel_run(chunks, start, end, grain, parallel_for_chunk, &count);
+}
+
+OS_RETURN_E parallel_reduce(const uint32_t start, const uint32_t end,
+                            const uint32_t grain,
+                            uint32_t (*body)(uint32_t, uint32_t, void*),
+                            uint32_t (*reduce)(uint32_t, uint32_t),
+                            const uint32_t identity,
+                            void* args,
+                            uint32_t* result)
+{
+    OS_RETURN_E         err;
+    thread_pool_chunk_t chunks[THREAD_POOL_MAX_CHUNKS];
+    uint32_t            count;
+    uint32_t            i;
+
+    if(body == NULL || reduce == NULL || result == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+    if(start > end)
+    {
+        return OS_ERR_OUT_OF_BOUND;
+    }
+
+    *result = identity;
+    if(start == end)
+    {
+        return OS_NO_ERR;
+    }
+
+    for(i = 0; i < THREAD_POOL_MAX_CHUNKS; ++i)
+    {
+        chunks[i].reduce_body = body;
+        chunks[i].args        = args;
+    }
+
+    err = parallel_run(chunks, start, end, grain, parallel_reduce_chunk,
+                       &count);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    /* Combine the results in the range order */
+    for(i = 0; i < count; ++i)
+    {
+        *result = reduce(*result, chunks[i].result);
+    }
+
+    return OS_NO_ERR;
+}
@@ -0,0 +1,149 @@
+/*******************************************************************************
+ *
+ * File: thread_pool.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel thread pool. Tasks are submitted to a set of worker threads created
+ * once, one per CPU. parallel_for and parallel_reduce split an index range in
+ * chunks executed by the workers and the calling thread.
+ ******************************************************************************/
+
+#ifndef __THREAD_POOL_H_
+#define __THREAD_POOL_H_
+
+#include "../lib/stdint.h"     /* Generic int types */
+#include "../lib/stddef.h"     /* OS_RETURN_E */
+#include "../sync/lock.h"      /* lock_t */
+#include "../sync/semaphore.h" /* semaphore_t */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Priority of the pool worker threads */
+#define THREAD_POOL_PRIORITY   4
+
+/* Maximal number of chunks a parallel_for or parallel_reduce range is split
+ * in
+ */
+#define THREAD_POOL_MAX_CHUNKS 16
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+struct thread_pool_group;
+
+/* Pool task. The task must stay valid until its group is waited. */
+typedef struct thread_pool_task
+{
+    /* Routine executed by the worker thread and its argument */
+    void                      (*routine)(void*);
+    void*                     args;
+
+    struct thread_pool_group* group;
+    struct thread_pool_task*  next;
+} thread_pool_task_t;
+
+/* Group of tasks waited together */
+typedef struct thread_pool_group
+{
+    /* Number of submitted tasks not completed yet */
+    volatile uint32_t pending;
+
+    /* Posted when the last pending task completes */
+    semaphore_t       done;
+
+    lock_t            lock;
+} thread_pool_group_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Create the pool worker threads, one per CPU. On multiprocessor systems the
+ * last CPU is kept for the latency critical threads and gets no worker. Called
+ * by the INIT thread before calling main.
+ *
+ * @param priority The priority of the worker threads.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E init_thread_pool(const uint32_t priority);
+
+/* Stop the pool worker threads once the submitted tasks are executed. The
+ * tasks submitted after are executed by the submitting thread.
+ *
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E stop_thread_pool(void);
+
+/* Initialize a group of tasks.
+ *
+ * @param group The group to initialize.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E thread_pool_group_init(thread_pool_group_t* group);
+
+/* Submit a task to the pool. The task is executed by the calling thread if
+ * the pool is not running.
+ *
+ * @param group The group the task belongs to.
+ * @param task The task to execute, its routine must be set.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E thread_pool_submit(thread_pool_group_t* group,
+                               thread_pool_task_t* task);
+
+/* Wait for the tasks of a group to complete. The calling thread executes the
+ * queued tasks while waiting. The group must be initialized again before
+ * being reused.
+ *
+ * @param group The group to wait.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E thread_pool_wait(thread_pool_group_t* group);
+
+/* Execute a routine on the index range [start, end[ split in chunks of at
+ * least grain indexes. The chunks are executed by the pool workers and the
+ * calling thread, the function returns when all of them are executed.
+ *
+ * @param start The first index of the range.
+ * @param end The index following the last index of the range.
+ * @param grain The minimal number of indexes of a chunk.
+ * @param body The routine executed on the chunk [first, last[.
+ * @param args The argument given to the routine.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E parallel_for(const uint32_t start, const uint32_t end,
+                         const uint32_t grain,
+                         void (*body)(uint32_t, uint32_t, void*),
+                         void* args);
+
+/* Execute a routine on the index range [start, end[ split in chunks of at
+ * least grain indexes and combine the chunks results. See parallel_for.
+ *
+ * @param start The first index of the range.
+ * @param end The index following the last index of the range.
+ * @param grain The minimal number of indexes of a chunk.
+ * @param body The routine executed on the chunk [first, last[, returns the
+ * chunk result.
+ * @param reduce The routine combining two results, it must be associative.
+ * @param identity The result of an empty range.
+ * @param args The argument given to the body routine.
+ * @param result The buffer receiving the combined result.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E parallel_reduce(const uint32_t start, const uint32_t end,
+                            const uint32_t grain,
+                            uint32_t (*body)(uint32_t, uint32_t, void*),
+                            uint32_t (*reduce)(uint32_t, uint32_t),
+                            const uint32_t identity,
+                            void* args,
+                            uint32_t* result);
+
+#endif /* __THREAD_POOL_H_ */
@@ -0,0 +1,302 @@
+/*******************************************************************************
+ *
+ * File: workqueue.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel work queues. Interrupt handlers queue work items which are executed
+ * later by a worker thread, with interrupts enabled. Each CPU has its own queue
+ * and worker thread. A work item is never executed by two workers at once.
+ ******************************************************************************/
+
+#include "../lib/stdint.h"      /* Generic int types */
+#include "../lib/stddef.h"      /* OS_RETURN_E */
+#include "../cpu/cpu.h"         /* cpu_test_and_set */
+#include "../cpu/smp.h"         /* get_cpu_id, get_booted_cpu_count */
+#include "../sync/lock.h"       /* spinlock */
+#include "../sync/semaphore.h"  /* semaphore_t */
+#include "interrupts.h"         /* disable_local_interrupt */
+#include "kernel_output.h"      /* kernel_error */
+#include "kernel_thread.h"      /* thread_t */
+#include "panic.h"              /* kernel_panic */
+#include "scheduler.h"          /* create_thread_affinity */
+
+#include "../debug.h"           /* kernel_serial_debug */
+
+/* Header file */
+#include "workqueue.h"
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* CPU work queue */
+typedef struct workqueue
+{
+    /* Queued items, FIFO */
+    work_t*          head;
+    work_t*          tail;
+
+    /* Counts the queued items, the worker thread waits on it */
+    semaphore_t      sem;
+
+    /* Set while the worker thread accepts new items */
+    volatile uint8_t running;
+
+    thread_t         worker;
+
+    lock_t           lock;
+} workqueue_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************/
+
+/* Work queues, one per CPU */
+static workqueue_t workqueues[MAX_CPU_COUNT];
+
+/* Number of worker threads */
+static uint32_t    worker_count;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Worker thread routine. Executes the items of its queue until the queue is
+ * stopped and empty.
+ *
+ * @param args The work queue of the thread.
+ * @returns NULL always.
+ */
+static void* workqueue_worker(void* args)
+{
+    OS_RETURN_E  err;
+    workqueue_t* queue = (workqueue_t*)args;
+    work_t*      work;
+
+    while(1)
+    {
+        err = sem_pend(&queue->sem);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Work queue worker failure[%d]\n", err);
+            kernel_panic();
+        }
+
+        spinlock_lock(&queue->lock);
+        work = queue->head;
+        if(work != NULL)
+        {
+            queue->head = work->next;
+            if(queue->head == NULL)
+            {
+                queue->tail = NULL;
+            }
+
+            /* The item can be queued again while its routine executes, the
+             * running flag is set before the pending flag is cleared so
+             * queue_work sees the item is running
+             */
+            work->next    = NULL;
+            work->running = 1;
+            work->pending = 0;
+        }
+        else if(queue->running == 0)
+        {
+            spinlock_unlock(&queue->lock);
+            break;
+        }
+        spinlock_unlock(&queue->lock);
+
+        if(work == NULL)
+        {
+            continue;
+        }
+
+        work->routine(work->args);
+
+        work->running = 0;
+    }
+
+    #ifdef DEBUG_WORKQUEUE
+    kernel_serial_debug("Worker thread 0x%08x stopped\n", (uint32_t)queue);
+    #endif
+
+    return NULL;
+}
+
+OS_RETURN_E init_workqueues(const uint32_t priority)
+{
+    OS_RETURN_E  err;
+    workqueue_t* queue;
+    uint32_t     i;
+
+    worker_count = get_booted_cpu_count();
+    if(worker_count == 0 || worker_count > MAX_CPU_COUNT)
+    {
+        worker_count = 1;
+    }
+
+    for(i = 0; i < worker_count; ++i)
+    {
+        queue = &workqueues[i];
+
+        queue->head = NULL;
+        queue->tail = NULL;
+
+        spinlock_init(&queue->lock);
+
+        err = sem_init(&queue->sem, 0);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+
+        /* The worker executes the items queued on its CPU */
+        err = create_thread_affinity(&queue->worker, workqueue_worker,
+                                     priority, "kworker", queue,
+                                     THREAD_AFFINITY_CPU(i),
+                                     THREAD_STACK_SIZE);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+
+        queue->running = 1;
+    }
+
+    #ifdef DEBUG_WORKQUEUE
+    kernel_serial_debug("Created %d worker threads, priority %d\n",
+                        worker_count, priority);
+    #endif
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E stop_workqueues(void)
+{
+    OS_RETURN_E  err;
+    workqueue_t* queue;
+    uint32_t     i;
+
+    for(i = 0; i < worker_count; ++i)
+    {
+        queue = &workqueues[i];
+
+        spinlock_lock(&queue->lock);
+        if(queue->running == 0)
+        {
+            spinlock_unlock(&queue->lock);
+            continue;
+        }
+        queue->running = 0;
+        spinlock_unlock(&queue->lock);
+
+        /* Wake up the worker so it sees the queue is stopped */
+        err = sem_post(&queue->sem);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+    }
+
+    /* The queues can only be initialized again once the workers exited */
+    for(i = 0; i < worker_count; ++i)
+    {
+        queue = &workqueues[i];
+        if(queue->worker == NULL)
+        {
+            continue;
+        }
+
+        err = wait_thread(queue->worker, NULL);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+        queue->worker = NULL;
+    }
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E work_init(work_t* work, void (*routine)(void*), void* args)
+{
+    if(work == NULL || routine == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    work->routine = routine;
+    work->args    = args;
+    work->pending = 0;
+    work->running = 0;
+    work->queue   = NULL;
+    work->next    = NULL;
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E queue_work(work_t* work)
+{
+    workqueue_t* queue;
+    uint32_t     cpu_id;
+
+    if(work == NULL || work->routine == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    disable_local_interrupt();
+
+    /* The item is already queued, its routine is not executed yet */
+    if(cpu_test_and_set(&work->pending) == 1)
+    {
+        enable_local_interrupt();
+        return OS_NO_ERR;
+    }
+
+    /* An executing item goes back to the queue executing it, the worker only
+     * executes it once the routine returned
+     */
+    if(work->running == 1 && work->queue != NULL)
+    {
+        queue = work->queue;
+    }
+    else
+    {
+        cpu_id = get_cpu_id();
+        queue  = &workqueues[(cpu_id < worker_count) ? cpu_id : 0];
+    }
+
+    spinlock_lock(&queue->lock);
+
+    if(queue->running == 0)
+    {
+        work->pending = 0;
+        spinlock_unlock(&queue->lock);
+        enable_local_interrupt();
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    work->queue = queue;
+    work->next  = NULL;
+    if(queue->tail != NULL)
+    {
+        queue->tail->next = work;
+    }
+    else
+    {
+        queue->head = work;
+    }
+    queue->tail = work;
+
+    spinlock_unlock(&queue->lock);
+    enable_local_interrupt();
+
+    return sem_post(&queue->sem);
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ *
+ * File: workqueue.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel work queues. Interrupt handlers queue work items which are executed
+ * later by a worker thread, with interrupts enabled. Each CPU has its own queue
+ * and worker thread. A work item is never executed by two workers at once.
+ ******************************************************************************/
+
+#ifndef __WORKQUEUE_H_
+#define __WORKQUEUE_H_
+
+#include "../lib/stdint.h" /* Generic int types */
+#include "../lib/stddef.h" /* OS_RETURN_E */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Priority of the worker threads */
+#define WORKQUEUE_THREAD_PRIORITY 2
+
+/* Static work item initializer.
+ *
+ * @param work_routine The routine executed by the worker thread.
+ * @param work_args The argument given to the routine.
+ */
+#define WORK_INIT(work_routine, work_args)            \
+    {                                                 \
+        (work_routine), (work_args), 0, 0, NULL, NULL \
+    }
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Forward declaration */
+struct workqueue;
+
+/* Work item, see WORK_INIT. The item must stay valid while it is queued and
+ * while its routine executes: the worker clears the running flag after the
+ * routine returns, the routine cannot free or reuse its own item.
+ */
+typedef struct work
+{
+    /* Routine executed by the worker thread and its argument */
+    void              (*routine)(void*);
+    void*             args;
+
+    /* Set while the item is queued */
+    volatile uint32_t pending;
+
+    /* Set while the routine executes, the item is then queued again on the
+     * queue executing it
+     */
+    volatile uint32_t running;
+    struct workqueue* queue;
+
+    struct work*      next;
+} work_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Create the worker thread of each CPU, pinned to its CPU. Called by the INIT
+ * thread before calling main.
+ *
+ * @param priority The priority of the worker threads.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E init_workqueues(const uint32_t priority);
+
+/* Stop the worker threads and wait for them to exit. The queued items are
+ * executed before the threads exit, queue_work then fails and the work must be
+ * done by the caller. The queues can then be started again with
+ * init_workqueues.
+ *
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E stop_workqueues(void);
+
+/* Initialize a work item.
+ *
+ * @param work The work item to initialize.
+ * @param routine The routine executed by the worker thread.
+ * @param args The argument given to the routine.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E work_init(work_t* work, void (*routine)(void*), void* args);
+
+/* Queue a work item on the current CPU queue. The function can be called from
+ * interrupt handlers. An item which is already queued is not queued twice, its
+ * routine is executed once. An item which routine is executing is queued on the
+ * queue executing it so the routine is never executed concurrently.
+ *
+ * @param work The work item to queue.
+ * @returns OS_NO_ERR if the item is queued, OS_ERR_UNAUTHORIZED_ACTION if the
+ * worker threads are not running, in which case the caller executes the work
+ * itself.
+ */
+OS_RETURN_E queue_work(work_t* work);
+
+#endif /* __WORKQUEUE_H_ */
@@ -42,6 +42,7 @@
 #define BIT_RDRND   (1 << 30)
 
 /* %edx */
+#define BIT_TSC     (1 << 4)
 #define BIT_CMPXCHG8B   (1 << 8)
 #define BIT_CMOV    (1 << 15)
 #define BIT_MMX     (1 << 23)
@@ -408,6 +409,40 @@ __inline__ static uint32_t cpu_compare_and_swap(volatile uint32_t* p_val,
     return prev;
 }
 
+/* Exchange word atomicaly.
+ *
+ * @returns The previous value of the word.
+ * @param p_val The pointer to the word.
+ * @param newval The value to store.
+ */
+__inline__ static uint32_t cpu_exchange(volatile uint32_t* p_val,
+                                        uint32_t newval)
+{
+    __asm__ __volatile__ (
+            "xchg %0, %1\n"
+                : "+r" (newval), "+m" (*p_val)
+                :
+                : "memory");
+    return newval;
+}
+
+/* Add a value to a word atomicaly.
+ *
+ * @returns The previous value of the word.
+ * @param p_val The pointer to the word.
+ * @param inc The value to add, may be negative.
+ */
+__inline__ static uint32_t cpu_fetch_add(volatile uint32_t* p_val,
+                                         int32_t inc)
+{
+    __asm__ __volatile__ (
+            "lock xadd %0, %1\n"
+                : "+r" (inc), "+m" (*p_val)
+                :
+                : "memory");
+    return (uint32_t)inc;
+}
+
 /* Test and set atomic operation.
  *
  * @param lock The spinlock to apply the test on.
@@ -417,6 +452,14 @@ __inline__ static int cpu_test_and_set(volatile uint32_t* lock)
         return cpu_compare_and_swap(lock, 0, 1);
 }
 
+/* Spin loop hint, lowers the power used and the memory order violations
+ * penalty when the loop exits.
+ */
+__inline__ static void cpu_pause(void)
+{
+    __asm__ __volatile__("pause" ::: "memory");
+}
+
 /* Read the current value of the CPU's time-stamp counter and store into
  * EDX:EAX. The time-stamp counter contains the amount of clock ticks that have
  * elapsed since the last CPU reset. The value is stored in a 64-bit MSR and is
@@ -431,6 +474,55 @@ __inline__ static uint64_t rdtsc()
     return ret;
 }
 
+/* Bit scan forward, returns the index of the least significant bit set in the
+ * value given as parameter. The result is undefined if the value is 0.
+ *
+ * @param value The value to scan.
+ * @return The index of the least significant bit set.
+ */
+__inline__ static uint32_t cpu_bsf(const uint32_t value)
+{
+    uint32_t index;
+    __asm__ __volatile__("bsf %1, %0" : "=r"(index) : "rm"(value));
+    return index;
+}
+
+/* Bit scan reverse, returns the index of the most significant bit set in the
+ * value given as parameter. The result is undefined if the value is 0.
+ *
+ * @param value The value to scan.
+ * @return The index of the most significant bit set.
+ */
+__inline__ static uint32_t cpu_bsr(const uint32_t value)
+{
+    uint32_t index;
+    __asm__ __volatile__("bsr %1, %0" : "=r"(index) : "rm"(value));
+    return index;
+}
+
+/* Divide a 64 bits value by a 32 bits value, the quotient must fit in 32
+ * bits. The kernel is not linked with the compiler 64 bits division helpers.
+ *
+ * @param dividend The value to divide.
+ * @param divisor The divisor.
+ * @return The quotient.
+ */
+__inline__ static uint32_t cpu_udiv_64_32(const uint64_t dividend,
+                                          const uint32_t divisor)
+{
+    uint32_t quotient;
+    uint32_t remainder;
+
+    __asm__ __volatile__("divl %4"
+                         : "=a"(quotient), "=d"(remainder)
+                         : "a"((uint32_t)dividend),
+                           "d"((uint32_t)(dividend >> 32)),
+                           "rm"(divisor));
+    (void)remainder;
+
+    return quotient;
+}
+
 /*******************************************************************************
  * Memory mapped IOs, avoid compilers to reorganize memory access
  *
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ *
+ * File: cpu_local.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * X86 abstraction: CPU local storage. Each CPU GS segment points to its own
+ * CPU local area and the FS segment to the thread local storage block of the
+ * thread it executes. The fields are accessed with a single segment relative
+ * instruction, without locking nor disabling the interrupts.
+ ******************************************************************************/
+
+#ifndef __CPU_LOCAL_H_
+#define __CPU_LOCAL_H_
+
+#include "../lib/stdint.h" /* Generic int types */
+
+/* Forward declaration */
+struct kernel_thread;
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* CPU local area, pointed by GS. The fields must be 32 bits wide. */
+typedef struct cpu_local
+{
+    /* Linear address of the area */
+    struct cpu_local*     self;
+
+    /* Id of the CPU owning the area */
+    uint32_t              cpu_id;
+
+    /* Thread executed by the CPU, set by the scheduler */
+    struct kernel_thread* current_thread;
+} cpu_local_t;
+
+/*******************************************************************************
+ * MACROS
+ ******************************************************************************/
+
+/* Read a 32 bits field of the structure pointed by a segment register.
+ *
+ * @param seg The segment register, fs or gs.
+ * @param type The type of the structure.
+ * @param field The field to read.
+ * @returns The value of the field.
+ */
+#define SEGMENT_LOCAL_READ(seg, type, field)                            \
+    ({                                                                  \
+        uint32_t __val;                                                 \
+        __asm__ __volatile__("movl %%" #seg ":%c1, %0"                  \
+                             : "=r" (__val)                             \
+                             : "i" (__builtin_offsetof(type, field)));  \
+        (__typeof__(((type*)0)->field))__val;                           \
+    })
+
+/* Write a 32 bits field of the structure pointed by a segment register.
+ *
+ * @param seg The segment register, fs or gs.
+ * @param type The type of the structure.
+ * @param field The field to write.
+ * @param val The value to write.
+ */
+#define SEGMENT_LOCAL_WRITE(seg, type, field, val)                      \
+    __asm__ __volatile__("movl %0, %%" #seg ":%c1"                      \
+                         :: "r" ((uint32_t)(val)),                      \
+                            "i" (__builtin_offsetof(type, field))       \
+                         : "memory")
+
+/* Access the CPU local area of the current CPU. The CPU may change right after
+ * the access if the interrupts are enabled.
+ */
+#define CPU_LOCAL_READ(field) SEGMENT_LOCAL_READ(gs, cpu_local_t, field)
+#define CPU_LOCAL_WRITE(field, val) \
+    SEGMENT_LOCAL_WRITE(gs, cpu_local_t, field, val)
+
+#endif /* __CPU_LOCAL_H_ */
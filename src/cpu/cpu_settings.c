@@ -15,6 +15,8 @@
 #include "../lib/string.h"         /* memset */
 #include "../lib/stdint.h"         /* Generic int types */
 #include "../core/kernel_output.h" /* kernel_success */
+#include "smp.h"                   /* get_cpu_id, MAX_CPU_COUNT */
+#include "cpu_local.h"             /* cpu_local_t */
 
 /* Header file */
 #include "cpu_settings.h"
@@ -36,6 +38,17 @@ extern uint32_t cpu_idt_base;
 /* Kernel main TSS */
 static cpu_tss_entry_t cpu_main_tss __attribute__((aligned(4096)));
 
+/* Application processors GDTs and TSSs, the entry 0 belongs to the main CPU and
+ * is not used.
+ */
+static uint64_t        cpu_ap_gdt[MAX_CPU_COUNT][GDT_ENTRY_COUNT]
+                       __attribute__((aligned(8)));
+static cpu_table_ptr_t cpu_ap_gdt_ptr[MAX_CPU_COUNT];
+static cpu_tss_entry_t cpu_ap_tss[MAX_CPU_COUNT] __attribute__((aligned(4096)));
+
+/* CPUs local areas, pointed by the GS segment of each CPU */
+static cpu_local_t cpu_local_area[MAX_CPU_COUNT];
+
 extern uint32_t* kernel_stack;
 
 /*******************************************************************************
@@ -648,6 +661,37 @@ static void format_idt_entry(volatile uint64_t* entry,
     *entry = lo_part | (((uint64_t) hi_part) << 32);
 }
 
+/* Init the CPU local area of a CPU and format the CPU local and thread local
+ * storage entries of its GDT. The thread local storage segment is empty until
+ * the scheduler sets it.
+ *
+ * @param gdt The GDT of the CPU.
+ * @param cpu_id The id of the CPU.
+ */
+static void format_local_entries(uint64_t* gdt, const uint32_t cpu_id)
+{
+    uint32_t local_seg_flags = GDT_FLAG_GRANULARITY_BYTE |
+                               GDT_FLAG_32_BIT_SEGMENT |
+                               GDT_FLAG_PL0 |
+                               GDT_FLAG_SEGMENT_PRESENT |
+                               GDT_FLAG_DATA_TYPE;
+
+    uint32_t local_seg_type =  GDT_TYPE_WRITABLE |
+                               GDT_TYPE_GROW_DOWN;
+
+    memset(&cpu_local_area[cpu_id], 0, sizeof(cpu_local_t));
+    cpu_local_area[cpu_id].self   = &cpu_local_area[cpu_id];
+    cpu_local_area[cpu_id].cpu_id = cpu_id;
+
+    format_gdt_entry(&gdt[KERNEL_CPU_LOCAL_SEGMENT / 8],
+                     (uint32_t)&cpu_local_area[cpu_id],
+                     sizeof(cpu_local_t) - 1,
+                     local_seg_type, local_seg_flags);
+
+    format_gdt_entry(&gdt[KERNEL_TLS_SEGMENT / 8], 0, 0,
+                     local_seg_type, local_seg_flags);
+}
+
 void setup_gdt(void)
 {
     /************************************
@@ -795,6 +839,8 @@ void setup_gdt(void)
                      ((uint32_t)(&cpu_main_tss)) + sizeof(cpu_tss_entry_t),
                      tss_seg_type, tss_seg_flags);
 
+    format_local_entries(cpu_gdt, 0);
+
     /* Set the GDT descriptor */
     cpu_gdt_size = ((sizeof(uint64_t) * GDT_ENTRY_COUNT) - 1);
     cpu_gdt_base = (uint32_t)&cpu_gdt;
@@ -805,8 +851,8 @@ void setup_gdt(void)
     /* Load segment selectors with a far jump for CS*/
     __asm__ __volatile__("movw %w0,%%ds" :: "r" (KERNEL_DS));
     __asm__ __volatile__("movw %w0,%%es" :: "r" (KERNEL_DS));
-    __asm__ __volatile__("movw %w0,%%fs" :: "r" (KERNEL_DS));
-    __asm__ __volatile__("movw %w0,%%gs" :: "r" (KERNEL_DS));
+    __asm__ __volatile__("movw %w0,%%fs" :: "r" (KERNEL_TLS_SEGMENT));
+    __asm__ __volatile__("movw %w0,%%gs" :: "r" (KERNEL_CPU_LOCAL_SEGMENT));
     __asm__ __volatile__("movw %w0,%%ss" :: "r" (KERNEL_DS));
     __asm__ __volatile__("ljmp %0, $flab \n\t flab: \n\t" :: "i" (KERNEL_CS));
 
@@ -863,3 +909,105 @@ void setup_tss(void)
 
     kernel_success("TSS Initialized at 0x%08x\n", &cpu_main_tss);
 }
+
+void setup_ap_gdt(const uint32_t cpu_id)
+{
+    uint32_t tss_seg_flags = GDT_FLAG_32_BIT_SEGMENT |
+                             GDT_FLAG_SEGMENT_PRESENT |
+                             GDT_FLAG_PL0;
+
+    uint32_t tss_seg_type = GDT_TYPE_ACCESSED |
+                            GDT_TYPE_EXECUTABLE;
+
+    if(cpu_id == 0 || cpu_id >= MAX_CPU_COUNT)
+    {
+        return;
+    }
+
+    /* Copy the main GDT, the TSS entry is formated again since the main TSS
+     * descriptor is marked busy. The local entries point to the AP's areas.
+     */
+    memcpy(cpu_ap_gdt[cpu_id], cpu_gdt, sizeof(uint64_t) * GDT_ENTRY_COUNT);
+
+    format_gdt_entry(&cpu_ap_gdt[cpu_id][TSS_SEGMENT / 8],
+                     (uint32_t)&cpu_ap_tss[cpu_id],
+                     ((uint32_t)(&cpu_ap_tss[cpu_id])) +
+                     sizeof(cpu_tss_entry_t),
+                     tss_seg_type, tss_seg_flags);
+
+    format_local_entries(cpu_ap_gdt[cpu_id], cpu_id);
+
+    /* Set the GDT descriptor */
+    cpu_ap_gdt_ptr[cpu_id].size = ((sizeof(uint64_t) * GDT_ENTRY_COUNT) - 1);
+    cpu_ap_gdt_ptr[cpu_id].base = (uint32_t)&cpu_ap_gdt[cpu_id];
+
+    /* Load the GDT */
+    __asm__ __volatile__("lgdt %0" :: "m" (cpu_ap_gdt_ptr[cpu_id]));
+
+    /* Load segment selectors with a far jump for CS*/
+    __asm__ __volatile__("movw %w0,%%ds" :: "r" (KERNEL_DS));
+    __asm__ __volatile__("movw %w0,%%es" :: "r" (KERNEL_DS));
+    __asm__ __volatile__("movw %w0,%%fs" :: "r" (KERNEL_TLS_SEGMENT));
+    __asm__ __volatile__("movw %w0,%%gs" :: "r" (KERNEL_CPU_LOCAL_SEGMENT));
+    __asm__ __volatile__("movw %w0,%%ss" :: "r" (KERNEL_DS));
+    __asm__ __volatile__("ljmp %0, $1f \n\t 1: \n\t" :: "i" (KERNEL_CS));
+}
+
+void setup_ap_idt(void)
+{
+    /* Load the IDT */
+    __asm__ __volatile__("lidt %0" :: "m" (cpu_idt_size), "m" (cpu_idt_base));
+}
+
+void setup_ap_tss(const uint32_t cpu_id, const uint32_t kernel_stack_top)
+{
+    if(cpu_id == 0 || cpu_id >= MAX_CPU_COUNT)
+    {
+        return;
+    }
+
+    /* Blank the TSS */
+    memset(&cpu_ap_tss[cpu_id], 0, sizeof(cpu_tss_entry_t));
+
+    /* Set basic values */
+    cpu_ap_tss[cpu_id].ss0  = KERNEL_DS;
+    cpu_ap_tss[cpu_id].esp0 = kernel_stack_top;
+
+    cpu_ap_tss[cpu_id].es = KERNEL_DS;
+    cpu_ap_tss[cpu_id].cs = KERNEL_CS;
+    cpu_ap_tss[cpu_id].ss = KERNEL_DS;
+    cpu_ap_tss[cpu_id].ds = KERNEL_DS;
+    cpu_ap_tss[cpu_id].fs = KERNEL_DS;
+    cpu_ap_tss[cpu_id].gs = KERNEL_DS;
+
+    cpu_ap_tss[cpu_id].iomap_base = sizeof(cpu_tss_entry_t);
+
+    /* Load TSS */
+    __asm__ __volatile__("ltr %0" : : "rm" ((uint16_t)(TSS_SEGMENT)));
+}
+
+void cpu_set_tls(const uint32_t base, const uint32_t size)
+{
+    uint32_t  cpu_id;
+    uint64_t* gdt;
+
+    uint32_t tls_seg_flags = GDT_FLAG_GRANULARITY_BYTE |
+                             GDT_FLAG_32_BIT_SEGMENT |
+                             GDT_FLAG_PL0 |
+                             GDT_FLAG_SEGMENT_PRESENT |
+                             GDT_FLAG_DATA_TYPE;
+
+    uint32_t tls_seg_type =  GDT_TYPE_WRITABLE |
+                             GDT_TYPE_GROW_DOWN;
+
+    cpu_id = get_cpu_id();
+    gdt    = (cpu_id == 0) ? cpu_gdt : cpu_ap_gdt[cpu_id];
+
+    format_gdt_entry(&gdt[KERNEL_TLS_SEGMENT / 8], base,
+                     (size == 0) ? 0 : size - 1,
+                     tls_seg_type, tls_seg_flags);
+
+    /* The segment cache is only updated when the selector is loaded */
+    __asm__ __volatile__("movw %w0,%%fs" :: "r" (KERNEL_TLS_SEGMENT)
+                         : "memory");
+}
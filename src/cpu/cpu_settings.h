@@ -16,6 +16,7 @@
 #define __CPU_SETTINGS_H_
 
 #include "../lib/stdint.h" /* Generic int types */
+#include "smp.h"           /* MAX_CPU_COUNT */
 
 /*******************************************************************************
  * CONSTANTS
@@ -24,7 +25,7 @@
 #define KERNEL_STACK_SIZE 16384 /* DO NOT FORGET TO MODIFY IN LOADER.S */
 
 /* GDT Settings */
-#define GDT_ENTRY_COUNT 10
+#define GDT_ENTRY_COUNT 12
 
 #define KERNEL_CS    0x08
 #define KERNEL_DS    0x10
@@ -58,6 +59,12 @@
 
 #define TSS_SEGMENT 0x48
 
+/* CPU local area (GS) and thread local storage (FS) segments, their base is
+ * set per CPU
+ */
+#define KERNEL_CPU_LOCAL_SEGMENT 0x50
+#define KERNEL_TLS_SEGMENT       0x58
+
 /* GDT Flags */
 #define GDT_FLAG_GRANULARITY_4K   0x800000
 #define GDT_FLAG_GRANULARITY_BYTE 0x000000
@@ -134,6 +141,13 @@ typedef struct cpu_tss_entry
    uint16_t iomap_base;
 } __attribute__((__packed__)) cpu_tss_entry_t;
 
+/* GDT / IDT pointer as expected by lgdt and lidt */
+typedef struct cpu_table_ptr
+{
+    uint16_t size;
+    uint32_t base;
+} __attribute__((__packed__)) cpu_table_ptr_t;
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
@@ -411,4 +425,32 @@ void setup_idt(void);
 /* Setup the main CPU TSS for the kernel. */
 void setup_tss(void);
 
+/* Setup the GDT of an application processor. The GDT is a copy of the main CPU
+ * GDT in which the TSS entry points to the application processor's own TSS.
+ * Load the new GDT and set the segment registers (CS, DS, ES, FS, GS, SS).
+ *
+ * @param cpu_id The id of the CPU to setup, must not be the main CPU.
+ */
+void setup_ap_gdt(const uint32_t cpu_id);
+
+/* Load the kernel IDT on an application processor. The IDT is shared by all
+ * the CPUs.
+ */
+void setup_ap_idt(void);
+
+/* Setup the TSS of an application processor.
+ *
+ * @param cpu_id The id of the CPU to setup, must not be the main CPU.
+ * @param kernel_stack_top The address of the top of the CPU's kernel stack.
+ */
+void setup_ap_tss(const uint32_t cpu_id, const uint32_t kernel_stack_top);
+
+/* Set the thread local storage segment of the current CPU and reload FS. The
+ * interrupts must be disabled.
+ *
+ * @param base The address of the thread local storage block.
+ * @param size The size of the thread local storage block in bytes.
+ */
+void cpu_set_tls(const uint32_t base, const uint32_t size);
+
 #endif /* __CPU_SETTINGS_H_ */
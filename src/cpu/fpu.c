@@ -0,0 +1,228 @@
+/*******************************************************************************
+ *
+ * File: fpu.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * X87 FPU / SSE management. The FPU state of the threads is switched lazily:
+ * the CR0.TS bit is set when a thread that does not own the FPU registers is
+ * scheduled, its state is only restored when it uses the FPU (#NM exception).
+ * The FPU must not be used in interrupt handlers.
+ ******************************************************************************/
+
+#include "../lib/stdint.h"         /* Generic int types */
+#include "../lib/stddef.h"         /* OS_RETURN_E */
+#include "../core/interrupts.h"    /* register_exception_handler */
+#include "../core/kernel_output.h" /* kernel_error */
+#include "../core/panic.h"         /* kernel_panic */
+#include "cpu.h"                   /* cpuid */
+#include "smp.h"                   /* get_cpu_id, MAX_CPU_COUNT */
+
+#include "../debug.h"              /* kernel_serial_debug */
+
+/* Header file */
+#include "fpu.h"
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************/
+
+/* Set when the CPUs support FXSAVE and SSE */
+static uint8_t fpu_available;
+
+/* Context which state is in the CPU FPU registers */
+static fpu_context_t* fpu_owner[MAX_CPU_COUNT];
+
+/* Context of the thread executed by the CPU */
+static fpu_context_t* fpu_current[MAX_CPU_COUNT];
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Read the CR0 register.
+ *
+ * @returns The CR0 register value.
+ */
+__inline__ static uint32_t get_cr0(void)
+{
+    uint32_t cr0;
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+/* Write the CR0 register.
+ *
+ * @param cr0 The value to write.
+ */
+__inline__ static void set_cr0(const uint32_t cr0)
+{
+    __asm__ __volatile__("mov %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+/* Enable the FPU and SSE on the current CPU. The FPU starts disabled
+ * (CR0.TS set) so the first thread using it gets a clean state.
+ */
+static void fpu_enable(void)
+{
+    uint32_t cr4;
+    uint32_t mxcsr = FPU_MXCSR_DEFAULT;
+
+    set_cr0((get_cr0() & ~CR0_EM) | CR0_MP | CR0_NE);
+
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    __asm__ __volatile__("mov %0, %%cr4" : : "r"(cr4) : "memory");
+
+    __asm__ __volatile__("clts\n\t"
+                         "fninit\n\t"
+                         "ldmxcsr %0" : : "m"(mxcsr) : "memory");
+
+    set_cr0(get_cr0() | CR0_TS);
+}
+
+/* Device not available (#NM) exception handler. Raised when a thread uses the
+ * FPU while CR0.TS is set, the thread FPU state is loaded in the CPU.
+ *
+ * @param cpu_state The cpu registers structure.
+ * @param int_id The interrupt number.
+ * @param stack_state The stack state before the interrupt that contain cs, eip,
+ * error code and the eflags register value.
+ */
+static void fpu_nm_handler(cpu_state_t* cpu_state, uint32_t int_id,
+                           stack_state_t* stack_state)
+{
+    uint32_t       cpu_id;
+    uint32_t       mxcsr = FPU_MXCSR_DEFAULT;
+    fpu_context_t* context;
+
+    (void)cpu_state;
+    (void)int_id;
+    (void)stack_state;
+
+    cpu_id  = get_cpu_id();
+    context = fpu_current[cpu_id];
+
+    if(context == NULL)
+    {
+        kernel_error("FPU used without context on CPU %d\n", cpu_id);
+        kernel_panic();
+    }
+
+    __asm__ __volatile__("clts");
+
+    /* The previous owner state was saved when it left the CPU */
+    if(fpu_owner[cpu_id] != context || context->cpu_id != (int32_t)cpu_id)
+    {
+        if(context->saved == 1)
+        {
+            __asm__ __volatile__("fxrstor %0"
+                                 : : "m"(context->fxsave_area) : "memory");
+        }
+        else
+        {
+            __asm__ __volatile__("fninit\n\t"
+                                 "ldmxcsr %0" : : "m"(mxcsr) : "memory");
+        }
+
+        fpu_owner[cpu_id] = context;
+        context->cpu_id   = cpu_id;
+    }
+
+    #ifdef DEBUG_FPU
+    kernel_serial_debug("CPU %d FPU context 0x%08x loaded\n",
+                        cpu_id, (uint32_t)context);
+    #endif
+}
+
+OS_RETURN_E init_fpu(void)
+{
+    uint32_t regs[4];
+    uint32_t i;
+
+    for(i = 0; i < MAX_CPU_COUNT; ++i)
+    {
+        fpu_owner[i]   = NULL;
+        fpu_current[i] = NULL;
+    }
+
+    if(cpuid(CPUID_GETFEATURES, regs) == 0 ||
+       (regs[3] & BIT_FXSAVE) == 0 || (regs[3] & BIT_SSE) == 0)
+    {
+        fpu_available = 0;
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    fpu_available = 1;
+
+    fpu_enable();
+
+    return register_exception_handler(FPU_NM_EXCEPTION_LINE, fpu_nm_handler);
+}
+
+OS_RETURN_E init_ap_fpu(void)
+{
+    if(fpu_available == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    fpu_enable();
+
+    return OS_NO_ERR;
+}
+
+void fpu_context_init(fpu_context_t* context)
+{
+    context->saved  = 0;
+    context->cpu_id = -1;
+}
+
+void fpu_switch(fpu_context_t* prev, fpu_context_t* next)
+{
+    uint32_t cpu_id;
+    uint32_t cr0;
+    uint32_t new_cr0;
+
+    if(fpu_available == 0)
+    {
+        return;
+    }
+
+    cpu_id = get_cpu_id();
+    cr0    = get_cr0();
+
+    /* The FPU is enabled only if the thread used it, save its state so it
+     * can be restored on any CPU.
+     */
+    if(prev != next && (cr0 & CR0_TS) == 0 && fpu_owner[cpu_id] == prev)
+    {
+        __asm__ __volatile__("fxsave %0" : "=m"(prev->fxsave_area) : :
+                             "memory");
+        prev->saved = 1;
+    }
+
+    fpu_current[cpu_id] = next;
+
+    /* Keep the FPU enabled if the registers still hold the next thread
+     * state.
+     */
+    if(fpu_owner[cpu_id] == next && next->cpu_id == (int32_t)cpu_id)
+    {
+        new_cr0 = cr0 & ~CR0_TS;
+    }
+    else
+    {
+        new_cr0 = cr0 | CR0_TS;
+    }
+
+    /* Writing CR0 serializes the CPU, avoid it when possible */
+    if(new_cr0 != cr0)
+    {
+        set_cr0(new_cr0);
+    }
+}
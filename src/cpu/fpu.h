@@ -0,0 +1,95 @@
+/*******************************************************************************
+ *
+ * File: fpu.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * X87 FPU / SSE management. The FPU state of the threads is switched lazily:
+ * the CR0.TS bit is set when a thread that does not own the FPU registers is
+ * scheduled, its state is only restored when it uses the FPU (#NM exception).
+ * The FPU must not be used in interrupt handlers.
+ ******************************************************************************/
+
+#ifndef __FPU_H_
+#define __FPU_H_
+
+#include "../lib/stdint.h" /* Generic int types */
+#include "../lib/stddef.h" /* OS_RETURN_E */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* CR0 and CR4 FPU settings bits */
+#define CR0_MP            0x00000002
+#define CR0_EM            0x00000004
+#define CR0_TS            0x00000008
+#define CR0_NE            0x00000020
+#define CR4_OSFXSR        0x00000200
+#define CR4_OSXMMEXCPT    0x00000400
+
+/* Device not available exception line */
+#define FPU_NM_EXCEPTION_LINE 7
+
+/* FXSAVE area size */
+#define FPU_FXSAVE_SIZE   512
+
+/* Default MXCSR value, all SIMD exceptions masked */
+#define FPU_MXCSR_DEFAULT 0x1F80
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Thread FPU context */
+typedef struct fpu_context
+{
+    /* FXSAVE area, must be 16 bytes aligned */
+    uint8_t          fxsave_area[FPU_FXSAVE_SIZE] __attribute__((aligned(16)));
+
+    /* Set once the thread state has been saved in the area */
+    uint8_t          saved;
+
+    /* CPU which FPU registers hold the latest thread state, -1 if none */
+    volatile int32_t cpu_id;
+} fpu_context_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Enable the FPU and SSE on the main CPU and register the #NM exception
+ * handler. The kernel interrupts must have been initialized.
+ *
+ * @return OS_NO_ERR on success, an error otherwise.
+ */
+OS_RETURN_E init_fpu(void);
+
+/* Enable the FPU and SSE on an application processor. The main CPU FPU must
+ * have been initialized (init_fpu).
+ *
+ * @return OS_NO_ERR on success, an error otherwise.
+ */
+OS_RETURN_E init_ap_fpu(void);
+
+/* Init a thread FPU context, the thread starts with a clean FPU state.
+ *
+ * @param context The context to initialize.
+ */
+void fpu_context_init(fpu_context_t* context);
+
+/* Switch the FPU context of the current CPU. The state of the previous thread
+ * is saved if it used the FPU since it was scheduled, the FPU is then
+ * disabled (CR0.TS) unless the CPU registers already hold the next thread
+ * state. Local interrupts must be disabled.
+ *
+ * @param prev The FPU context of the thread leaving the CPU.
+ * @param next The FPU context of the thread scheduled on the CPU.
+ */
+void fpu_switch(fpu_context_t* prev, fpu_context_t* next);
+
+#endif /* __FPU_H_ */
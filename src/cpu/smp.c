@@ -13,7 +13,18 @@
  ******************************************************************************/
 
 #include "../lib/stdint.h"         /* Generic int types */
+#include "../lib/stddef.h"         /* OS_RETURN_E */
+#include "../lib/string.h"         /* memcpy, memset */
+#include "../memory/heap.h"        /* kmalloc, kfree */
 #include "../drivers/acpi.h"       /* acpi data */
+#include "../drivers/lapic.h"      /* lapic_send_ipi_init, get_lapic_id */
+#include "../core/kernel_output.h" /* kernel_error */
+#include "../core/panic.h"         /* kernel_panic */
+#include "../core/scheduler.h"     /* init_ap_scheduler */
+#include "cpu_settings.h"          /* setup_ap_gdt, KERNEL_STACK_SIZE */
+#include "cpu_local.h"             /* CPU_LOCAL_READ */
+
+#include "../debug.h"              /* kernel_serial_debug */
 
 /* Header file */
 #include "smp.h"
@@ -22,12 +33,150 @@
  * GLOBAL VARIABLES
  ******************************************************************************/
 
+/* AP trampoline, see ap_trampoline.S */
+extern uint8_t  ap_trampoline_start;
+extern uint8_t  ap_trampoline_end;
+extern uint32_t ap_boot_cr3;
+extern uint32_t ap_boot_stack;
+
+/* Address of a trampoline variable once the code is relocated */
+#define AP_TRAMPOLINE_VAR(var)                                      \
+    ((volatile uint32_t*)(AP_TRAMPOLINE_ADDR +                      \
+                          ((uint32_t)&(var) -                       \
+                           (uint32_t)&ap_trampoline_start)))
+
 static int8_t cpu_count = -1;
 
+/* Started CPUs management */
+static volatile uint32_t booted_cpu_count = 1;
+static volatile uint8_t  ap_booted;
+static volatile uint8_t  smp_initialized = 0;
+
+/* LAPIC id to CPU id translation table and its reverse */
+static uint8_t lapic_cpu_id[256];
+static uint8_t cpu_lapic_id[MAX_CPU_COUNT];
+
+/* Top of the boot stack of each CPU */
+static uint32_t cpu_stack_top[MAX_CPU_COUNT];
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
 
+/* Send the INIT - STARTUP - STARTUP IPI sequence to the application processor
+ * given as parameter and wait for the AP to signal it started.
+ *
+ * @param lapic_id The Local APIC id of the AP to start.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E boot_ap(const uint32_t lapic_id)
+{
+    OS_RETURN_E err;
+    uint32_t    i;
+
+    err = lapic_send_ipi_init(lapic_id);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    err = lapic_wait(10);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    /* A started AP ignores the second STARTUP IPI */
+    for(i = 0; i < 2; ++i)
+    {
+        err = lapic_send_ipi_startup(lapic_id, AP_TRAMPOLINE_ADDR >> 12);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+
+        err = lapic_wait(1);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+    }
+
+    for(i = 0; i < AP_STARTUP_TIMEOUT && ap_booted == 0; ++i)
+    {
+        err = lapic_wait(1);
+        if(err != OS_NO_ERR)
+        {
+            return err;
+        }
+    }
+
+    if(ap_booted == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    return OS_NO_ERR;
+}
+
+/* Start the application processor given as parameter. On failure the AP is
+ * parked with an INIT IPI, it then waits for a STARTUP IPI and never executes
+ * as the CPU id given as parameter, which can be given to the next AP.
+ *
+ * @param lapic_id The Local APIC id of the AP to start.
+ * @param cpu_id The CPU id given to the AP.
+ * @param parked Set to 0 if the AP failed and could not be parked, the AP may
+ * still execute as the CPU id and use its boot stack.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+static OS_RETURN_E start_ap(const uint32_t lapic_id, const uint32_t cpu_id,
+                            uint8_t* parked)
+{
+    OS_RETURN_E err;
+    uint8_t*    stack;
+
+    *parked = 1;
+
+    /* Each AP has its own boot stack */
+    stack = kmalloc(KERNEL_STACK_SIZE);
+    if(stack == NULL)
+    {
+        return OS_ERR_MALLOC;
+    }
+
+    cpu_stack_top[cpu_id] = (uint32_t)stack + KERNEL_STACK_SIZE;
+    lapic_cpu_id[lapic_id] = cpu_id;
+    cpu_lapic_id[cpu_id]   = lapic_id;
+
+    *AP_TRAMPOLINE_VAR(ap_boot_stack) = cpu_stack_top[cpu_id];
+    ap_booted = 0;
+
+    err = boot_ap(lapic_id);
+    if(err != OS_NO_ERR)
+    {
+        /* A late AP must not execute as the CPU id nor on the stack */
+        if(lapic_send_ipi_init(lapic_id) != OS_NO_ERR ||
+           lapic_wait(10) != OS_NO_ERR)
+        {
+            *parked = 0;
+            return err;
+        }
+
+        lapic_cpu_id[lapic_id] = 0;
+        cpu_lapic_id[cpu_id]   = 0;
+        cpu_stack_top[cpu_id]  = 0;
+        kfree(stack);
+
+        return err;
+    }
+
+    #ifdef DEBUG_SMP
+    kernel_serial_debug("CPU %d (LAPIC %d) started\n", cpu_id, lapic_id);
+    #endif
+
+    return OS_NO_ERR;
+}
+
 int8_t get_cpu_count(void)
 {
     /* Detect the number of CPU thanks to the ACPI tables */
@@ -38,3 +187,147 @@ int8_t get_cpu_count(void)
 
     return cpu_count;
 }
+
+OS_RETURN_E init_smp(void)
+{
+    OS_RETURN_E err;
+    int8_t      detected_cpu;
+    int32_t     lapic_id;
+    uint32_t    main_lapic_id;
+    uint32_t    cpu_id;
+    uint32_t    cr3;
+    int32_t     i;
+    uint8_t     parked;
+
+    if(acpi_get_lapic_available() != 1)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    detected_cpu = get_cpu_count();
+    if(detected_cpu <= 1)
+    {
+        return OS_NO_ERR;
+    }
+
+    /* The main CPU is always CPU 0 */
+    memset(lapic_cpu_id, 0, sizeof(lapic_cpu_id));
+    main_lapic_id = get_lapic_id();
+    lapic_cpu_id[main_lapic_id & 0xFF] = 0;
+    cpu_lapic_id[0]                    = main_lapic_id & 0xFF;
+
+    /* Relocate the trampoline, APs use the kernel page directory */
+    memcpy((void*)AP_TRAMPOLINE_ADDR, &ap_trampoline_start,
+           (uint32_t)&ap_trampoline_end - (uint32_t)&ap_trampoline_start);
+
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(cr3));
+    *AP_TRAMPOLINE_VAR(ap_boot_cr3) = cr3;
+
+    smp_initialized = 1;
+
+    /* Start the APs one by one, they share the trampoline */
+    cpu_id = 1;
+    for(i = 0; i < detected_cpu && cpu_id < MAX_CPU_COUNT; ++i)
+    {
+        lapic_id = acpi_get_cpu_lapic_id(i);
+        if(lapic_id < 0 || (uint32_t)lapic_id == main_lapic_id)
+        {
+            continue;
+        }
+
+        err = start_ap(lapic_id, cpu_id, &parked);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not start CPU (LAPIC %d) [%d]\n",
+                         lapic_id, err);
+
+            /* The CPU ids must stay contiguous, the id of an AP which may
+             * still start cannot be given to an other AP.
+             */
+            if(parked == 0)
+            {
+                break;
+            }
+            continue;
+        }
+
+        ++cpu_id;
+        ++booted_cpu_count;
+    }
+
+    return OS_NO_ERR;
+}
+
+uint32_t get_cpu_id(void)
+{
+    if(smp_initialized == 0)
+    {
+        return 0;
+    }
+
+    /* The GS segment of each CPU points to its local area */
+    return CPU_LOCAL_READ(cpu_id);
+}
+
+int32_t get_cpu_lapic_id(const uint32_t cpu_id)
+{
+    if(cpu_id >= booted_cpu_count)
+    {
+        return -1;
+    }
+
+    if(smp_initialized == 0)
+    {
+        return get_lapic_id();
+    }
+
+    return cpu_lapic_id[cpu_id];
+}
+
+uint32_t get_booted_cpu_count(void)
+{
+    return booted_cpu_count;
+}
+
+void ap_kickstart(void)
+{
+    OS_RETURN_E err;
+    uint32_t    cpu_id;
+
+    /* The CPU local area is not reachable before the GDT is set */
+    cpu_id = lapic_cpu_id[get_lapic_id() & 0xFF];
+
+    /* Setup the CPU structures */
+    setup_ap_gdt(cpu_id);
+    setup_ap_idt();
+    setup_ap_tss(cpu_id, cpu_stack_top[cpu_id]);
+
+    /* The FPU is not available if the main CPU could not enable it */
+    init_ap_fpu();
+
+    err = init_ap_lapic();
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("CPU %d Local APIC Initialization error [%d]\n",
+                     cpu_id, err);
+        kernel_panic();
+    }
+
+    /* Timer interrupts stay pending until the AP scheduler enables them */
+    err = init_ap_lapic_timer();
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("CPU %d Local APIC TIMER Initialization error [%d]\n",
+                     cpu_id, err);
+        kernel_panic();
+    }
+
+    /* Tell the main CPU we started */
+    ap_booted = 1;
+
+    /* Wait for the scheduler and start scheduling threads */
+    err = init_ap_scheduler();
+
+    kernel_error("CPU %d scheduler returned [%d]\n", cpu_id, err);
+    kernel_panic();
+}
@@ -16,6 +16,7 @@
 #define __SMP_H_
 
 #include "../lib/stdint.h" /* Generic int types */
+#include "../lib/stddef.h" /* OS_RETURN_E */
 
 /*******************************************************************************
  * CONSTANTS
@@ -23,6 +24,14 @@
 
 #define MAX_CPU_COUNT 32
 
+/* Application processors startup code location, must be 4KB aligned and under
+ * 1MB. The STARTUP IPI vector is the page number of the code.
+ */
+#define AP_TRAMPOLINE_ADDR 0x8000
+
+/* Time given to an application processor to start (in ms) */
+#define AP_STARTUP_TIMEOUT 100
+
 /*******************************************************************************
  * STRUCTURES
  ******************************************************************************/
@@ -38,4 +47,38 @@
  */
 int8_t get_cpu_count(void);
 
+/* Start the application processors detected on the system. Each AP gets its
+ * own GDT, TSS and stack and waits for the scheduler to be initialized before
+ * scheduling threads. The LAPIC and LAPIC timer of the main CPU must have been
+ * initialized before calling this function.
+ *
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E init_smp(void);
+
+/* Returns the id of the CPU executing the function. The main CPU id is always
+ * 0, the application processors ids are given in their startup order.
+ *
+ * @returns The id of the current CPU.
+ */
+uint32_t get_cpu_id(void);
+
+/* Returns the Local APIC id of the CPU given as parameter.
+ *
+ * @param cpu_id The id of the CPU to get the Local APIC id of.
+ * @returns The Local APIC id of the CPU, -1 if the CPU is not running.
+ */
+int32_t get_cpu_lapic_id(const uint32_t cpu_id);
+
+/* Returns the number of CPU running in the system, the main CPU included.
+ *
+ * @returns The number of CPU running in the system.
+ */
+uint32_t get_booted_cpu_count(void);
+
+/* Application processors C entry point, called by the AP trampoline.
+ * !!!! IT SHOULD NEVER RETURN !!!!
+ */
+void ap_kickstart(void);
+
 #endif /* __SMP_H_ */
@@ -36,6 +36,14 @@
 //#define DEBUG_MUTEX
 //#define DEBUG_SEM
 //#define DEBUG_MEM
+//#define DEBUG_SMP
+//#define DEBUG_SLAB
+//#define DEBUG_STACK
+//#define DEBUG_FPU
+//#define DEBUG_TSC
+//#define DEBUG_WORKQUEUE
+//#define DEBUG_THREAD_POOL
+//#define DEBUG_FUTEX
 
 #endif /* DEBUG */
 
@@ -916,3 +916,19 @@ int32_t acpi_get_detected_cpu_count(void)
 
     return cpu_count;
 }
+
+int32_t acpi_get_cpu_lapic_id(const uint32_t cpu_index)
+{
+    if(acpi_init != 1 || cpu_index >= cpu_count)
+    {
+        return -1;
+    }
+
+    /* Disabled CPU are not usable */
+    if((cpu_lapic[cpu_index]->flags & 0x1) == 0)
+    {
+        return -1;
+    }
+
+    return cpu_lapic[cpu_index]->apic_id;
+}
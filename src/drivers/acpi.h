@@ -345,4 +345,14 @@ OS_RETURN_E acpi_check_lapic_id(const uint32_t lapic_id);
  */
 int32_t acpi_get_detected_cpu_count(void);
 
+/* Returns the Local APIC id of the CPU designed by the index given as
+ * parameter. The index is the order in which the CPU was detected in the ACPI
+ * tables.
+ *
+ * @param cpu_index The index of the CPU to get the Local APIC id of.
+ * @returns The Local APIC id of the CPU, -1 if the CPU does not exist or is
+ * disabled.
+ */
+int32_t acpi_get_cpu_lapic_id(const uint32_t cpu_index);
+
 #endif /* __ACPI_H_ */
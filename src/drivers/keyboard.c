@@ -22,6 +22,8 @@
 #include "../lib/stdio.h"          /* printf */
 #include "../sync/semaphore.h"     /* semaphore_t */
 #include "../sync/mutex.h"          /* mutex_t */
+#include "../sync/lock.h"           /* spinlock */
+#include "../core/workqueue.h"      /* queue_work */
 
 /* Header file */
 #include "keyboard.h"
@@ -41,6 +43,15 @@ static volatile uint32_t keyboard_flags;
 static kbd_buffer_t kbd_buf;
 static mutex_t      kbd_mutex;
 
+/* Key codes read by the interrupt handler, managed by a worker thread */
+static int8_t   keycodes[KBD_KEYCODE_BUFFER_SIZE];
+static uint32_t keycodes_head;
+static uint32_t keycodes_count;
+static lock_t   keycodes_lock;
+
+static void   keyboard_manage_keycodes(void* args);
+static work_t keycodes_work = WORK_INIT(keyboard_manage_keycodes, NULL);
+
 /* Keyboard map */
 static const key_mapper_t qwerty_map =
 {
@@ -352,6 +363,31 @@ static void manage_keycode(const int8_t keycode)
     }
 }
 
+/* Manage the key codes buffered by the interrupt handler.
+ *
+ * @param args Unused.
+ */
+static void keyboard_manage_keycodes(void* args)
+{
+    int8_t keycode;
+
+    (void)args;
+
+    spinlock_lock(&keycodes_lock);
+    while(keycodes_count > 0)
+    {
+        keycode       = keycodes[keycodes_head];
+        keycodes_head = (keycodes_head + 1) % KBD_KEYCODE_BUFFER_SIZE;
+        --keycodes_count;
+        spinlock_unlock(&keycodes_lock);
+
+        manage_keycode(keycode);
+
+        spinlock_lock(&keycodes_lock);
+    }
+    spinlock_unlock(&keycodes_lock);
+}
+
 /* Keyboard IRQ handler, read the key value and manage thread blocked on IO.
  *
  * @param cpu_state The cpu registers before the interrupt.
@@ -373,8 +409,23 @@ static void keyboard_interrupt_handler(cpu_state_t* cpu_state, uint32_t int_id,
         /* Retrieve key code and test it */
         keycode = inb(KEYBOARD_DATA_PORT);
 
-        /* Manage keycode */
-        manage_keycode(keycode);
+        /* Buffer the key code, it is dropped if the buffer is full */
+        spinlock_lock(&keycodes_lock);
+        if(keycodes_count < KBD_KEYCODE_BUFFER_SIZE)
+        {
+            keycodes[(keycodes_head + keycodes_count) %
+                     KBD_KEYCODE_BUFFER_SIZE] = keycode;
+            ++keycodes_count;
+        }
+        spinlock_unlock(&keycodes_lock);
+
+        /* Manage keycode in a worker thread, or here before the worker
+         * threads are created
+         */
+        if(queue_work(&keycodes_work) != OS_NO_ERR)
+        {
+            keyboard_manage_keycodes(NULL);
+        }
     }
 
     set_IRQ_EOI(KBD_IRQ_LINE);
@@ -396,6 +447,10 @@ OS_RETURN_E init_keyboard(void)
 
     memset(&kbd_buf, 0, sizeof(kbd_buffer_t));
 
+    keycodes_head  = 0;
+    keycodes_count = 0;
+    spinlock_init(&keycodes_lock);
+
     /* Init interuption settings */
     err = register_interrupt_handler(KBD_INTERRUPT_LINE,
                                      keyboard_interrupt_handler);
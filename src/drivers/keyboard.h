@@ -31,6 +31,9 @@
 
 #define KEYBOARD_BUFFER_SIZE 512
 
+/* Number of key codes buffered before the worker thread manages them */
+#define KBD_KEYCODE_BUFFER_SIZE 64
+
 /* Flags */
 #define KBD_LSHIFT 0x00000001
 #define KBD_RSHIFT 0x00000002
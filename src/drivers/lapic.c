@@ -18,6 +18,7 @@
 #include "../core/interrupts.h"  /* SPURIOUS_INTERRUPT_LINE,
                                     register_interrupt_line */
 #include "../cpu/cpu.h"          /* mapped_io_read_32, mapped_io_write_32 */
+#include "../cpu/smp.h"          /* MAX_CPU_COUNT, get_cpu_id */
 #include "acpi.h"                /* get_lapic_addr */
 #include "pit.h"                 /* set_pit_freq, emable_pit, diable_pit */
 
@@ -39,6 +40,12 @@ static volatile uint32_t lapic_timer_frequency;
 static volatile uint32_t tick_count;
 static volatile uint32_t uptime;
 
+/* One-shot timer count of each CPU, 0 when the timer is periodic */
+static volatile uint32_t oneshot_count[MAX_CPU_COUNT];
+
+/* Timer counts elapsed on the main CPU not yet accounted in the uptime */
+static uint32_t uptime_remainder;
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
@@ -214,10 +221,267 @@ OS_RETURN_E init_lapic_timer(void)
 
     tick_count = 0;
     uptime = 0;
+    uptime_remainder = 0;
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E init_ap_lapic(void)
+{
+    if(lapic_base_addr == NULL)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    /* Enable all interrupts */
+    lapic_write(LAPIC_TPR, 0);
+
+    /* Set logical destination mode */
+    lapic_write(LAPIC_DFR, 0xffffffff);
+    lapic_write(LAPIC_LDR, 0x01000000);
+
+    /* Spurious Interrupt Vector Register */
+    lapic_write(LAPIC_SVR, 0x100 | SPURIOUS_INT_LINE);
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E init_ap_lapic_timer(void)
+{
+    if(lapic_timer_frequency == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    /* Init interrupt */
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_INTERRUPT_LINE |
+                LAPIC_TIMER_MODE_PERIODIC);
+
+    /* Set timer count, all the LAPIC timers share the same frequency */
+    lapic_write(LAPIC_TDCR, LAPIC_DIVIDER_16);
+    lapic_write(LAPIC_TICR,
+                lapic_timer_frequency / LAPIC_TIMER_SCHED_FREQUENCY);
 
     return OS_NO_ERR;
 }
 
+OS_RETURN_E lapic_wait(const uint32_t time_ms)
+{
+    uint32_t period;
+    uint32_t to_wait;
+    uint32_t elapsed;
+    uint32_t last_count;
+    uint32_t current_count;
+
+    period = lapic_read(LAPIC_TICR);
+    if(period == 0 || lapic_timer_frequency == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    to_wait    = (lapic_timer_frequency / 1000) * time_ms;
+    elapsed    = 0;
+    last_count = lapic_read(LAPIC_TCCR);
+
+    /* The timer is periodic, the count is reloaded when it reaches 0 */
+    while(elapsed < to_wait)
+    {
+        current_count = lapic_read(LAPIC_TCCR);
+        if(current_count <= last_count)
+        {
+            elapsed += last_count - current_count;
+        }
+        else
+        {
+            elapsed += last_count + (period - current_count);
+        }
+        last_count = current_count;
+    }
+
+    return OS_NO_ERR;
+}
+
+/* Convert a time in nanoseconds to a LAPIC timer count.
+ *
+ * @param time_ns The time to convert, at most LAPIC_TIMER_MAX_NS.
+ * @returns The timer count, at least 1.
+ */
+static uint32_t lapic_timer_ns_to_count(uint32_t time_ns)
+{
+    uint32_t count;
+
+    if(time_ns > LAPIC_TIMER_MAX_NS)
+    {
+        time_ns = LAPIC_TIMER_MAX_NS;
+    }
+
+    count = cpu_udiv_64_32((uint64_t)time_ns * (lapic_timer_frequency / 1000),
+                           1000000);
+
+    return (count == 0) ? 1 : count;
+}
+
+/* Set the current CPU LAPIC timer in one-shot mode for the count given as
+ * parameter. On the main CPU, the part of the current period or one-shot
+ * already elapsed is kept to be accounted in the uptime.
+ *
+ * @param cpu_id The current CPU id.
+ * @param count The timer count before the interrupt.
+ */
+static void lapic_timer_start_oneshot(const uint32_t cpu_id,
+                                      const uint32_t count)
+{
+    uint32_t period;
+
+    period = lapic_timer_frequency / LAPIC_TIMER_SCHED_FREQUENCY;
+
+    if(cpu_id == 0)
+    {
+        if(oneshot_count[cpu_id] == 0)
+        {
+            uptime_remainder += period - lapic_read(LAPIC_TCCR);
+        }
+        else
+        {
+            uptime_remainder += oneshot_count[cpu_id] -
+                                lapic_read(LAPIC_TCCR);
+        }
+    }
+
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_INTERRUPT_LINE |
+                LAPIC_TIMER_MODE_ONESHOT);
+    lapic_write(LAPIC_TICR, count);
+
+    oneshot_count[cpu_id] = count;
+}
+
+OS_RETURN_E lapic_timer_set_oneshot(const uint32_t time_ms)
+{
+    uint32_t cpu_id;
+    uint32_t period;
+    uint32_t count_ms;
+    uint32_t count;
+
+    if(lapic_timer_frequency == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    cpu_id   = get_cpu_id();
+    period   = lapic_timer_frequency / LAPIC_TIMER_SCHED_FREQUENCY;
+    count_ms = lapic_timer_frequency / 1000;
+
+    /* Never wait less than a tick, avoid counter overflow */
+    if(time_ms < 1000 / LAPIC_TIMER_SCHED_FREQUENCY)
+    {
+        count = period;
+    }
+    else if(time_ms > 0xFFFFFFFF / count_ms)
+    {
+        count = 0xFFFFFFFF;
+    }
+    else
+    {
+        count = time_ms * count_ms;
+    }
+
+    lapic_timer_start_oneshot(cpu_id, count);
+
+    #ifdef DEBUG_LAPIC
+    kernel_serial_debug("CPU %d LAPIC one-shot %dms\n", cpu_id, time_ms);
+    #endif
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E lapic_timer_set_oneshot_ns(const uint32_t time_ns)
+{
+    uint32_t cpu_id;
+
+    if(lapic_timer_frequency == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    cpu_id = get_cpu_id();
+
+    lapic_timer_start_oneshot(cpu_id, lapic_timer_ns_to_count(time_ns));
+
+    #ifdef DEBUG_LAPIC
+    kernel_serial_debug("CPU %d LAPIC one-shot %dns\n", cpu_id, time_ns);
+    #endif
+
+    return OS_NO_ERR;
+}
+
+uint8_t lapic_timer_set_deadline(const uint32_t time_ns)
+{
+    uint32_t cpu_id;
+    uint32_t count;
+
+    if(lapic_timer_frequency == 0)
+    {
+        return 0;
+    }
+
+    cpu_id = get_cpu_id();
+    count  = lapic_timer_ns_to_count(time_ns);
+
+    /* The next interrupt already comes first */
+    if(count >= lapic_read(LAPIC_TCCR))
+    {
+        return 0;
+    }
+
+    lapic_timer_start_oneshot(cpu_id, count);
+
+    #ifdef DEBUG_LAPIC
+    kernel_serial_debug("CPU %d LAPIC deadline %dns\n", cpu_id, time_ns);
+    #endif
+
+    return 1;
+}
+
+uint8_t lapic_timer_set_periodic(void)
+{
+    uint32_t cpu_id;
+    uint32_t period;
+    uint32_t elapsed;
+    uint32_t ticks;
+
+    cpu_id = get_cpu_id();
+    if(oneshot_count[cpu_id] == 0)
+    {
+        return 0;
+    }
+
+    period  = lapic_timer_frequency / LAPIC_TIMER_SCHED_FREQUENCY;
+    elapsed = oneshot_count[cpu_id] - lapic_read(LAPIC_TCCR);
+
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_INTERRUPT_LINE |
+                LAPIC_TIMER_MODE_PERIODIC);
+    lapic_write(LAPIC_TICR, period);
+
+    oneshot_count[cpu_id] = 0;
+
+    /* Account the time spent without ticks in the uptime */
+    if(cpu_id == 0)
+    {
+        uptime_remainder += elapsed;
+        ticks             = uptime_remainder / period;
+        uptime_remainder -= ticks * period;
+
+        tick_count += ticks;
+        uptime     += ticks * (1000 / LAPIC_TIMER_SCHED_FREQUENCY);
+    }
+
+    #ifdef DEBUG_LAPIC
+    kernel_serial_debug("CPU %d LAPIC periodic\n", cpu_id);
+    #endif
+
+    return 1;
+}
+
 uint32_t get_lapic_id(void)
 {
     return (lapic_read(LAPIC_ID) >> 24);
@@ -270,6 +534,34 @@ OS_RETURN_E lapic_send_ipi_startup(const uint32_t lapic_id,
     return err;
 }
 
+OS_RETURN_E lapic_send_ipi(const uint32_t lapic_id, const uint32_t vector)
+{
+    OS_RETURN_E err;
+
+    if(vector < MIN_INTERRUPT_LINE || vector > MAX_INTERRUPT_LINE)
+    {
+        return OS_ERR_NO_SUCH_IRQ_LINE;
+    }
+
+    /* Check LACPI id */
+    err = acpi_check_lapic_id(lapic_id);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    /* Send IPI */
+    lapic_write(LAPIC_ICRHI, lapic_id << ICR_DESTINATION_SHIFT);
+    lapic_write(LAPIC_ICRLO, vector | ICR_FIXED | ICR_PHYSICAL |
+                ICR_ASSERT | ICR_EDGE | ICR_NO_SHORTHAND);
+
+    /* Wait for pending sends */
+    while ((lapic_read(LAPIC_ICRLO) & ICR_SEND_PENDING) != 0)
+    {}
+
+    return err;
+}
+
 OS_RETURN_E set_INT_LAPIC_EOI(const uint32_t interrupt_line)
 {
     if(interrupt_line > SPURIOUS_INT_LINE)
@@ -80,9 +80,13 @@
 /* Destination Field */
 #define ICR_DESTINATION_SHIFT           24
 
+#define LAPIC_TIMER_MODE_ONESHOT        0x00000
 #define LAPIC_TIMER_MODE_PERIODIC       0x20000
 #define LAPIC_DIVIDER_16                0x3
 #define LAPIC_TIMER_SCHED_FREQUENCY     500
+
+/* Longest one-shot programmed in nanoseconds */
+#define LAPIC_TIMER_MAX_NS              1000000000
 #define APIC_LVT_INT_MASKED             0x10000
 
 /*******************************************************************************
@@ -105,6 +109,67 @@ OS_RETURN_E init_lapic(void);
  */
 OS_RETURN_E init_lapic_timer(void);
 
+/* Init the Local APIC of an application processor. The Local APIC registers
+ * must have been mapped by the main CPU (init_lapic).
+ *
+ * @return OS_NO_ERR on succes, an error otherwise.
+ */
+OS_RETURN_E init_ap_lapic(void);
+
+/* Init the Local APIC TIMER of an application processor. The timer uses the
+ * frequency computed by the main CPU (init_lapic_timer).
+ *
+ * @return OS_NO_ERR on succes, an error otherwise.
+ */
+OS_RETURN_E init_ap_lapic_timer(void);
+
+/* Busy wait using the current CPU Local APIC TIMER. The timer must be
+ * initialized and running. This is used when interrupts cannot be used
+ * (early SMP init for instance).
+ *
+ * @param time_ms The number of milliseconds to wait.
+ * @return OS_NO_ERR on succes, an error otherwise.
+ */
+OS_RETURN_E lapic_wait(const uint32_t time_ms);
+
+/* Set the current CPU Local APIC TIMER in one-shot mode. The timer interrupt
+ * is raised once after the time given as parameter, the scheduler ticks are
+ * stopped until lapic_timer_set_periodic is called. The time is at least one
+ * scheduler tick. Local interrupts must be disabled.
+ *
+ * @param time_ms The time before the timer interrupt in milliseconds.
+ * @return OS_NO_ERR on succes, an error otherwise.
+ */
+OS_RETURN_E lapic_timer_set_oneshot(const uint32_t time_ms);
+
+/* Set the current CPU Local APIC TIMER in one-shot mode, the timer interrupt
+ * is raised once after the time given as parameter. Same as
+ * lapic_timer_set_oneshot with a nanosecond resolution and no minimal time.
+ * Local interrupts must be disabled.
+ *
+ * @param time_ns The time before the timer interrupt in nanoseconds, at most
+ * LAPIC_TIMER_MAX_NS.
+ * @return OS_NO_ERR on succes, an error otherwise.
+ */
+OS_RETURN_E lapic_timer_set_oneshot_ns(const uint32_t time_ns);
+
+/* Program a timer interrupt after the time given as parameter if it comes
+ * before the next timer interrupt. The timer is then in one-shot mode until
+ * lapic_timer_set_periodic is called. Local interrupts must be disabled.
+ *
+ * @param time_ns The time before the deadline in nanoseconds.
+ * @return 1 if the timer was set in one-shot mode, 0 otherwise.
+ */
+uint8_t lapic_timer_set_deadline(const uint32_t time_ns);
+
+/* Set the current CPU Local APIC TIMER back in periodic mode. On the main CPU,
+ * the time elapsed in one-shot mode is accounted in the uptime and tick count.
+ * Local interrupts must be disabled.
+ *
+ * @return 1 if the timer was in one-shot mode, 0 otherwise.
+ */
+uint8_t lapic_timer_set_periodic(void);
+
 /* Returns the current CPU Local APIC ID.
  *
  * @returns The current CPU Local APIC ID.
@@ -129,6 +194,15 @@ OS_RETURN_E lapic_send_ipi_init(const uint32_t lapic_id);
 OS_RETURN_E lapic_send_ipi_startup(const uint32_t lapic_id,
                                    const uint32_t vector);
 
+/* Send a fixed IPI to the CPU designed by the Local APIC ID given as
+ * parameter. The ID is checked before sending the IPI.
+ *
+ * @param lapic_id The Local APIC ID of the CPU to send the IPI to.
+ * @param vector The interrupt line raised on the destination CPU.
+ * @return OS_NO_ERR on success, an error otherwise.
+ */
+OS_RETURN_E lapic_send_ipi(const uint32_t lapic_id, const uint32_t vector);
+
 /* Set END OF INTERRUPT for the current CPU Local APIC.
  *
  * @param interrupt_line The intrrupt line for which the EOI should be set.
@@ -18,6 +18,7 @@
 #include "../lib/stddef.h"         /* OS_RETURN_E, OS_EVENT_ID */
 #include "../lib/string.h"         /* memcpy */
 #include "../sync/lock.h"          /* enable_local_interrupt, disable_local_interrupt */
+#include "../core/workqueue.h"     /* queue_work */
 
 /* Header include */
 #include "mouse.h"
@@ -39,6 +40,10 @@ static lock_t mouse_events_lock;
 /* Events table */
 static mouse_event_t mouse_events[MOUSE_MAX_EVENT_COUNT];
 
+/* Events execution, deferred by the interrupt handler */
+static void   mouse_execute_events(void* args);
+static work_t mouse_events_work = WORK_INIT(mouse_execute_events, NULL);
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
@@ -99,6 +104,25 @@ __inline__ static uint8_t mouse_read(void)
     return t;
 }
 
+/* Execute the mouse events.
+ *
+ * @param args Unused.
+ */
+static void mouse_execute_events(void* args)
+{
+    uint32_t i;
+
+    (void)args;
+
+    for(i = 0; i < MOUSE_MAX_EVENT_COUNT; ++i)
+    {
+        if(mouse_events[i].enabled  == 1)
+        {
+            mouse_events[i].execute();
+        }
+    }
+}
+
 /* Mouse IRQ handler, read the mouse state and update the system mouse state.
  *
  * @param cpu_state The cpu registers before the interrupt.
@@ -113,7 +137,6 @@ static void mouse_interrupt_handler(cpu_state_t* cpu_state, uint32_t int_id,
 
     int8_t   mouse_in;
     uint8_t  status;
-    uint32_t i;
 
     if(int_id == MOUSE_INTERRUPT_LINE)
     {
@@ -192,13 +215,12 @@ static void mouse_interrupt_handler(cpu_state_t* cpu_state, uint32_t int_id,
         status = inb(MOUSE_COMM_PORT);
     }
 
-    /* Execute events */
-    for(i = 0; i < MOUSE_MAX_EVENT_COUNT; ++i)
+    /* Execute events in a worker thread, or here before the worker threads
+     * are created
+     */
+    if(queue_work(&mouse_events_work) != OS_NO_ERR)
     {
-        if(mouse_events[i].enabled  == 1)
-        {
-            mouse_events[i].execute();
-        }
+        mouse_execute_events(NULL);
     }
 }
 
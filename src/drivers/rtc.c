@@ -17,6 +17,7 @@
 #include "../lib/stdint.h"         /* Generic int types */
 #include "../lib/stddef.h"         /* OS_RETURN_E, OS_EVENT_ID */
 #include "../sync/lock.h"          /* spinlock */
+#include "../core/workqueue.h"     /* queue_work */
 
 #include "../debug.h"      /* kernel_serial_debug */
 
@@ -40,6 +41,13 @@ static lock_t      clock_events_lock;
 /* Tick count */
 static volatile uint32_t tick_count;
 
+/* Last tick which events were executed */
+static uint32_t events_tick;
+
+/* Events execution, deferred by the interrupt handler */
+static void   rtc_execute_events(void* args);
+static work_t events_work = WORK_INIT(rtc_execute_events, NULL);
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
@@ -137,11 +145,37 @@ static void update_time(void)
     inb(CMOS_DATA_PORT);
 }
 
+/* Execute the events of the ticks elapsed since the last execution.
+ *
+ * @param args Unused.
+ */
+static void rtc_execute_events(void* args)
+{
+    uint32_t tick;
+    uint32_t i;
+
+    (void)args;
+
+    while(events_tick != tick_count)
+    {
+        tick = ++events_tick;
+
+        for(i = 0; i < RTC_MAX_EVENT_COUNT; ++i)
+        {
+            /* Check update frequency */
+            if(clock_events[i].enabled  == 1 &&
+               clock_events[i].execute != NULL &&
+               tick % clock_events[i].period == 0)
+            {
+                clock_events[i].execute();
+            }
+        }
+    }
+}
+
 static void rtc_interrupt_handler(cpu_state_t *cpu_state, uint32_t int_id,
                                   stack_state_t *stack_state)
 {
-    uint32_t    i;
-
     (void)cpu_state;
     (void)stack_state;
     (void)int_id;
@@ -150,16 +184,12 @@ static void rtc_interrupt_handler(cpu_state_t *cpu_state, uint32_t int_id,
 
     update_time();
 
-    /* Execute events */
-    for(i = 0; i < RTC_MAX_EVENT_COUNT; ++i)
+    /* Execute events in a worker thread, or here before the worker threads
+     * are created
+     */
+    if(queue_work(&events_work) != OS_NO_ERR)
     {
-        /* Check update frequency */
-        if(clock_events[i].enabled  == 1 &&
-           clock_events[i].execute != NULL &&
-           tick_count % clock_events[i].period == 0)
-        {
-            clock_events[i].execute();
-        }
+        rtc_execute_events(NULL);
     }
 
     /* Send EOI signal */
@@ -195,7 +225,8 @@ OS_RETURN_E init_rtc(void)
     outb((CMOS_NMI_DISABLE_BIT << 7) | CMOS_REG_A, CMOS_COMM_PORT);
     outb((prev_rate & 0xF0) | RTC_RATE, CMOS_DATA_PORT);
 
-    tick_count = 0;
+    tick_count  = 0;
+    events_tick = 0;
 
     for(i = 0; i < RTC_MAX_EVENT_COUNT; ++i)
     {
@@ -0,0 +1,216 @@
+/*******************************************************************************
+ *
+ * File: tsc.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * TSC (Time stamp counter) clocksource. The TSC frequency is calibrated
+ * against the PIT at boot, the counter then gives a nanosecond monotonic
+ * clock. The TSC of all the CPUs are expected to be synchronized.
+ ******************************************************************************/
+
+#include "../lib/stdint.h"         /* Generic int types */
+#include "../lib/stddef.h"         /* OS_RETURN_E */
+#include "../cpu/cpu.h"            /* rdtsc, cpuid, cpu_udiv_64_32 */
+#include "../core/interrupts.h"    /* get_current_uptime, set_IRQ_EOI */
+#include "pit.h"                   /* set_pit_handler, set_pit_freq,
+                                      enable_pit, disable_pit */
+
+#include "../debug.h"              /* kernel_serial_debug */
+
+/* Header file */
+#include "tsc.h"
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************/
+
+/* Calibration state, PIT ticks left and TSC at the first and last ticks */
+static volatile uint32_t calibration_ticks;
+static volatile uint64_t calibration_start;
+static volatile uint64_t calibration_end;
+
+/* TSC frequency in kHz and cycles to nanoseconds factor */
+static uint32_t tsc_freq_khz;
+static uint32_t tsc_ns_mult;
+
+/* TSC value at calibration, origin of the monotonic clock */
+static uint64_t tsc_base;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* PIT IRQ handler used during the calibration. The TSC is read on the first
+ * tick and after TSC_CALIBRATION_TICKS ticks.
+ *
+ * @param cpu_state The cpu registers before the interrupt.
+ * @param int_id The interrupt line that called the handler.
+ * @param stack_state The stack state before the interrupt.
+ */
+static void tsc_init_pit_handler(cpu_state_t* cpu_state, uint32_t int_id,
+                                 stack_state_t* stack_state)
+{
+    (void)cpu_state;
+    (void)int_id;
+    (void)stack_state;
+
+    if(calibration_ticks == TSC_CALIBRATION_TICKS + 1)
+    {
+        calibration_start = rdtsc();
+        --calibration_ticks;
+    }
+    else if(calibration_ticks > 1)
+    {
+        --calibration_ticks;
+    }
+    else if(calibration_ticks == 1)
+    {
+        calibration_end   = rdtsc();
+        calibration_ticks = 0;
+    }
+
+    set_IRQ_EOI(PIT_IRQ_LINE);
+}
+
+OS_RETURN_E init_tsc(void)
+{
+    OS_RETURN_E err;
+    OS_RETURN_E wait_err;
+    uint32_t    regs[4];
+    uint32_t    cycles;
+    uint64_t    wait_start;
+
+    tsc_freq_khz = 0;
+    tsc_ns_mult  = 0;
+
+    if(cpuid(CPUID_GETFEATURES, regs) == 0 || (regs[3] & BIT_TSC) == 0)
+    {
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    calibration_ticks = TSC_CALIBRATION_TICKS + 1;
+
+    err = set_pit_freq(TSC_CALIBRATION_FREQ);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    err = set_pit_handler(tsc_init_pit_handler);
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    /* The PIT IRQ is masked until the scheduler starts, unmask it while the
+     * counter data is gathered.
+     */
+    err = enable_pit();
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    /* Wait for interrupts to gather the counter data, give up if the PIT
+     * does not tick.
+     */
+    wait_err   = OS_NO_ERR;
+    wait_start = rdtsc();
+    enable_local_interrupt();
+    while(calibration_ticks != 0)
+    {
+        if(rdtsc() - wait_start > TSC_CALIBRATION_TIMEOUT)
+        {
+            wait_err = OS_ERR_UNAUTHORIZED_ACTION;
+            break;
+        }
+    }
+    disable_local_interrupt();
+
+    err = disable_pit();
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    err = remove_pit_handler();
+    if(err != OS_NO_ERR)
+    {
+        return err;
+    }
+
+    if(wait_err != OS_NO_ERR)
+    {
+        #ifdef DEBUG_TSC
+        kernel_serial_debug("TSC calibration timeout\n");
+        #endif
+        return wait_err;
+    }
+
+    /* A few hundred milliseconds at most, the count fits in 32 bits */
+    cycles       = (uint32_t)(calibration_end - calibration_start);
+    tsc_freq_khz = cycles /
+                   (TSC_CALIBRATION_TICKS * (1000 / TSC_CALIBRATION_FREQ));
+
+    if(tsc_freq_khz < TSC_MIN_FREQ_KHZ)
+    {
+        tsc_freq_khz = 0;
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    /* Nanoseconds per cycle, fixed point */
+    tsc_ns_mult = cpu_udiv_64_32(1000000ULL << TSC_NS_SHIFT, tsc_freq_khz);
+    tsc_base    = calibration_end;
+
+    #ifdef DEBUG_TSC
+    kernel_serial_debug("TSC frequency %d kHz, mult %d\n",
+                        tsc_freq_khz, tsc_ns_mult);
+    #endif
+
+    return OS_NO_ERR;
+}
+
+uint64_t get_cycles(void)
+{
+    return rdtsc();
+}
+
+uint32_t get_tsc_frequency_khz(void)
+{
+    return tsc_freq_khz;
+}
+
+uint64_t tsc_cycles_to_ns(const uint64_t cycles)
+{
+    uint64_t ns;
+
+    /* The product is split to stay on 64 bits */
+    ns  = ((uint64_t)(uint32_t)cycles * tsc_ns_mult) >> TSC_NS_SHIFT;
+    ns += ((uint64_t)(uint32_t)(cycles >> 32) * tsc_ns_mult) <<
+          (32 - TSC_NS_SHIFT);
+
+    return ns;
+}
+
+uint64_t get_monotonic_ns(void)
+{
+    uint64_t now;
+
+    if(tsc_freq_khz == 0)
+    {
+        return (uint64_t)get_current_uptime() * 1000000ULL;
+    }
+
+    now = rdtsc();
+    if(now < tsc_base)
+    {
+        return 0;
+    }
+
+    return tsc_cycles_to_ns(now - tsc_base);
+}
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ *
+ * File: tsc.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * TSC (Time stamp counter) clocksource. The TSC frequency is calibrated
+ * against the PIT at boot, the counter then gives a nanosecond monotonic
+ * clock. The TSC of all the CPUs are expected to be synchronized.
+ ******************************************************************************/
+
+#ifndef __TSC_H_
+#define __TSC_H_
+
+#include "../lib/stdint.h"       /* Generic int types */
+#include "../lib/stddef.h"       /* OS_RETURN_E */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* PIT frequency and number of PIT ticks used for the calibration */
+#define TSC_CALIBRATION_FREQ     100
+#define TSC_CALIBRATION_TICKS    5
+
+/* Maximal number of cycles waited for the calibration ticks, about one
+ * second at 4 GHz
+ */
+#define TSC_CALIBRATION_TIMEOUT  0xF0000000ULL
+
+/* Cycles to nanoseconds conversion precision, ns = (cycles * mult) >> shift */
+#define TSC_NS_SHIFT             24
+
+/* Minimal TSC frequency in kHz, the conversion factor must fit in 32 bits */
+#define TSC_MIN_FREQ_KHZ         4000
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Calibrate the TSC frequency against the PIT. The PIT must be initialized,
+ * its IRQ is unmasked during the calibration and its default handler is set
+ * back after it. If the PIT does not tick, the calibration gives up and the
+ * monotonic clock keeps using the uptime.
+ *
+ * @returns OS_NO_ERR on success, an error if the TSC is not available or could
+ * not be calibrated.
+ */
+OS_RETURN_E init_tsc(void);
+
+/* Returns the current TSC value of the CPU.
+ *
+ * @returns The number of cycles elapsed since the CPU reset.
+ */
+uint64_t get_cycles(void);
+
+/* Returns the calibrated TSC frequency.
+ *
+ * @returns The TSC frequency in kHz, 0 if the TSC is not calibrated.
+ */
+uint32_t get_tsc_frequency_khz(void);
+
+/* Convert a number of TSC cycles to nanoseconds.
+ *
+ * @param cycles The number of cycles to convert.
+ * @returns The time in nanoseconds, 0 if the TSC is not calibrated.
+ */
+uint64_t tsc_cycles_to_ns(const uint64_t cycles);
+
+/* Returns the time elapsed since the TSC calibration. If the TSC is not
+ * available the system uptime is used, with its tick granularity.
+ *
+ * @returns The monotonic time in nanoseconds.
+ */
+uint64_t get_monotonic_ns(void);
+
+#endif /* __TSC_H_ */
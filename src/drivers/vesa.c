@@ -18,7 +18,9 @@
 #include "../lib/string.h"     /* memmove, memset */
 #include "../bios/bios_call.h" /* regs_t, bios_call */
 #include "../fonts/uni_vga.c"  /* __font_bitmap__ */
-#include "../core/scheduler.h" /* create_thread, thread_t */
+#include "../core/scheduler.h" /* create_thread_affinity, thread_t */
+#include "../cpu/smp.h"        /* get_booted_cpu_count */
+#include "../core/thread_pool.h" /* parallel_for */
 #include "../cpu/cpu.h"        /* inb  */
 #include "vga_text.h"          /* vga_get_framebuffer */
 #include "serial.h"            /* serial_write */
@@ -83,21 +85,71 @@ static const uint32_t vga_color_table[16] = {
  * FUNCTIONS
  ******************************************************************************/
 
+/* Copy the blocks [first, last[ of the double buffer to the framebuffer.
+ *
+ * @param first The first block to copy.
+ * @param last The block following the last block to copy.
+ * @param args Unused.
+ */
+static void swap_buffer_blocks(uint32_t first, uint32_t last, void* args)
+{
+    uint32_t offset;
+    uint32_t size;
+
+    (void)args;
+
+    offset = first * VESA_SWAP_BLOCK_SIZE;
+    size   = last * VESA_SWAP_BLOCK_SIZE;
+    if(size > vesa_buffer_size)
+    {
+        size = vesa_buffer_size;
+    }
+    size -= offset;
+
+    memcpy((uint8_t*)current_mode->framebuffer + offset, vesa_buffer + offset,
+           size);
+}
+
  static void* swap_buffer(void* args)
  {
+     OS_RETURN_E     err;
+     uint32_t        blocks;
+     thread_period_t period;
+
      (void)args;
      #ifdef DEBUG_VESA
         kernel_serial_debug("VESA double buffering thread online!\n");
         kernel_serial_debug("\t SIZE = %d\n", vesa_buffer_size);
      #endif
+     blocks = (vesa_buffer_size + VESA_SWAP_BLOCK_SIZE - 1) /
+              VESA_SWAP_BLOCK_SIZE;
+
+     /* The buffer is copied at a fixed rate whatever the copy time */
+     err = thread_period_init(&period, VESA_SWAP_PERIOD);
+     if(err != OS_NO_ERR)
+     {
+         return NULL;
+     }
+
      while(double_buffering == 1)
      {
-         memcpy((uint32_t*)current_mode->framebuffer, vesa_buffer, vesa_buffer_size);
-         sleep(10);
+         err = parallel_for(0, blocks, VESA_SWAP_GRAIN, swap_buffer_blocks,
+                            NULL);
+         #ifdef DEBUG_VESA
+         if(err != OS_NO_ERR)
+         {
+             kernel_serial_debug("VESA buffer swap failure %d\n", err);
+         }
+         #else
+         (void)err;
+         #endif
+         thread_period_wait(&period);
      }
 
      #ifdef DEBUG_VESA
         kernel_serial_debug("VESA double buffering thread offline!\n");
+        kernel_serial_debug("\t OVERRUNS = %d/%d\n", period.overruns,
+                            period.releases);
      #endif
      return NULL;
  }
@@ -1086,13 +1138,29 @@ OS_RETURN_E vesa_enable_double_buffering(void)
         memcpy((uint32_t*)vesa_buffer, (uint32_t*)current_mode->framebuffer, vesa_buffer_size);
 
         double_buffering = 1;
-        err = create_thread(&double_buffering_thread, swap_buffer,
-                            KERNEL_HIGHEST_PRIORITY, "VESA Driver", NULL);
+        /* The copy loop runs on the last CPU, away from the main CPU */
+        err = create_thread_affinity(&double_buffering_thread, swap_buffer,
+                                     KERNEL_HIGHEST_PRIORITY, "VESA Driver",
+                                     NULL,
+                                     THREAD_AFFINITY_CPU(
+                                        get_booted_cpu_count() - 1),
+                                     THREAD_STACK_SIZE);
         if(err != OS_NO_ERR)
         {
             double_buffering = 0;
             return err;
         }
+
+        /* Without reservation the thread keeps its priority */
+        err = set_thread_deadline(double_buffering_thread, VESA_SWAP_RUNTIME,
+                                  VESA_SWAP_PERIOD, VESA_SWAP_PERIOD);
+        #ifdef DEBUG_VESA
+        if(err != OS_NO_ERR)
+        {
+            kernel_serial_debug("VESA deadline reservation failure %d\n",
+                                err);
+        }
+        #endif
     }
     return OS_NO_ERR;
 }
@@ -35,6 +35,16 @@
 #define VESA_FLAG_LFB_ENABLE 0x4000
 
 #define MAX_VESA_MODE_COUNT 245
+
+/* Double buffering copy, the buffer is copied by blocks split between the
+ * CPUs, a CPU copies at least VESA_SWAP_GRAIN blocks
+ */
+#define VESA_SWAP_BLOCK_SIZE 4096
+#define VESA_SWAP_GRAIN      16
+
+/* Double buffering thread deadline reservation (in us) */
+#define VESA_SWAP_RUNTIME    2000
+#define VESA_SWAP_PERIOD     10000
 /*******************************************************************************
  * STRUCTURES
  ******************************************************************************/
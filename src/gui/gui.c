@@ -1,5 +1,6 @@
 #include "../drivers/vesa.h"
 #include "../core/scheduler.h"
+#include "../cpu/smp.h"
 #include "../memory/heap.h"
 #include "../sync/lock.h"
 #include "../lib/string.h"
@@ -27,9 +28,17 @@ window_t windows[10];
 
 static void* update_desktop(void* args)
 {
-    uint32_t i;
+    uint32_t        i;
+    thread_period_t period;
 
     (void)args;
+
+    /* The desktop is drawn at a fixed rate whatever the drawing time */
+    if(thread_period_init(&period, GUI_UPDATE_PERIOD) != OS_NO_ERR)
+    {
+        return NULL;
+    }
+
     while(update_enabled)
     {
 
@@ -50,7 +59,7 @@ static void* update_desktop(void* args)
         vesa_fill_screen(desktop_buffer);
         spinlock_unlock(&desktop_buffer_lock);
 
-        sleep(10);
+        thread_period_wait(&period);
     }
 
     return NULL;
@@ -136,14 +145,24 @@ OS_RETURN_E start_gui(void)
 
     update_enabled = 1;
 
-    err = create_thread(&update_thread, update_desktop, KERNEL_HIGHEST_PRIORITY,
-                        "UI desktop", NULL);
+    /* The desktop shares the last CPU with the VESA copy loop */
+    err = create_thread_affinity(&update_thread, update_desktop,
+                                 KERNEL_HIGHEST_PRIORITY, "UI desktop", NULL,
+                                 THREAD_AFFINITY_CPU(
+                                    get_booted_cpu_count() - 1),
+                                 THREAD_STACK_SIZE);
 
     if(err != OS_NO_ERR)
     {
         kfree(background);
         kfree(desktop_buffer);
     }
+    else
+    {
+        /* Without reservation the thread keeps its priority */
+        set_thread_deadline(update_thread, GUI_UPDATE_RUNTIME,
+                            GUI_UPDATE_PERIOD, GUI_UPDATE_PERIOD);
+    }
 
     return OS_NO_ERR;
 }
@@ -21,6 +21,10 @@
  * CONSTANTS
  ******************************************************************************/
 
+/* Desktop update thread deadline reservation (in us) */
+#define GUI_UPDATE_RUNTIME 3000
+#define GUI_UPDATE_PERIOD  10000
+
 /*******************************************************************************
 * STRUCTURES
 *******************************************************************************/
@@ -15,6 +15,8 @@
 #include "../lib/stddef.h"     /* OS_RETURN_E */
 #include "../boot/multiboot.h" /* MULTIBOOT_MEMORY_AVAILABLE */
 #include "heap.h"              /* kmalloc kfree */
+#include "../cpu/cpu.h"        /* cpu_fetch_add */
+#include "../cpu/smp.h"        /* get_cpu_id, MAX_CPU_COUNT */
 
 #include "../debug.h"            /* DEBUG */
 
@@ -43,6 +45,10 @@ static uint32_t kernel_page_tables[1024][1024] __attribute__((aligned(4096)));
 static uint8_t init = 0;
 static uint8_t enabled;
 
+/* Number of TLB shootdowns and last one each CPU served */
+static volatile uint32_t tlb_generation = 0;
+static uint32_t          cpu_tlb_generation[MAX_CPU_COUNT];
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
@@ -425,3 +431,33 @@ OS_RETURN_E kernel_munmap(uint8_t* virt_addr, const uint32_t mapping_size)
 
     return OS_NO_ERR;
 }
+
+void kernel_tlb_shootdown(void)
+{
+    uint32_t generation;
+
+    /* The page tables are updated before the generation is raised */
+    generation = cpu_fetch_add(&tlb_generation, 1) + 1;
+
+    invalidate_tlb();
+    cpu_tlb_generation[get_cpu_id()] = generation;
+
+    #ifdef DEBUG_MEM
+    kernel_serial_debug("TLB shootdown %d\n", generation);
+    #endif
+}
+
+void kernel_tlb_sync(const uint32_t cpu_id)
+{
+    uint32_t generation;
+
+    /* The generation is read before the flush, a later shootdown is served by
+     * the next call
+     */
+    generation = tlb_generation;
+    if(cpu_tlb_generation[cpu_id] != generation)
+    {
+        invalidate_tlb();
+        cpu_tlb_generation[cpu_id] = generation;
+    }
+}
@@ -78,4 +78,19 @@ OS_RETURN_E kernel_mmap(uint8_t* virt_addr, uint8_t* phys_addr,
 
 OS_RETURN_E kernel_munmap(uint8_t* virt_addr, const uint32_t mapping_size);
 
+/* Flush the TLB of the calling CPU and request every other CPU to flush its TLB
+ * before it switches to an other thread, see kernel_tlb_sync. kernel_munmap
+ * only flushes the calling CPU TLB, the function must be called once the
+ * unmapped pages must fault on every CPU. The pages must not be used by the
+ * threads running on the other CPUs until they switch threads.
+ */
+void kernel_tlb_shootdown(void);
+
+/* Flush the TLB of the calling CPU if a shootdown was requested since its last
+ * flush. Called by the scheduler before switching threads.
+ *
+ * @param cpu_id The id of the calling CPU.
+ */
+void kernel_tlb_sync(const uint32_t cpu_id);
+
 #endif /* __PAGING_H_ */
@@ -0,0 +1,333 @@
+/*******************************************************************************
+ *
+ * File: slab.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel object caches (slab allocator). Objects of the same type are carved in
+ * slabs allocated on the kernel heap. Freed objects are kept in their slab and
+ * reused without going through the heap allocator.
+ ******************************************************************************/
+
+#include "../lib/stdint.h"          /* Generic int types */
+#include "../lib/stddef.h"          /* OS_RETURN_E */
+#include "../sync/lock.h"           /* spinlock */
+#include "heap.h"                   /* kmalloc, kfree */
+
+#include "../debug.h"               /* kernel_serial_debug */
+
+/* Header file */
+#include "slab.h"
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Object header, placed right before each object of a slab */
+typedef struct kmem_bufctl
+{
+    struct kmem_slab*   slab;
+    struct kmem_bufctl* next_free;
+} kmem_bufctl_t;
+
+/* Slab header, placed at the beginning of the slab memory */
+typedef struct kmem_slab
+{
+    struct kmem_slab* next;
+    struct kmem_slab* prev;
+
+    kmem_bufctl_t*    free_list;
+
+    uint32_t          used;
+    uint32_t          capacity;
+} kmem_slab_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Compute the layout of the slabs of a cache.
+ *
+ * @param cache The cache to compute the layout of.
+ * @param stride The space used by an object and its header in the slab.
+ * @param count The number of objects in a slab.
+ */
+static void kmem_cache_geometry(const kmem_cache_t* cache, uint32_t* stride,
+                                uint32_t* count)
+{
+    *stride = (sizeof(kmem_bufctl_t) + cache->obj_size + KMEM_ALIGN - 1) &
+              ~(KMEM_ALIGN - 1);
+
+    *count = (KMEM_SLAB_MIN_SIZE - sizeof(kmem_slab_t)) / *stride;
+    if(*count < KMEM_SLAB_MIN_OBJECTS)
+    {
+        *count = KMEM_SLAB_MIN_OBJECTS;
+    }
+}
+
+/* Add a slab at the head of a slabs list.
+ *
+ * @param list The list to add the slab to.
+ * @param slab The slab to add.
+ */
+__inline__ static void kmem_slab_push(kmem_slab_t** list, kmem_slab_t* slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+    if(*list != NULL)
+    {
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+
+/* Remove a slab from a slabs list.
+ *
+ * @param list The list containing the slab.
+ * @param slab The slab to remove.
+ */
+__inline__ static void kmem_slab_remove(kmem_slab_t** list, kmem_slab_t* slab)
+{
+    if(slab->prev != NULL)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        *list = slab->next;
+    }
+    if(slab->next != NULL)
+    {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = NULL;
+    slab->prev = NULL;
+}
+
+/* Allocate a new slab for the cache given as parameter and construct its
+ * objects. The cache lock must not be held.
+ *
+ * @param cache The cache to create the slab for.
+ * @returns The new slab, NULL if the memory could not be allocated.
+ */
+static kmem_slab_t* kmem_slab_create(kmem_cache_t* cache)
+{
+    kmem_slab_t*   slab;
+    kmem_bufctl_t* bufctl;
+    uint32_t       stride;
+    uint32_t       count;
+    uint32_t       first;
+    uint32_t       i;
+
+    kmem_cache_geometry(cache, &stride, &count);
+
+    slab = kmalloc(sizeof(kmem_slab_t) + KMEM_ALIGN + count * stride);
+    if(slab == NULL)
+    {
+        return NULL;
+    }
+
+    slab->next      = NULL;
+    slab->prev      = NULL;
+    slab->free_list = NULL;
+    slab->used      = 0;
+    slab->capacity  = count;
+
+    /* Objects are aligned, their header is right before them */
+    first = (((uint32_t)(slab + 1) + sizeof(kmem_bufctl_t) + KMEM_ALIGN - 1) &
+             ~(KMEM_ALIGN - 1)) - sizeof(kmem_bufctl_t);
+
+    for(i = 0; i < count; ++i)
+    {
+        bufctl = (kmem_bufctl_t*)(first + (count - 1 - i) * stride);
+
+        bufctl->slab      = slab;
+        bufctl->next_free = slab->free_list;
+        slab->free_list   = bufctl;
+
+        if(cache->ctor != NULL)
+        {
+            cache->ctor(bufctl + 1);
+        }
+    }
+
+    #ifdef DEBUG_SLAB
+    kernel_serial_debug("Cache %s new slab 0x%08x (%d objects)\n",
+                        cache->name, (uint32_t)slab, count);
+    #endif
+
+    return slab;
+}
+
+/* Destroy the objects of a slab and release its memory. The slab must be empty
+ * and must not be in any list of the cache. The cache lock must not be held.
+ *
+ * @param cache The cache the slab belonged to.
+ * @param slab The slab to destroy.
+ */
+static void kmem_slab_destroy(kmem_cache_t* cache, kmem_slab_t* slab)
+{
+    kmem_bufctl_t* bufctl;
+
+    if(cache->dtor != NULL)
+    {
+        for(bufctl = slab->free_list; bufctl != NULL;
+            bufctl = bufctl->next_free)
+        {
+            cache->dtor(bufctl + 1);
+        }
+    }
+
+    #ifdef DEBUG_SLAB
+    kernel_serial_debug("Cache %s release slab 0x%08x\n",
+                        cache->name, (uint32_t)slab);
+    #endif
+
+    kfree(slab);
+}
+
+void* kmem_cache_alloc(kmem_cache_t* cache)
+{
+    kmem_slab_t*   slab;
+    kmem_bufctl_t* bufctl;
+
+    if(cache == NULL)
+    {
+        return NULL;
+    }
+
+    spinlock_lock(&cache->lock);
+
+    /* Use the partial slabs first to keep the empty ones releasable */
+    while(cache->partial_slabs == NULL && cache->empty_slabs == NULL)
+    {
+        spinlock_unlock(&cache->lock);
+
+        slab = kmem_slab_create(cache);
+        if(slab == NULL)
+        {
+            return NULL;
+        }
+
+        spinlock_lock(&cache->lock);
+        kmem_slab_push(&cache->empty_slabs, slab);
+        ++cache->empty_count;
+        ++cache->slab_count;
+    }
+
+    if(cache->partial_slabs != NULL)
+    {
+        slab = cache->partial_slabs;
+    }
+    else
+    {
+        slab = cache->empty_slabs;
+        kmem_slab_remove(&cache->empty_slabs, slab);
+        kmem_slab_push(&cache->partial_slabs, slab);
+        --cache->empty_count;
+    }
+
+    bufctl          = slab->free_list;
+    slab->free_list = bufctl->next_free;
+    ++slab->used;
+
+    if(slab->used == slab->capacity)
+    {
+        kmem_slab_remove(&cache->partial_slabs, slab);
+        kmem_slab_push(&cache->full_slabs, slab);
+    }
+
+    ++cache->obj_count;
+
+    spinlock_unlock(&cache->lock);
+
+    return bufctl + 1;
+}
+
+OS_RETURN_E kmem_cache_free(kmem_cache_t* cache, void* obj)
+{
+    kmem_slab_t*   slab;
+    kmem_bufctl_t* bufctl;
+
+    if(cache == NULL || obj == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    bufctl = (kmem_bufctl_t*)obj - 1;
+    slab   = bufctl->slab;
+
+    spinlock_lock(&cache->lock);
+
+    if(slab == NULL || slab->used == 0)
+    {
+        spinlock_unlock(&cache->lock);
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    if(slab->used == slab->capacity)
+    {
+        kmem_slab_remove(&cache->full_slabs, slab);
+        kmem_slab_push(&cache->partial_slabs, slab);
+    }
+
+    bufctl->next_free = slab->free_list;
+    slab->free_list   = bufctl;
+    --slab->used;
+    --cache->obj_count;
+
+    if(slab->used == 0)
+    {
+        kmem_slab_remove(&cache->partial_slabs, slab);
+
+        /* Keep a few empty slabs, release the others to the heap */
+        if(cache->empty_count >= KMEM_CACHE_MAX_EMPTY)
+        {
+            --cache->slab_count;
+            spinlock_unlock(&cache->lock);
+
+            kmem_slab_destroy(cache, slab);
+            return OS_NO_ERR;
+        }
+
+        kmem_slab_push(&cache->empty_slabs, slab);
+        ++cache->empty_count;
+    }
+
+    spinlock_unlock(&cache->lock);
+
+    return OS_NO_ERR;
+}
+
+uint32_t kmem_cache_shrink(kmem_cache_t* cache)
+{
+    kmem_slab_t* slab;
+    kmem_slab_t* next;
+    uint32_t     count;
+
+    if(cache == NULL)
+    {
+        return 0;
+    }
+
+    spinlock_lock(&cache->lock);
+    slab                = cache->empty_slabs;
+    count               = cache->empty_count;
+    cache->empty_slabs  = NULL;
+    cache->empty_count  = 0;
+    cache->slab_count  -= count;
+    spinlock_unlock(&cache->lock);
+
+    while(slab != NULL)
+    {
+        next = slab->next;
+        kmem_slab_destroy(cache, slab);
+        slab = next;
+    }
+
+    return count;
+}
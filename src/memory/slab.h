@@ -0,0 +1,111 @@
+/*******************************************************************************
+ *
+ * File: slab.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel object caches (slab allocator). Objects of the same type are carved in
+ * slabs allocated on the kernel heap. Freed objects are kept in their slab and
+ * reused without going through the heap allocator.
+ ******************************************************************************/
+
+#ifndef __SLAB_H_
+#define __SLAB_H_
+
+#include "../lib/stdint.h" /* Generic int types */
+#include "../lib/stddef.h" /* OS_RETURN_E */
+#include "../sync/lock.h"  /* lock_t */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Objects alignment */
+#define KMEM_ALIGN             16
+
+/* Minimal size of a slab and minimal number of objects per slab */
+#define KMEM_SLAB_MIN_SIZE     4096
+#define KMEM_SLAB_MIN_OBJECTS  4
+
+/* Number of empty slabs kept by a cache before releasing them to the heap */
+#define KMEM_CACHE_MAX_EMPTY   1
+
+/* Static object cache initializer.
+ *
+ * @param cache_name The name of the cache.
+ * @param size The size of the cached objects.
+ * @param ctor_func The constructor called on each object when a slab is
+ * created, may be NULL.
+ * @param dtor_func The destructor called on each object when a slab is
+ * released, may be NULL.
+ */
+#define KMEM_CACHE_INIT(cache_name, size, ctor_func, dtor_func) \
+    {                                                           \
+        (cache_name), (size), (ctor_func), (dtor_func),         \
+        NULL, NULL, NULL, 0, 0, 0,                              \
+        {0, 0, -1}                                              \
+    }
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+struct kmem_slab;
+
+/* Object cache, see KMEM_CACHE_INIT */
+typedef struct kmem_cache
+{
+    const char* name;
+    uint32_t    obj_size;
+
+    /* Objects constructor and destructor hooks */
+    void        (*ctor)(void*);
+    void        (*dtor)(void*);
+
+    /* Slabs lists */
+    struct kmem_slab* partial_slabs;
+    struct kmem_slab* full_slabs;
+    struct kmem_slab* empty_slabs;
+
+    /* Statistics */
+    uint32_t    empty_count;
+    uint32_t    slab_count;
+    uint32_t    obj_count;
+
+    lock_t      lock;
+} kmem_cache_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Allocate an object from the cache given as parameter. A new slab is created
+ * if the cache has no free object. The object is in the state left by the
+ * constructor or by the last user that freed it.
+ *
+ * @param cache The cache to allocate the object from.
+ * @returns A pointer to the object, NULL if the memory could not be allocated.
+ */
+void* kmem_cache_alloc(kmem_cache_t* cache);
+
+/* Release an object allocated from the cache given as parameter. The object
+ * must be given back in its constructed state.
+ *
+ * @param cache The cache the object was allocated from.
+ * @param obj The object to release.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E kmem_cache_free(kmem_cache_t* cache, void* obj);
+
+/* Release the empty slabs of the cache given as parameter to the kernel heap.
+ *
+ * @param cache The cache to shrink.
+ * @returns The number of slabs released.
+ */
+uint32_t kmem_cache_shrink(kmem_cache_t* cache);
+
+#endif /* __SLAB_H_ */
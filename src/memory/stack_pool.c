@@ -0,0 +1,370 @@
+/*******************************************************************************
+ *
+ * File: stack_pool.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel threads stacks pool. Stacks are carved in page aligned chunks
+ * allocated on the kernel heap, each stack lies right above an unmapped guard
+ * page so an overflow faults instead of corrupting the memory below. Stacks
+ * sizes are rounded up to a power of two number of pages, freed stacks are
+ * reused.
+ ******************************************************************************/
+
+#include "../lib/stdint.h"          /* Generic int types */
+#include "../lib/stddef.h"          /* OS_RETURN_E */
+#include "../sync/lock.h"           /* spinlock */
+#include "../cpu/cpu.h"             /* cpu_bsf */
+#include "heap.h"                   /* kmalloc, kfree */
+#include "slab.h"                   /* kmem_cache_alloc, kmem_cache_free */
+#include "paging.h"                 /* kernel_mmap, kernel_munmap,
+                                       kernel_tlb_shootdown */
+#include "../core/kernel_output.h"  /* kernel_error */
+#include "../core/panic.h"          /* kernel_panic */
+
+#include "../debug.h"               /* kernel_serial_debug */
+
+/* Header file */
+#include "stack_pool.h"
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Chunk of stacks. A slot is a guard page followed by a stack, the first slot
+ * is the first page aligned address of the heap block.
+ */
+typedef struct stack_chunk
+{
+    struct stack_chunk* next;
+    struct stack_chunk* prev;
+
+    void*               block;
+    uint8_t*            slots;
+
+    uint32_t            class_id;
+    uint32_t            count;
+
+    /* Bit n is set when the slot n is free */
+    uint32_t            free_mask;
+} stack_chunk_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************/
+
+/* Chunks of each class and number of empty ones, protected by pool_lock */
+static stack_chunk_t* class_chunks[STACK_POOL_CLASSES];
+static uint32_t       class_empty[STACK_POOL_CLASSES];
+static lock_t         pool_lock = {0, 0, -1};
+
+/* Chunks descriptors cache */
+static kmem_cache_t chunk_cache = KMEM_CACHE_INIT("stack_chunk",
+                                                  sizeof(stack_chunk_t),
+                                                  NULL, NULL);
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Compute the layout of the chunks of a class.
+ *
+ * @param class_id The class to compute the layout of.
+ * @param slot_size The size of a slot, guard page included.
+ * @param count The number of slots in a chunk.
+ */
+static void stack_pool_geometry(const uint32_t class_id, uint32_t* slot_size,
+                                uint32_t* count)
+{
+    *slot_size = (KERNEL_PAGE_SIZE << class_id) + KERNEL_PAGE_SIZE;
+
+    *count = (STACK_POOL_CHUNK_PAGES * KERNEL_PAGE_SIZE) / *slot_size;
+    if(*count == 0)
+    {
+        *count = 1;
+    }
+}
+
+/* Map back the guard pages of the first slots of a chunk and release its
+ * memory. The chunk must not be in any list. The pool lock must not be held.
+ *
+ * @param chunk The chunk to destroy.
+ * @param guards The number of slots which guard page is unmapped.
+ */
+static void stack_chunk_destroy(stack_chunk_t* chunk, const uint32_t guards)
+{
+    OS_RETURN_E err;
+    uint32_t    slot_size;
+    uint32_t    count;
+    uint32_t    i;
+
+    stack_pool_geometry(chunk->class_id, &slot_size, &count);
+
+    for(i = 0; i < guards; ++i)
+    {
+        err = kernel_mmap(chunk->slots + i * slot_size,
+                          chunk->slots + i * slot_size,
+                          KERNEL_PAGE_SIZE,
+                          PAGE_FLAG_SUPER_ACCESS | PAGE_FLAG_READ_WRITE, 0);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not map stack guard page[%d]\n", err);
+            kernel_panic();
+        }
+    }
+
+    #ifdef DEBUG_STACK
+    kernel_serial_debug("Stack pool release chunk 0x%08x (class %d)\n",
+                        (uint32_t)chunk->slots, chunk->class_id);
+    #endif
+
+    kfree(chunk->block);
+    kmem_cache_free(&chunk_cache, chunk);
+}
+
+/* Allocate a new chunk for a class and unmap the guard pages of its slots.
+ * The pool lock must not be held.
+ *
+ * @param class_id The class to create the chunk for.
+ * @returns The new chunk, NULL if the memory could not be allocated.
+ */
+static stack_chunk_t* stack_chunk_create(const uint32_t class_id)
+{
+    OS_RETURN_E    err;
+    stack_chunk_t* chunk;
+    uint32_t       slot_size;
+    uint32_t       count;
+    uint32_t       i;
+
+    stack_pool_geometry(class_id, &slot_size, &count);
+
+    chunk = kmem_cache_alloc(&chunk_cache);
+    if(chunk == NULL)
+    {
+        return NULL;
+    }
+
+    chunk->block = kmalloc(count * slot_size + KERNEL_PAGE_SIZE);
+    if(chunk->block == NULL)
+    {
+        kmem_cache_free(&chunk_cache, chunk);
+        return NULL;
+    }
+
+    chunk->next      = NULL;
+    chunk->prev      = NULL;
+    chunk->slots     = (uint8_t*)(((uint32_t)chunk->block +
+                                   KERNEL_PAGE_SIZE - 1) &
+                                  ~(KERNEL_PAGE_SIZE - 1));
+    chunk->class_id  = class_id;
+    chunk->count     = count;
+    chunk->free_mask = (1U << count) - 1;
+
+    /* The kernel memory is identity mapped, the guard pages are unmapped from
+     * it. The other CPUs flush the guard pages from their TLB before executing
+     * a thread, hence before using a stack of the chunk.
+     */
+    for(i = 0; i < count; ++i)
+    {
+        err = kernel_munmap(chunk->slots + i * slot_size, KERNEL_PAGE_SIZE);
+        if(err != OS_NO_ERR)
+        {
+            stack_chunk_destroy(chunk, i);
+            return NULL;
+        }
+    }
+    kernel_tlb_shootdown();
+
+    #ifdef DEBUG_STACK
+    kernel_serial_debug("Stack pool new chunk 0x%08x (class %d, %d stacks)\n",
+                        (uint32_t)chunk->slots, class_id, count);
+    #endif
+
+    return chunk;
+}
+
+/* Add a chunk at the head of its class list. The pool lock must be held.
+ *
+ * @param chunk The chunk to add.
+ */
+__inline__ static void stack_chunk_push(stack_chunk_t* chunk)
+{
+    chunk->prev = NULL;
+    chunk->next = class_chunks[chunk->class_id];
+    if(chunk->next != NULL)
+    {
+        chunk->next->prev = chunk;
+    }
+    class_chunks[chunk->class_id] = chunk;
+}
+
+/* Remove a chunk from its class list. The pool lock must be held.
+ *
+ * @param chunk The chunk to remove.
+ */
+__inline__ static void stack_chunk_remove(stack_chunk_t* chunk)
+{
+    if(chunk->prev != NULL)
+    {
+        chunk->prev->next = chunk->next;
+    }
+    else
+    {
+        class_chunks[chunk->class_id] = chunk->next;
+    }
+    if(chunk->next != NULL)
+    {
+        chunk->next->prev = chunk->prev;
+    }
+    chunk->next = NULL;
+    chunk->prev = NULL;
+}
+
+OS_RETURN_E stack_pool_alloc(const uint32_t size, kernel_stack_t* stack)
+{
+    stack_chunk_t* chunk;
+    uint32_t       class_id;
+    uint32_t       slot_size;
+    uint32_t       count;
+    uint32_t       slot;
+    uint32_t       i;
+
+    if(stack == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    if(size == 0 || size > STACK_POOL_MAX_SIZE)
+    {
+        return OS_ERR_OUT_OF_BOUND;
+    }
+
+    class_id = 0;
+    while((uint32_t)(KERNEL_PAGE_SIZE << class_id) < size)
+    {
+        ++class_id;
+    }
+    stack_pool_geometry(class_id, &slot_size, &count);
+
+    spinlock_lock(&pool_lock);
+
+    /* Use a chunk with a free slot, create one if the class has none */
+    chunk = class_chunks[class_id];
+    while(chunk == NULL || chunk->free_mask == 0)
+    {
+        if(chunk != NULL)
+        {
+            chunk = chunk->next;
+            continue;
+        }
+
+        spinlock_unlock(&pool_lock);
+
+        chunk = stack_chunk_create(class_id);
+        if(chunk == NULL)
+        {
+            return OS_ERR_MALLOC;
+        }
+
+        spinlock_lock(&pool_lock);
+        stack_chunk_push(chunk);
+        ++class_empty[class_id];
+    }
+
+    if(chunk->free_mask == (1U << chunk->count) - 1)
+    {
+        --class_empty[class_id];
+    }
+    slot              = cpu_bsf(chunk->free_mask);
+    chunk->free_mask &= ~(1U << slot);
+
+    spinlock_unlock(&pool_lock);
+
+    stack->base  = (uint32_t*)(chunk->slots + slot * slot_size +
+                               KERNEL_PAGE_SIZE);
+    stack->size  = KERNEL_PAGE_SIZE << class_id;
+    stack->chunk = chunk;
+
+    for(i = 0; i < stack->size / sizeof(uint32_t); ++i)
+    {
+        stack->base[i] = STACK_POOL_FILL;
+    }
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E stack_pool_free(kernel_stack_t* stack)
+{
+    stack_chunk_t* chunk;
+    uint32_t       slot_size;
+    uint32_t       count;
+    uint32_t       slot;
+
+    if(stack == NULL || stack->base == NULL || stack->chunk == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    chunk = stack->chunk;
+    stack_pool_geometry(chunk->class_id, &slot_size, &count);
+    slot = ((uint8_t*)stack->base - KERNEL_PAGE_SIZE - chunk->slots) /
+           slot_size;
+
+    spinlock_lock(&pool_lock);
+
+    if(slot >= chunk->count || (chunk->free_mask & (1U << slot)) != 0)
+    {
+        spinlock_unlock(&pool_lock);
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    chunk->free_mask |= 1U << slot;
+
+    stack->base  = NULL;
+    stack->size  = 0;
+    stack->chunk = NULL;
+
+    if(chunk->free_mask == (1U << chunk->count) - 1)
+    {
+        /* Keep a few empty chunks, release the others to the heap */
+        if(class_empty[chunk->class_id] >= STACK_POOL_MAX_EMPTY)
+        {
+            stack_chunk_remove(chunk);
+            spinlock_unlock(&pool_lock);
+
+            stack_chunk_destroy(chunk, chunk->count);
+            return OS_NO_ERR;
+        }
+
+        ++class_empty[chunk->class_id];
+    }
+
+    spinlock_unlock(&pool_lock);
+
+    return OS_NO_ERR;
+}
+
+uint32_t stack_pool_high_water(const kernel_stack_t* stack)
+{
+    uint32_t i;
+
+    if(stack == NULL || stack->base == NULL)
+    {
+        return 0;
+    }
+
+    /* The stack grows down, the unused words are at its base */
+    for(i = 0; i < stack->size / sizeof(uint32_t); ++i)
+    {
+        if(stack->base[i] != STACK_POOL_FILL)
+        {
+            break;
+        }
+    }
+
+    return stack->size - i * sizeof(uint32_t);
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ *
+ * File: stack_pool.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel threads stacks pool. Stacks are carved in page aligned chunks
+ * allocated on the kernel heap, each stack lies right above an unmapped guard
+ * page so an overflow faults instead of corrupting the memory below. Stacks
+ * sizes are rounded up to a power of two number of pages, freed stacks are
+ * reused.
+ ******************************************************************************/
+
+#ifndef __STACK_POOL_H_
+#define __STACK_POOL_H_
+
+#include "../lib/stdint.h" /* Generic int types */
+#include "../lib/stddef.h" /* OS_RETURN_E */
+#include "paging.h"        /* KERNEL_PAGE_SIZE */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Stacks size classes: 1, 2, 4, 8 and 16 pages */
+#define STACK_POOL_CLASSES     5
+#define STACK_POOL_MIN_SIZE    KERNEL_PAGE_SIZE
+#define STACK_POOL_MAX_SIZE    (KERNEL_PAGE_SIZE << (STACK_POOL_CLASSES - 1))
+
+/* Minimal number of pages of a chunk, guard pages included */
+#define STACK_POOL_CHUNK_PAGES 18
+
+/* Number of empty chunks a class keeps before releasing them to the heap */
+#define STACK_POOL_MAX_EMPTY   1
+
+/* Value filling the allocated stacks, the words still holding it were never
+ * used
+ */
+#define STACK_POOL_FILL        0x57AC57AC
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+struct stack_chunk;
+
+/* Thread stack, the guard page is right below the stack base */
+typedef struct kernel_stack
+{
+    uint32_t*           base;  /* Lowest address of the stack */
+    uint32_t            size;  /* Size of the stack in bytes */
+
+    struct stack_chunk* chunk; /* Chunk the stack is carved in */
+} kernel_stack_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Allocate a stack from the pool. The size is rounded up to the size of its
+ * class and the stack is filled with STACK_POOL_FILL.
+ *
+ * @param size The minimal size of the stack in bytes, at most
+ * STACK_POOL_MAX_SIZE.
+ * @param stack The buffer receiving the stack.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E stack_pool_alloc(const uint32_t size, kernel_stack_t* stack);
+
+/* Give a stack back to the pool. The stack must not be in use anymore.
+ *
+ * @param stack The stack to release.
+ * @returns OS_NO_ERR on success, error code otherwise.
+ */
+OS_RETURN_E stack_pool_free(kernel_stack_t* stack);
+
+/* Returns the high water mark of a stack: the number of bytes from the top of
+ * the stack to its deepest used word.
+ *
+ * @param stack The stack to measure.
+ * @returns The maximal stack usage in bytes.
+ */
+uint32_t stack_pool_high_water(const kernel_stack_t* stack);
+
+#endif /* __STACK_POOL_H_ */
@@ -0,0 +1,366 @@
+/*******************************************************************************
+ *
+ * File: futex.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Address keyed wait queues. Threads wait on the address of a 32 bits word
+ * while it holds an expected value, the waiters are stored in a hash table
+ * shared by all the words. Fast synchronization primitives built on the futexes
+ * complete their uncontended operations with a single atomic instruction and
+ * only reach the wait queues under contention.
+ ******************************************************************************/
+
+#include "../lib/stddef.h"         /* OS_RETURN_E */
+#include "../lib/stdint.h"         /* Generic int types */
+#include "../cpu/cpu.h"            /* cpu_exchange, cpu_compare_and_swap */
+#include "../core/kernel_list.h"   /* kernel_list_t, kernel_list_node_t */
+#include "../core/kernel_output.h" /* kernel_error */
+#include "../core/panic.h"         /* kernel_panic */
+#include "../core/scheduler.h"     /* lock_thread, unlock_thread, schedule,
+                                    set_last_error */
+#include "../core/kernel_thread.h" /* kernel_thread_t */
+#include "lock.h"                  /* lock_t */
+
+#include "../debug.h"              /* kernel_serial_debug */
+
+/* Header file */
+#include "futex.h"
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Wait queue of the hash table, the threads waiting on all the words hashed
+ * to the queue are stored in waiting order, the oldest at the tail.
+ */
+typedef struct futex_queue
+{
+    kernel_list_t waiting_threads;
+    lock_t        lock;
+} futex_queue_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ******************************************************************************/
+
+/* Futexes wait queues */
+static futex_queue_t futex_queues[FUTEX_HASH_SIZE] = {
+    [0 ... FUTEX_HASH_SIZE - 1] = {{NULL, NULL, 0}, {0, 0, -1}}
+};
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Returns the wait queue of the futex word given as parameter.
+ *
+ * @param addr The address of the futex word.
+ * @returns The wait queue of the word.
+ */
+__inline__ static futex_queue_t* futex_queue(volatile uint32_t* addr)
+{
+    /* Multiplicative hash of the word index */
+    return &futex_queues[(((uint32_t)addr >> 2) * 0x9E3779B1) >>
+                         (32 - FUTEX_HASH_BITS)];
+}
+
+/* Report the error of a fast synchronization primitive to the current thread,
+ * see get_last_error.
+ *
+ * @param err The error returned by the primitive.
+ * @returns The error given as parameter.
+ */
+__inline__ static OS_RETURN_E futex_report(const OS_RETURN_E err)
+{
+    set_last_error(err);
+
+    return err;
+}
+
+OS_RETURN_E futex_wait(volatile uint32_t* addr, const uint32_t expected)
+{
+    OS_RETURN_E         err;
+    futex_queue_t*      queue;
+    kernel_list_node_t* active_thread;
+
+    if(addr == NULL)
+    {
+        return OS_ERR_NULL_POINTER;
+    }
+
+    queue = futex_queue(addr);
+
+    spinlock_lock(&queue->lock);
+
+    /* A waker changes the word before taking the queue lock */
+    if(*addr != expected)
+    {
+        spinlock_unlock(&queue->lock);
+        return OS_NO_ERR;
+    }
+
+    active_thread = lock_thread(FUTEX);
+    if(active_thread == NULL)
+    {
+        spinlock_unlock(&queue->lock);
+        return OS_ERR_UNAUTHORIZED_ACTION;
+    }
+
+    ((kernel_thread_t*)active_thread->data)->futex_addr = addr;
+
+    err = kernel_list_enlist_data(active_thread, &queue->waiting_threads, 0);
+    if(err != OS_NO_ERR)
+    {
+        kernel_error("Could not enqueue thread to futex[%d]\n", err);
+        kernel_panic();
+    }
+
+    #ifdef DEBUG_FUTEX
+    kernel_serial_debug("Futex 0x%08x locked thread %d\n",
+                        (uint32_t)addr,
+                        ((kernel_thread_t*)active_thread->data)->pid);
+    #endif
+
+    spinlock_unlock(&queue->lock);
+    schedule();
+
+    return OS_NO_ERR;
+}
+
+uint32_t futex_wake(volatile uint32_t* addr, const uint32_t count)
+{
+    OS_RETURN_E         err;
+    futex_queue_t*      queue;
+    kernel_list_node_t* node;
+    kernel_list_node_t* prev;
+    kernel_thread_t*    thread;
+    uint32_t            woken;
+
+    if(addr == NULL)
+    {
+        return 0;
+    }
+
+    queue = futex_queue(addr);
+    woken = 0;
+
+    spinlock_lock(&queue->lock);
+
+    /* Walk the queue from the oldest waiter, skip the other words */
+    node = queue->waiting_threads.tail;
+    while(node != NULL && woken < count)
+    {
+        prev   = node->prev;
+        thread = (kernel_thread_t*)node->data;
+
+        if(thread->futex_addr == addr)
+        {
+            err = kernel_list_unlink_node(&queue->waiting_threads, node);
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not dequeue thread from futex[%d]\n",
+                             err);
+                kernel_panic();
+            }
+
+            thread->futex_addr = NULL;
+
+            err = unlock_thread(node, FUTEX, 0);
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not unlock thread from futex[%d]\n", err);
+                kernel_panic();
+            }
+
+            #ifdef DEBUG_FUTEX
+            kernel_serial_debug("Futex 0x%08x unlocked thread %d\n",
+                                (uint32_t)addr, thread->pid);
+            #endif
+
+            ++woken;
+        }
+
+        node = prev;
+    }
+
+    spinlock_unlock(&queue->lock);
+
+    return woken;
+}
+
+OS_RETURN_E fmutex_init(fmutex_t* mutex)
+{
+    if(mutex == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    mutex->state = FMUTEX_UNLOCKED;
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E fmutex_lock(fmutex_t* mutex)
+{
+    OS_RETURN_E err;
+
+    if(mutex == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    /* Uncontended path */
+    if(cpu_compare_and_swap(&mutex->state, FMUTEX_UNLOCKED,
+                            FMUTEX_LOCKED) == 0)
+    {
+        return OS_NO_ERR;
+    }
+
+    /* Mark the mutex contended so the owner wakes a waiter up when it unlocks
+     * the mutex. The thread spins if it cannot block (IDLE thread).
+     */
+    while(cpu_exchange(&mutex->state, FMUTEX_CONTENDED) != FMUTEX_UNLOCKED)
+    {
+        err = futex_wait(&mutex->state, FMUTEX_CONTENDED);
+        if(err != OS_NO_ERR && err != OS_ERR_UNAUTHORIZED_ACTION)
+        {
+            return futex_report(err);
+        }
+    }
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E fmutex_try_lock(fmutex_t* mutex)
+{
+    if(mutex == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    if(cpu_compare_and_swap(&mutex->state, FMUTEX_UNLOCKED,
+                            FMUTEX_LOCKED) != 0)
+    {
+        return futex_report(OS_MUTEX_LOCKED);
+    }
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E fmutex_unlock(fmutex_t* mutex)
+{
+    uint32_t state;
+
+    if(mutex == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    state = cpu_exchange(&mutex->state, FMUTEX_UNLOCKED);
+    if(state == FMUTEX_UNLOCKED)
+    {
+        return futex_report(OS_ERR_UNAUTHORIZED_ACTION);
+    }
+
+    /* Threads may only wait on a contended mutex */
+    if(state == FMUTEX_CONTENDED)
+    {
+        futex_wake(&mutex->state, 1);
+    }
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E fsem_init(fsem_t* sem, const uint32_t init_level)
+{
+    if(sem == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    sem->level   = init_level;
+    sem->waiters = 0;
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E fsem_pend(fsem_t* sem)
+{
+    OS_RETURN_E err;
+    uint32_t    level;
+
+    if(sem == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    while(1)
+    {
+        /* Uncontended path */
+        level = sem->level;
+        if(level != 0)
+        {
+            if(cpu_compare_and_swap(&sem->level, level, level - 1) == 0)
+            {
+                return OS_NO_ERR;
+            }
+            continue;
+        }
+
+        /* The waiters count is raised before the level is checked again by
+         * futex_wait, a post raising the level sees the waiter.
+         */
+        cpu_fetch_add(&sem->waiters, 1);
+        err = futex_wait(&sem->level, 0);
+        cpu_fetch_add(&sem->waiters, -1);
+
+        if(err != OS_NO_ERR && err != OS_ERR_UNAUTHORIZED_ACTION)
+        {
+            return futex_report(err);
+        }
+    }
+}
+
+OS_RETURN_E fsem_try_pend(fsem_t* sem)
+{
+    uint32_t level;
+
+    if(sem == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    do
+    {
+        level = sem->level;
+        if(level == 0)
+        {
+            return futex_report(OS_SEM_LOCKED);
+        }
+    } while(cpu_compare_and_swap(&sem->level, level, level - 1) != 0);
+
+    return OS_NO_ERR;
+}
+
+OS_RETURN_E fsem_post(fsem_t* sem)
+{
+    if(sem == NULL)
+    {
+        return futex_report(OS_ERR_NULL_POINTER);
+    }
+
+    cpu_fetch_add(&sem->level, 1);
+
+    /* Uncontended path */
+    if(sem->waiters != 0)
+    {
+        futex_wake(&sem->level, 1);
+    }
+
+    return OS_NO_ERR;
+}
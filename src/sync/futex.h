@@ -0,0 +1,147 @@
+/*******************************************************************************
+ *
+ * File: futex.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Address keyed wait queues. Threads wait on the address of a 32 bits word
+ * while it holds an expected value, the waiters are stored in a hash table
+ * shared by all the words. Fast synchronization primitives built on the futexes
+ * complete their uncontended operations with a single atomic instruction and
+ * only reach the wait queues under contention. Their errors are also reported
+ * to the calling thread, see get_last_error.
+ ******************************************************************************/
+
+#ifndef __FUTEX_H_
+#define __FUTEX_H_
+
+#include "../lib/stddef.h" /* OS_RETURN_E */
+#include "../lib/stdint.h" /* Generic int types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Number of wait queues of the hash table, must be a power of two */
+#define FUTEX_HASH_BITS 6
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+/* Fast mutex states */
+#define FMUTEX_UNLOCKED  0
+#define FMUTEX_LOCKED    1
+#define FMUTEX_CONTENDED 2
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Fast mutex, the state is the futex word */
+typedef struct fmutex
+{
+    volatile uint32_t state;
+} fmutex_t;
+
+/* Fast semaphore, the level is the futex word. Waiters counts the threads
+ * which may be waiting on the level.
+ */
+typedef struct fsem
+{
+    volatile uint32_t level;
+    volatile uint32_t waiters;
+} fsem_t;
+
+/* Static initializers */
+#define FMUTEX_INIT        {FMUTEX_UNLOCKED}
+#define FSEM_INIT(level)   {(level), 0}
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Block the current thread on the address given as parameter if the word it
+ * points to holds the expected value. The value is checked atomically with
+ * the enqueue, a wake up between the check of the caller and the call is not
+ * lost. The function also returns at once if the value changed, the caller must
+ * check its condition again.
+ *
+ * @param addr The address of the futex word.
+ * @param expected The value the word must hold for the thread to wait.
+ * @returns OS_NO_ERR on success, OS_ERR_UNAUTHORIZED_ACTION if the current
+ * thread cannot block, otherwise an error is returned.
+ */
+OS_RETURN_E futex_wait(volatile uint32_t* addr, const uint32_t expected);
+
+/* Wake up the threads waiting on the address given as parameter, in their
+ * waiting order.
+ *
+ * @param addr The address of the futex word.
+ * @param count The maximal number of threads to wake up.
+ * @returns The number of threads woken up.
+ */
+uint32_t futex_wake(volatile uint32_t* addr, const uint32_t count);
+
+/* Initialize a fast mutex, the mutex is unlocked. A fast mutex is neither
+ * recursive nor priority inheriting.
+ *
+ * @param mutex The mutex to initialize.
+ * @returns OS_NO_ERR on success, otherwise an error is returned.
+ */
+OS_RETURN_E fmutex_init(fmutex_t* mutex);
+
+/* Lock a fast mutex. The thread blocks while the mutex is locked.
+ *
+ * @param mutex The mutex to lock.
+ * @returns OS_NO_ERR on success, otherwise an error is returned.
+ */
+OS_RETURN_E fmutex_lock(fmutex_t* mutex);
+
+/* Try to lock a fast mutex without blocking.
+ *
+ * @param mutex The mutex to lock.
+ * @returns OS_NO_ERR on success, OS_MUTEX_LOCKED if the mutex is locked,
+ * otherwise an error is returned.
+ */
+OS_RETURN_E fmutex_try_lock(fmutex_t* mutex);
+
+/* Unlock a fast mutex and wake up a waiting thread if any.
+ *
+ * @param mutex The mutex to unlock.
+ * @returns OS_NO_ERR on success, otherwise an error is returned.
+ */
+OS_RETURN_E fmutex_unlock(fmutex_t* mutex);
+
+/* Initialize a fast semaphore.
+ *
+ * @param sem The semaphore to initialize.
+ * @param init_level The initial level of the semaphore.
+ * @returns OS_NO_ERR on success, otherwise an error is returned.
+ */
+OS_RETURN_E fsem_init(fsem_t* sem, const uint32_t init_level);
+
+/* Pend a fast semaphore. The thread blocks while the level is 0.
+ *
+ * @param sem The semaphore to pend.
+ * @returns OS_NO_ERR on success, otherwise an error is returned.
+ */
+OS_RETURN_E fsem_pend(fsem_t* sem);
+
+/* Try to pend a fast semaphore without blocking.
+ *
+ * @param sem The semaphore to pend.
+ * @returns OS_NO_ERR on success, OS_SEM_LOCKED if the level is 0, otherwise
+ * an error is returned.
+ */
+OS_RETURN_E fsem_try_pend(fsem_t* sem);
+
+/* Post a fast semaphore and wake up a waiting thread if any.
+ *
+ * @param sem The semaphore to post.
+ * @returns OS_NO_ERR on success, otherwise an error is returned.
+ */
+OS_RETURN_E fsem_post(fsem_t* sem);
+
+#endif /* __FUTEX_H_ */
@@ -15,6 +15,7 @@
 #include "../lib/stdint.h"      /* Generic int types */
 #include "../lib/stddef.h"      /* OS_RETURN_E */
 #include "../core/interrupts.h" /* enable_local_interrupt, disable_local_interrupt */
+#include "../cpu/smp.h"         /* get_cpu_id */
 
 /* Header file */
 #include "lock.h"
@@ -37,7 +38,13 @@ OS_RETURN_E spinlock_lock(lock_t* lock)
 #ifdef KERNEL_MONOCORE_SYNC
     disable_local_interrupt();
 #else
-    if(lock->pid == get_pid())
+    uint32_t cpu_id;
+
+    /* The owner cannot be preempted while holding the lock */
+    disable_local_interrupt();
+
+    cpu_id = get_cpu_id();
+    if(lock->cpu_id == (int32_t)cpu_id)
     {
         if(lock->nest_level < UINT16_MAX)
         {
@@ -46,8 +53,8 @@ OS_RETURN_E spinlock_lock(lock_t* lock)
         return OS_NO_ERR;
     }
     while(cpu_test_and_set(&lock->lock) == 1);
-    lock->pid = get_pid();
-    lock->nest_level = 0;
+    lock->cpu_id = cpu_id;
+    lock->nest_level = 1;
 #endif
 
     return OS_NO_ERR;
@@ -71,9 +78,11 @@ OS_RETURN_E spinlock_unlock(lock_t* lock)
     else
     {
         lock->nest_level = 0;
-        lock->pid = -1;
+        lock->cpu_id = -1;
         lock->lock = 0;
     }
+
+    enable_local_interrupt();
 #endif
 
     return OS_NO_ERR;
@@ -87,7 +96,7 @@ OS_RETURN_E spinlock_init(lock_t* lock)
     }
 
     lock->nest_level = 0;
-    lock->pid = -1;
+    lock->cpu_id = -1;
     lock->lock = 0;
     return OS_NO_ERR;
 }
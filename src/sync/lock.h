@@ -21,25 +21,27 @@
  * CONSTANTS
  ******************************************************************************/
 
-#define KERNEL_MONOCORE_SYNC
+/* Define to use interrupt masking only (single CPU systems) */
+/* #define KERNEL_MONOCORE_SYNC */
 
 /*******************************************************************************
  * STRUCTURES
  ******************************************************************************/
 
-/* Spinlock can be nested up to UINT16_MAX level */
+/* Spinlock can be nested up to UINT16_MAX level by the CPU owning it */
 typedef volatile struct lock
 {
-    volatile uint16_t lock;
+    volatile uint32_t lock;
     volatile uint16_t nest_level;
-    volatile int32_t  pid;
+    volatile int32_t  cpu_id;
 } lock_t;
 
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
 
-/* Lock the lock given as parameter
+/* Lock the lock given as parameter. Local interrupts are disabled while the
+ * lock is held.
  *
  * @param The lock to lock.
  */
@@ -18,6 +18,8 @@
 #include "../core/kernel_output.h" /* kernel_error */
 #include "../core/panic.h"         /* kernel_panic */
 #include "../core/scheduler.h"     /* lock_thread, unlock_thread */
+#include "../core/kernel_thread.h" /* kernel_thread_t */
+#include "../cpu/cpu.h"            /* cpu_pause */
 #include "lock.h"                  /* lock_t */
 
 #include "../debug.h"            /* DEBUG */
@@ -29,10 +31,201 @@
  * GLOBAL VARIABLES
  ******************************************************************************/
 
+/* Priority inheritance lock, protects the mutexes owners, the threads held and
+ * blocking mutexes and the waiting lists of the priority inheritance mutexes.
+ * Lock order is mutex lock, then pi_lock.
+ */
+static lock_t pi_lock = {0, 0, -1};
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
 
+/* Returns the priority of the most prioritary thread waiting for a priority
+ * inheritance mutex. pi_lock must be held.
+ *
+ * @param mutex The mutex to get the waiting threads priority of.
+ * @returns The priority of the most prioritary waiting thread,
+ * KERNEL_LOWEST_PRIORITY if no thread is waiting.
+ */
+static uint32_t mutex_pi_top_priority(const mutex_t* mutex)
+{
+    /* Waiting threads are sorted, the tail is the most prioritary */
+    if(mutex->waiting_threads->tail == NULL)
+    {
+        return KERNEL_LOWEST_PRIORITY;
+    }
+
+    return mutex->waiting_threads->tail->priority;
+}
+
+/* Raise the priority of the owner of a priority inheritance mutex and of the
+ * owners of the mutexes it is waiting for. pi_lock must be held.
+ *
+ * @param mutex The mutex which owner inherits the priority.
+ * @param priority The priority to inherit.
+ */
+static void mutex_pi_boost(mutex_t* mutex, const uint32_t priority)
+{
+    OS_RETURN_E      err;
+    kernel_thread_t* owner;
+    uint32_t         depth;
+
+    for(depth = 0; depth < MUTEX_PI_MAX_CHAIN && mutex != NULL; ++depth)
+    {
+        owner = mutex->owner;
+        if(owner == NULL || owner->inherited_prio <= priority)
+        {
+            break;
+        }
+
+        err = set_thread_inherited_priority(owner, priority);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not boost mutex owner priority[%d]\n", err);
+            kernel_panic();
+        }
+
+        #ifdef DEBUG_MUTEX
+        kernel_serial_debug("Mutex 0x%08x owner %d inherited priority %d\n",
+                            (uint32_t)mutex, owner->pid, priority);
+        #endif
+
+        /* The owner waits for an other mutex, it changes of place in its
+         * waiting list and the boost goes on with this mutex owner.
+         */
+        mutex = owner->blocked_mutex;
+        if(mutex != NULL)
+        {
+            err = kernel_list_unlink_node(mutex->waiting_threads,
+                                          owner->sched_node);
+            if(err == OS_NO_ERR)
+            {
+                err = kernel_list_enlist_data(owner->sched_node,
+                                              mutex->waiting_threads,
+                                              owner->priority);
+            }
+            if(err != OS_NO_ERR)
+            {
+                kernel_error("Could not requeue mutex waiting thread[%d]\n",
+                             err);
+                kernel_panic();
+            }
+        }
+    }
+}
+
+/* Set the owner of a priority inheritance mutex. The owner inherits the
+ * priority of the threads already waiting for the mutex. pi_lock must be held.
+ *
+ * @param mutex The mutex acquired.
+ * @param owner The thread that acquired the mutex.
+ */
+static void mutex_pi_acquire(mutex_t* mutex, kernel_thread_t* owner)
+{
+    mutex->owner        = owner;
+    mutex->next_held    = owner->held_mutexes;
+    owner->held_mutexes = mutex;
+
+    mutex_pi_boost(mutex, mutex_pi_top_priority(mutex));
+}
+
+/* Release a priority inheritance mutex from its owner. The owner priority is
+ * restored to the priority inherited from the mutexes it still holds. pi_lock
+ * must be held.
+ *
+ * @param mutex The mutex released.
+ */
+static void mutex_pi_release(mutex_t* mutex)
+{
+    OS_RETURN_E      err;
+    kernel_thread_t* owner;
+    mutex_t**        cursor;
+    mutex_t*         held;
+    uint32_t         priority;
+    uint32_t         top;
+
+    owner = mutex->owner;
+    if(owner == NULL)
+    {
+        return;
+    }
+
+    cursor = &owner->held_mutexes;
+    while(*cursor != NULL && *cursor != mutex)
+    {
+        cursor = &(*cursor)->next_held;
+    }
+    if(*cursor != NULL)
+    {
+        *cursor = mutex->next_held;
+    }
+    mutex->next_held = NULL;
+    mutex->owner     = NULL;
+
+    priority = KERNEL_LOWEST_PRIORITY;
+    for(held = owner->held_mutexes; held != NULL; held = held->next_held)
+    {
+        top = mutex_pi_top_priority(held);
+        if(top < priority)
+        {
+            priority = top;
+        }
+    }
+
+    if(priority != owner->inherited_prio)
+    {
+        err = set_thread_inherited_priority(owner, priority);
+        if(err != OS_NO_ERR)
+        {
+            kernel_error("Could not restore mutex owner priority[%d]\n", err);
+            kernel_panic();
+        }
+    }
+}
+
+/* Spin while the owner of an adaptive mutex is executed by an other CPU, it is
+ * likely to release the mutex soon. The mutex lock must be held, it is
+ * released while spinning.
+ *
+ * @param mutex The adaptive mutex to spin on.
+ * @returns 1 if the mutex was released or changed of owner, 0 if the thread
+ * should block.
+ */
+static uint8_t mutex_adaptive_spin(mutex_t* mutex)
+{
+    kernel_thread_t* owner;
+    uint32_t         i;
+
+    owner = mutex->owner;
+    if(owner == NULL || is_thread_running(owner) == 0)
+    {
+        return 0;
+    }
+
+    spinlock_unlock(&mutex->lock);
+
+    /* The owner is only compared to the CPUs threads, it is never accessed */
+    for(i = 0; i < MUTEX_ADAPTIVE_SPIN_MAX; ++i)
+    {
+        if(mutex->state == 1 || mutex->owner != owner ||
+           is_thread_running(owner) == 0)
+        {
+            break;
+        }
+        cpu_pause();
+    }
+
+    spinlock_lock(&mutex->lock);
+
+    #ifdef DEBUG_MUTEX
+    kernel_serial_debug("Mutex 0x%08x thread %d spun %d times\n",
+                        (uint32_t)mutex, get_pid(), i);
+    #endif
+
+    return (mutex->state == 1 || mutex->owner != owner) ? 1 : 0;
+}
+
 OS_RETURN_E mutex_init(mutex_t* mutex, const uint32_t flags)
 {
     OS_RETURN_E err;
@@ -84,6 +277,12 @@ OS_RETURN_E mutex_destroy(mutex_t* mutex)
         return OS_ERR_MUTEX_UNINITIALIZED;
     }
 
+    if((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0)
+    {
+        spinlock_lock(&pi_lock);
+        mutex_pi_release(mutex);
+    }
+
     /* Unlock all thread*/
     while((node = kernel_list_delist_data(mutex->waiting_threads, &err))
         != NULL)
@@ -94,6 +293,8 @@ OS_RETURN_E mutex_destroy(mutex_t* mutex)
             kernel_panic();
         }
 
+        ((kernel_thread_t*)node->data)->blocked_mutex = NULL;
+
         err = unlock_thread(node, MUTEX, 0);
         if(err != OS_NO_ERR)
         {
@@ -113,6 +314,10 @@ OS_RETURN_E mutex_destroy(mutex_t* mutex)
         kernel_panic();
     }
 
+    if((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0)
+    {
+        spinlock_unlock(&pi_lock);
+    }
 
     err = kernel_list_delete_list(&mutex->waiting_threads);
     mutex->init = 0;
@@ -130,6 +335,7 @@ OS_RETURN_E mutex_pend(mutex_t* mutex)
 {
     OS_RETURN_E         err;
     kernel_list_node_t* active_thread;
+    kernel_thread_t*    current;
 
     /* Check if mutex is initialized */
     if(mutex == NULL)
@@ -161,6 +367,13 @@ OS_RETURN_E mutex_pend(mutex_t* mutex)
             break;
         }
 
+        /* The owner may release the mutex before we could block */
+        if((mutex->flags & MUTEX_FLAG_ADAPTIVE) != 0 &&
+           mutex_adaptive_spin(mutex) == 1)
+        {
+            continue;
+        }
+
         active_thread = lock_thread(MUTEX);
         if(active_thread == NULL)
         {
@@ -169,8 +382,27 @@ OS_RETURN_E mutex_pend(mutex_t* mutex)
             kernel_panic();
         }
 
-        err = kernel_list_enlist_data(active_thread,
-                                      mutex->waiting_threads, 0);
+        if((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0)
+        {
+            /* Wait by priority and give the priority to the owner */
+            current = (kernel_thread_t*)active_thread->data;
+
+            spinlock_lock(&pi_lock);
+            err = kernel_list_enlist_data(active_thread,
+                                          mutex->waiting_threads,
+                                          current->priority);
+            if(err == OS_NO_ERR)
+            {
+                current->blocked_mutex = mutex;
+                mutex_pi_boost(mutex, current->priority);
+            }
+            spinlock_unlock(&pi_lock);
+        }
+        else
+        {
+            err = kernel_list_enlist_data(active_thread,
+                                          mutex->waiting_threads, 0);
+        }
         if(err != OS_NO_ERR)
         {
             kernel_error("Could not enqueue thread to mutex[%d]\n", err);
@@ -200,6 +432,19 @@ OS_RETURN_E mutex_pend(mutex_t* mutex)
 
     mutex->locker_pid = get_pid();
 
+    current = get_current_thread();
+    if((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0 &&
+       mutex->owner != current)
+    {
+        spinlock_lock(&pi_lock);
+        mutex_pi_acquire(mutex, current);
+        spinlock_unlock(&pi_lock);
+    }
+    else if((mutex->flags & MUTEX_FLAG_ADAPTIVE) != 0)
+    {
+        mutex->owner = current;
+    }
+
     #ifdef DEBUG_MUTEX
     kernel_serial_debug("Mutex 0x%08x aquired by thead %d\n",
                         (uint32_t)mutex,
@@ -234,8 +479,28 @@ OS_RETURN_E mutex_post(mutex_t* mutex)
     /* Increment mutex level */
     mutex->state = 1;
 
+    /* The owner gets back its priority, the most prioritary waiting thread is
+     * woken up.
+     */
+    if((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0)
+    {
+        spinlock_lock(&pi_lock);
+        mutex_pi_release(mutex);
+        node = kernel_list_delist_data(mutex->waiting_threads, &err);
+        if(node != NULL)
+        {
+            ((kernel_thread_t*)node->data)->blocked_mutex = NULL;
+        }
+        spinlock_unlock(&pi_lock);
+    }
+    else
+    {
+        mutex->owner = NULL;
+        node = kernel_list_delist_data(mutex->waiting_threads, &err);
+    }
+
     /* Check if we can unlock a blocked thread on the mutex */
-    if((node = kernel_list_delist_data(mutex->waiting_threads, &err)) != NULL)
+    if(node != NULL)
     {
         if(err != OS_NO_ERR)
         {
@@ -321,7 +586,19 @@ OS_RETURN_E mutex_try_pend(mutex_t* mutex, int8_t* value)
     }
     else if(mutex != NULL &&mutex->init == 1)
     {
-        mutex->state = 0;
+        mutex->state      = 0;
+        mutex->locker_pid = get_pid();
+
+        if((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0)
+        {
+            spinlock_lock(&pi_lock);
+            mutex_pi_acquire(mutex, get_current_thread());
+            spinlock_unlock(&pi_lock);
+        }
+        else if((mutex->flags & MUTEX_FLAG_ADAPTIVE) != 0)
+        {
+            mutex->owner = get_current_thread();
+        }
     }
     else
     {
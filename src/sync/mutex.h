@@ -23,8 +23,19 @@
  * CONSTANTS
  ******************************************************************************/
 
-#define MUTEX_FLAG_NONE      0x00000000
-#define MUTEX_FLAG_RECURSIVE 0x00000001
+#define MUTEX_FLAG_NONE         0x00000000
+#define MUTEX_FLAG_RECURSIVE    0x00000001
+#define MUTEX_FLAG_PRIO_INHERIT 0x00000002
+#define MUTEX_FLAG_ADAPTIVE     0x00000004
+
+/* Maximal number of checks of an adaptive mutex state before blocking */
+#define MUTEX_ADAPTIVE_SPIN_MAX 4096
+
+/* Maximal length of the mutexes chains walked by the priority inheritance */
+#define MUTEX_PI_MAX_CHAIN      16
+
+/* Forward declaration */
+struct kernel_thread;
 
 /*******************************************************************************
  * STRUCTURES
@@ -36,6 +47,7 @@ typedef struct mutex
      * THREAD TABLE
      * Sorted by priority:
      *     - FIFO
+     *     - By thread priority with MUTEX_FLAG_PRIO_INHERIT
      *******************************************************/
     kernel_list_t* waiting_threads;
 
@@ -44,12 +56,20 @@ typedef struct mutex
 
     /* FLAGS
      *     [0] = RECURSIVE
+     *     [1] = PRIO_INHERIT
+     *     [2] = ADAPTIVE
      */
     uint32_t flags;
 
     /* PID of the thread that acquired the lock */
     int32_t locker_pid;
 
+    /* Priority inheritance and adaptive: thread that acquired the lock. Next
+     * mutex held by this thread (priority inheritance only).
+     */
+    struct kernel_thread* owner;
+    struct mutex*         next_held;
+
     /* Spinlock to ensure atomic access to the mutex */
     lock_t lock;
 
@@ -62,7 +82,13 @@ typedef struct mutex
  ******************************************************************************/
 
 /* Initialize the mutex structure.
- * The initial state of a mutex is unlocked.
+ * The initial state of a mutex is unlocked. With MUTEX_FLAG_PRIO_INHERIT, the
+ * thread holding the mutex inherits the priority of the most prioritary
+ * waiting thread, along the chains of nested mutexes, and the waiting threads
+ * are woken up by priority. With MUTEX_FLAG_ADAPTIVE, a thread pending the
+ * mutex spins while the owner is executed by an other CPU and only blocks if
+ * the owner leaves its CPU or the mutex is not released after
+ * MUTEX_ADAPTIVE_SPIN_MAX checks.
  *
  * @param mutex The pointer to the mutex to initialize.
  * @param flags Mutex flags, see defines to get all the possible mutex flags.
@@ -0,0 +1,200 @@
+/*******************************************************************************
+ *
+ * File: test_fpu.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: FPU lazy context switch tests. The tests create threads,
+ * they are executed by the INIT thread once the scheduler is started.
+ ******************************************************************************/
+
+#include "../../cpu/cpu.h"
+#include "../../cpu/fpu.h"
+#include "../../core/scheduler.h"
+#include "../../core/kernel_thread.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../lib/stddef.h"
+#include "../../lib/stdint.h"
+
+/* Number of times each thread gives the CPU to the others */
+#define TEST_FPU_YIELDS 100
+
+/* Number of threads, the last one never uses the FPU */
+#define TEST_FPU_THREADS 3
+
+/* Priority of the test threads */
+#define TEST_FPU_PRIO 20
+
+/* Time given to the threads to be created before they start, in ms */
+#define TEST_FPU_START 10
+
+static volatile uint32_t fpu_start;
+static volatile uint32_t fpu_last;
+static volatile uint32_t fpu_interleaved;
+
+/* Records which thread executes, counts the switches between the threads.
+ *
+ * @param id The id of the thread.
+ */
+static void test_fpu_turn(const uint32_t id)
+{
+    if(fpu_last != id)
+    {
+        ++fpu_interleaved;
+    }
+    fpu_last = id;
+}
+
+/* Loads distinct SSE and x87 values and checks they survive the switches */
+static void* test_fpu_routine(void* args)
+{
+    uint32_t         id = (uint32_t)args;
+    uint32_t         xmm_in[4] __attribute__((aligned(16)));
+    uint32_t         xmm_out[4] __attribute__((aligned(16)));
+    int32_t          x87_in;
+    int32_t          x87_out;
+    uint32_t         i;
+    uint32_t         j;
+    kernel_thread_t* current;
+
+    while(fpu_start == 0)
+    {
+        sleep(1);
+    }
+
+    for(j = 0; j < 4; ++j)
+    {
+        xmm_in[j] = 0xF0F00000 | (id << 8) | j;
+    }
+    x87_in = -1000 - (int32_t)id;
+
+    __asm__ __volatile__("movdqa %0, %%xmm0\n\t"
+                         "fildl %1"
+                         : : "m"(xmm_in), "m"(x87_in) : "memory");
+
+    for(i = 0; i < TEST_FPU_YIELDS; ++i)
+    {
+        test_fpu_turn(id);
+        schedule();
+
+        __asm__ __volatile__("movdqa %%xmm0, %0\n\t"
+                             "fistl %1"
+                             : "=m"(xmm_out), "=m"(x87_out) : : "memory");
+
+        for(j = 0; j < 4; ++j)
+        {
+            if(xmm_out[j] != xmm_in[j])
+            {
+                return (void*)1;
+            }
+        }
+        if(x87_out != x87_in)
+        {
+            return (void*)1;
+        }
+    }
+
+    __asm__ __volatile__("fstp %%st(0)" : : : "memory");
+
+    /* The thread state was loaded on CPU 0 */
+    current = get_current_thread();
+    if(current->fpu.cpu_id != 0)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+/* Never uses the FPU, its context is never loaded */
+static void* test_fpu_idle_routine(void* args)
+{
+    uint32_t         id = (uint32_t)args;
+    uint32_t         i;
+    kernel_thread_t* current;
+
+    while(fpu_start == 0)
+    {
+        sleep(1);
+    }
+
+    for(i = 0; i < TEST_FPU_YIELDS; ++i)
+    {
+        test_fpu_turn(id);
+        schedule();
+    }
+
+    /* The context is only set by the #NM handler when it owns the FPU */
+    current = get_current_thread();
+    if(current->fpu.cpu_id != -1 || current->fpu.saved != 0)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+void test_fpu(void)
+{
+    OS_RETURN_E error;
+    thread_t    threads[TEST_FPU_THREADS];
+    void*       ret;
+    uint32_t    regs[4];
+    uint32_t    i;
+
+    /* The FPU is only enabled with FXSAVE and SSE */
+    if(cpuid(CPUID_GETFEATURES, regs) == 0 ||
+       (regs[3] & BIT_FXSAVE) == 0 || (regs[3] & BIT_SSE) == 0)
+    {
+        kernel_debug("FPU tests skipped, no FXSAVE or SSE\n");
+        return;
+    }
+
+    fpu_start       = 0;
+    fpu_last        = TEST_FPU_THREADS;
+    fpu_interleaved = 0;
+
+    /* All the threads share CPU 0 so they take the FPU from each other */
+    for(i = 0; i < TEST_FPU_THREADS; ++i)
+    {
+        error = create_thread_affinity(&threads[i],
+                                       (i + 1 < TEST_FPU_THREADS) ?
+                                       test_fpu_routine :
+                                       test_fpu_idle_routine,
+                                       TEST_FPU_PRIO, "test_fpu", (void*)i,
+                                       THREAD_AFFINITY_CPU(0),
+                                       THREAD_STACK_SIZE);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_FPU 0\n");
+            kernel_panic();
+        }
+    }
+
+    sleep(TEST_FPU_START);
+    fpu_start = 1;
+
+    for(i = 0; i < TEST_FPU_THREADS; ++i)
+    {
+        error = wait_thread(threads[i], &ret);
+        if(error != OS_NO_ERR || ret != NULL)
+        {
+            kernel_error("TEST_FPU %d\n", i + 1);
+            kernel_panic();
+        }
+    }
+
+    /* The threads executed in turns */
+    if(fpu_interleaved < TEST_FPU_YIELDS)
+    {
+        kernel_error("TEST_FPU %d\n", TEST_FPU_THREADS + 1);
+        kernel_panic();
+    }
+
+    kernel_debug("FPU tests passed\n");
+}
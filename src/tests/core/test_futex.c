@@ -0,0 +1,321 @@
+/*******************************************************************************
+ *
+ * File: test_futex.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Futexes and fast synchronization primitives tests. The
+ * uncontended paths are tested before the scheduler is started, the contended
+ * paths create threads and are executed by the INIT thread once the scheduler
+ * is started.
+ ******************************************************************************/
+
+#include "../../sync/futex.h"
+#include "../../core/scheduler.h"
+#include "../../core/kernel_thread.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../lib/stddef.h"
+#include "../../lib/stdint.h"
+
+/* Time given to a thread to block before the test fails, in ms */
+#define TEST_FUTEX_TIMEOUT 2000
+
+/* Priority of the waiting threads */
+#define TEST_FUTEX_PRIO 20
+
+static fmutex_t          contended_mutex;
+static fsem_t            contended_sem;
+static volatile uint32_t hashed_words[FUTEX_HASH_SIZE + 1];
+
+void test_futex(void)
+{
+    OS_RETURN_E       error;
+    volatile uint32_t word;
+    fmutex_t          mutex = FMUTEX_INIT;
+    fsem_t            sem;
+
+    /* A word not holding the expected value does not block */
+    word  = 1;
+    error = futex_wait(&word, 0);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_FUTEX 0\n");
+        kernel_panic();
+    }
+    if(futex_wake(&word, 1) != 0 ||
+       futex_wait(NULL, 0) != OS_ERR_NULL_POINTER)
+    {
+        kernel_error("TEST_FUTEX 1\n");
+        kernel_panic();
+    }
+
+    /* Fast mutex */
+    if(fmutex_lock(&mutex) != OS_NO_ERR || mutex.state != FMUTEX_LOCKED)
+    {
+        kernel_error("TEST_FUTEX 2\n");
+        kernel_panic();
+    }
+    if(fmutex_try_lock(&mutex) != OS_MUTEX_LOCKED)
+    {
+        kernel_error("TEST_FUTEX 3\n");
+        kernel_panic();
+    }
+    if(fmutex_unlock(&mutex) != OS_NO_ERR || mutex.state != FMUTEX_UNLOCKED)
+    {
+        kernel_error("TEST_FUTEX 4\n");
+        kernel_panic();
+    }
+    if(fmutex_unlock(&mutex) != OS_ERR_UNAUTHORIZED_ACTION)
+    {
+        kernel_error("TEST_FUTEX 5\n");
+        kernel_panic();
+    }
+    if(fmutex_try_lock(&mutex) != OS_NO_ERR ||
+       fmutex_unlock(&mutex) != OS_NO_ERR)
+    {
+        kernel_error("TEST_FUTEX 6\n");
+        kernel_panic();
+    }
+
+    /* Fast semaphore */
+    error = fsem_init(&sem, 2);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_FUTEX 7\n");
+        kernel_panic();
+    }
+    if(fsem_pend(&sem) != OS_NO_ERR || fsem_try_pend(&sem) != OS_NO_ERR ||
+       sem.level != 0)
+    {
+        kernel_error("TEST_FUTEX 8\n");
+        kernel_panic();
+    }
+    if(fsem_try_pend(&sem) != OS_SEM_LOCKED)
+    {
+        kernel_error("TEST_FUTEX 9\n");
+        kernel_panic();
+    }
+    if(fsem_post(&sem) != OS_NO_ERR || sem.level != 1 || sem.waiters != 0)
+    {
+        kernel_error("TEST_FUTEX 10\n");
+        kernel_panic();
+    }
+    if(fsem_pend(&sem) != OS_NO_ERR || sem.level != 0)
+    {
+        kernel_error("TEST_FUTEX 11\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Futex tests passed\n");
+}
+
+/* Returns the wait queue index of a futex word, mirrors the futexes hash.
+ *
+ * @param addr The address of the futex word.
+ * @returns The index of the wait queue of the word.
+ */
+static uint32_t test_futex_hash(volatile uint32_t* addr)
+{
+    return (((uint32_t)addr >> 2) * 0x9E3779B1) >> (32 - FUTEX_HASH_BITS);
+}
+
+/* Sleep until a thread waits on a futex word.
+ *
+ * @param thread The thread to wait for.
+ * @param addr The futex word the thread must wait on.
+ * @returns 1 if the thread blocked before TEST_FUTEX_TIMEOUT, 0 otherwise.
+ */
+static uint8_t test_futex_blocked(const thread_t thread,
+                                  volatile uint32_t* addr)
+{
+    uint32_t i;
+
+    for(i = 0; i < TEST_FUTEX_TIMEOUT; ++i)
+    {
+        if(thread->state == BLOCKED && thread->block_type == FUTEX &&
+           thread->futex_addr == addr)
+        {
+            return 1;
+        }
+        sleep(1);
+    }
+
+    return 0;
+}
+
+/* Waits for the contended mutex, the mutex is handed over as contended */
+static void* test_fmutex_routine(void* args)
+{
+    (void)args;
+
+    if(fmutex_lock(&contended_mutex) != OS_NO_ERR ||
+       contended_mutex.state != FMUTEX_CONTENDED)
+    {
+        return (void*)1;
+    }
+
+    if(fmutex_unlock(&contended_mutex) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+/* Waits for a post of the contended semaphore */
+static void* test_fsem_routine(void* args)
+{
+    (void)args;
+
+    if(fsem_pend(&contended_sem) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+/* Waits on the futex word given as parameter once */
+static void* test_futex_routine(void* args)
+{
+    if(futex_wait((volatile uint32_t*)args, 0) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+void test_futex_contended(void)
+{
+    OS_RETURN_E        error;
+    thread_t           threads[2];
+    volatile uint32_t* words[2];
+    void*              ret;
+    uint32_t           i;
+    uint32_t           j;
+
+    /* Fast mutex handoff */
+    if(fmutex_init(&contended_mutex) != OS_NO_ERR ||
+       fmutex_lock(&contended_mutex) != OS_NO_ERR)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 0\n");
+        kernel_panic();
+    }
+    error = create_thread(&threads[0], test_fmutex_routine, TEST_FUTEX_PRIO,
+                          "test_fmutex", NULL);
+    if(error != OS_NO_ERR ||
+       test_futex_blocked(threads[0], &contended_mutex.state) == 0 ||
+       contended_mutex.state != FMUTEX_CONTENDED)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 1\n");
+        kernel_panic();
+    }
+    if(fmutex_unlock(&contended_mutex) != OS_NO_ERR)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 2\n");
+        kernel_panic();
+    }
+    error = wait_thread(threads[0], &ret);
+    if(error != OS_NO_ERR || ret != NULL ||
+       contended_mutex.state != FMUTEX_UNLOCKED)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 3\n");
+        kernel_panic();
+    }
+
+    /* Fast semaphore post waking a waiter */
+    if(fsem_init(&contended_sem, 0) != OS_NO_ERR)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 4\n");
+        kernel_panic();
+    }
+    error = create_thread(&threads[0], test_fsem_routine, TEST_FUTEX_PRIO,
+                          "test_fsem", NULL);
+    if(error != OS_NO_ERR ||
+       test_futex_blocked(threads[0], &contended_sem.level) == 0 ||
+       contended_sem.waiters != 1)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 5\n");
+        kernel_panic();
+    }
+    if(fsem_post(&contended_sem) != OS_NO_ERR)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 6\n");
+        kernel_panic();
+    }
+    error = wait_thread(threads[0], &ret);
+    if(error != OS_NO_ERR || ret != NULL || contended_sem.level != 0 ||
+       contended_sem.waiters != 0)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 7\n");
+        kernel_panic();
+    }
+
+    /* Two of the words share a wait queue, there are more words than queues */
+    words[0] = NULL;
+    words[1] = NULL;
+    for(i = 0; i < FUTEX_HASH_SIZE + 1 && words[0] == NULL; ++i)
+    {
+        for(j = i + 1; j < FUTEX_HASH_SIZE + 1; ++j)
+        {
+            if(test_futex_hash(&hashed_words[i]) ==
+               test_futex_hash(&hashed_words[j]))
+            {
+                words[0] = &hashed_words[i];
+                words[1] = &hashed_words[j];
+                break;
+            }
+        }
+    }
+    if(words[0] == NULL)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 8\n");
+        kernel_panic();
+    }
+
+    for(i = 0; i < 2; ++i)
+    {
+        *words[i] = 0;
+        error = create_thread(&threads[i], test_futex_routine, TEST_FUTEX_PRIO,
+                              "test_futex", (void*)words[i]);
+        if(error != OS_NO_ERR || test_futex_blocked(threads[i], words[i]) == 0)
+        {
+            kernel_error("TEST_FUTEX_CONTENDED 9\n");
+            kernel_panic();
+        }
+    }
+
+    /* Waking the second word skips the older waiter of the first word */
+    if(futex_wake(words[1], FUTEX_HASH_SIZE) != 1)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 10\n");
+        kernel_panic();
+    }
+    error = wait_thread(threads[1], &ret);
+    if(error != OS_NO_ERR || ret != NULL ||
+       test_futex_blocked(threads[0], words[0]) == 0)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 11\n");
+        kernel_panic();
+    }
+
+    if(futex_wake(words[0], FUTEX_HASH_SIZE) != 1)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 12\n");
+        kernel_panic();
+    }
+    error = wait_thread(threads[0], &ret);
+    if(error != OS_NO_ERR || ret != NULL)
+    {
+        kernel_error("TEST_FUTEX_CONTENDED 13\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Futex contended tests passed\n");
+}
@@ -0,0 +1,484 @@
+/*******************************************************************************
+ *
+ * File: test_mutex.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Mutexes tests. The tests create threads, they are
+ * executed by the INIT thread once the scheduler is started.
+ ******************************************************************************/
+
+#include "../../sync/mutex.h"
+#include "../../core/scheduler.h"
+#include "../../core/kernel_thread.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../cpu/cpu.h"
+#include "../../cpu/smp.h"
+#include "../../lib/stddef.h"
+#include "../../lib/stdint.h"
+
+/* Time given to a thread to reach a state before the test fails, in ms */
+#define TEST_MUTEX_TIMEOUT 2000
+
+/* Priorities of the priority inheritance chain threads */
+#define TEST_PI_LOW  50
+#define TEST_PI_MID  40
+#define TEST_PI_HIGH 10
+
+/* Priority of the adaptive mutex threads */
+#define TEST_ADAPTIVE_PRIO 20
+
+/* Pauses the owner of the adaptive mutex waits once the waiter started to
+ * pend, lower than MUTEX_ADAPTIVE_SPIN_MAX so the release happens within the
+ * spin of the waiter.
+ */
+#define TEST_ADAPTIVE_HOLD 256
+
+/* Behaviours of the adaptive mutex owner */
+#define TEST_ADAPTIVE_SLEEP 0
+#define TEST_ADAPTIVE_SPIN  1
+#define TEST_ADAPTIVE_SHORT 2
+
+static mutex_t           pi_mutex_a;
+static mutex_t           pi_mutex_b;
+static volatile uint32_t pi_step;
+static volatile uint32_t pi_release;
+
+static mutex_t           adaptive_mutex;
+static volatile uint32_t adaptive_locked;
+static volatile uint32_t adaptive_release;
+
+/* Sleep until a thread blocks on a mutex.
+ *
+ * @param thread The thread to wait for.
+ * @param mutex The mutex the thread must block on.
+ * @returns 1 if the thread blocked before TEST_MUTEX_TIMEOUT, 0 otherwise.
+ */
+static uint8_t test_wait_blocked(const thread_t thread, const mutex_t* mutex)
+{
+    uint32_t i;
+
+    for(i = 0; i < TEST_MUTEX_TIMEOUT; ++i)
+    {
+        if(thread->blocked_mutex == mutex)
+        {
+            return 1;
+        }
+        sleep(1);
+    }
+
+    return 0;
+}
+
+/* Sleep until a thread inherits a priority, the boost is applied after the
+ * waiting thread blocks.
+ *
+ * @param thread The thread to wait for.
+ * @param priority The priority the thread must inherit.
+ * @returns 1 if the thread inherited the priority before TEST_MUTEX_TIMEOUT,
+ * 0 otherwise.
+ */
+static uint8_t test_wait_inherited(const thread_t thread,
+                                   const uint32_t priority)
+{
+    uint32_t i;
+
+    for(i = 0; i < TEST_MUTEX_TIMEOUT; ++i)
+    {
+        if(thread->inherited_prio == priority)
+        {
+            return 1;
+        }
+        sleep(1);
+    }
+
+    return 0;
+}
+
+/* Holds A until released by the test */
+static void* test_pi_low(void* args)
+{
+    (void)args;
+
+    if(mutex_pend(&pi_mutex_a) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+    pi_step = 1;
+
+    while(pi_release == 0)
+    {
+        sleep(1);
+    }
+
+    if(mutex_post(&pi_mutex_a) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    /* A does not boost the thread anymore */
+    if(get_current_thread()->inherited_prio != KERNEL_LOWEST_PRIORITY)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+/* Holds B and waits for A */
+static void* test_pi_mid(void* args)
+{
+    (void)args;
+
+    if(mutex_pend(&pi_mutex_b) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+    pi_step = 2;
+
+    if(mutex_pend(&pi_mutex_a) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    /* Still boosted by the thread waiting for B */
+    if(get_current_thread()->inherited_prio != TEST_PI_HIGH)
+    {
+        return (void*)1;
+    }
+
+    if(mutex_post(&pi_mutex_a) != OS_NO_ERR ||
+       mutex_post(&pi_mutex_b) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    if(get_current_thread()->inherited_prio != KERNEL_LOWEST_PRIORITY)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+/* Waits for B */
+static void* test_pi_high(void* args)
+{
+    (void)args;
+
+    if(mutex_pend(&pi_mutex_b) != OS_NO_ERR ||
+       mutex_post(&pi_mutex_b) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+void test_mutex_pi(void)
+{
+    OS_RETURN_E error;
+    thread_t    low;
+    thread_t    mid;
+    thread_t    high;
+    void*       ret;
+    uint32_t    i;
+
+    pi_step    = 0;
+    pi_release = 0;
+
+    if(mutex_init(&pi_mutex_a, MUTEX_FLAG_PRIO_INHERIT) != OS_NO_ERR ||
+       mutex_init(&pi_mutex_b, MUTEX_FLAG_PRIO_INHERIT) != OS_NO_ERR)
+    {
+        kernel_error("TEST_MUTEX_PI 0\n");
+        kernel_panic();
+    }
+
+    /* Low holds A */
+    error = create_thread(&low, test_pi_low, TEST_PI_LOW, "test_pi_low", NULL);
+    for(i = 0; error == OS_NO_ERR && pi_step != 1 && i < TEST_MUTEX_TIMEOUT;
+        ++i)
+    {
+        sleep(1);
+    }
+    if(error != OS_NO_ERR || pi_step != 1)
+    {
+        kernel_error("TEST_MUTEX_PI 1\n");
+        kernel_panic();
+    }
+
+    /* Mid holds B and waits for A, low inherits its priority */
+    error = create_thread(&mid, test_pi_mid, TEST_PI_MID, "test_pi_mid", NULL);
+    if(error != OS_NO_ERR || test_wait_blocked(mid, &pi_mutex_a) == 0)
+    {
+        kernel_error("TEST_MUTEX_PI 2\n");
+        kernel_panic();
+    }
+    if(test_wait_inherited(low, TEST_PI_MID) == 0)
+    {
+        kernel_error("TEST_MUTEX_PI 3\n");
+        kernel_panic();
+    }
+
+    /* High waits for B, the boost goes along the chain up to low */
+    error = create_thread(&high, test_pi_high, TEST_PI_HIGH, "test_pi_high",
+                          NULL);
+    if(error != OS_NO_ERR || test_wait_blocked(high, &pi_mutex_b) == 0)
+    {
+        kernel_error("TEST_MUTEX_PI 4\n");
+        kernel_panic();
+    }
+    if(test_wait_inherited(mid, TEST_PI_HIGH) == 0 ||
+       test_wait_inherited(low, TEST_PI_HIGH) == 0)
+    {
+        kernel_error("TEST_MUTEX_PI 5\n");
+        kernel_panic();
+    }
+
+    /* The chain unwinds, each thread gets its priority back */
+    pi_release = 1;
+
+    error = wait_thread(low, &ret);
+    if(error != OS_NO_ERR || ret != NULL)
+    {
+        kernel_error("TEST_MUTEX_PI 6\n");
+        kernel_panic();
+    }
+    error = wait_thread(mid, &ret);
+    if(error != OS_NO_ERR || ret != NULL)
+    {
+        kernel_error("TEST_MUTEX_PI 7\n");
+        kernel_panic();
+    }
+    error = wait_thread(high, &ret);
+    if(error != OS_NO_ERR || ret != NULL)
+    {
+        kernel_error("TEST_MUTEX_PI 8\n");
+        kernel_panic();
+    }
+
+    if(mutex_destroy(&pi_mutex_a) != OS_NO_ERR ||
+       mutex_destroy(&pi_mutex_b) != OS_NO_ERR)
+    {
+        kernel_error("TEST_MUTEX_PI 9\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Mutex priority inheritance tests passed\n");
+}
+
+/* Sleep until a thread blocks on a mutex not inheriting priorities.
+ *
+ * @param thread The thread to wait for.
+ * @returns 1 if the thread blocked before TEST_MUTEX_TIMEOUT, 0 otherwise.
+ */
+static uint8_t test_wait_locked(const thread_t thread)
+{
+    uint32_t i;
+
+    for(i = 0; i < TEST_MUTEX_TIMEOUT; ++i)
+    {
+        if(thread->state == BLOCKED && thread->block_type == MUTEX)
+        {
+            return 1;
+        }
+        sleep(1);
+    }
+
+    return 0;
+}
+
+/* Holds the adaptive mutex, sleeping or running depending on the behaviour
+ * given as parameter.
+ */
+static void* test_adaptive_owner(void* args)
+{
+    uint32_t i;
+
+    if(mutex_pend(&adaptive_mutex) != OS_NO_ERR ||
+       adaptive_mutex.owner != get_current_thread())
+    {
+        return (void*)1;
+    }
+    adaptive_locked = 1;
+
+    while(adaptive_release == 0)
+    {
+        if((uint32_t)args == TEST_ADAPTIVE_SLEEP)
+        {
+            sleep(1);
+        }
+        else
+        {
+            cpu_pause();
+        }
+    }
+
+    /* The waiter is spinning, release the mutex before the spin ends */
+    if((uint32_t)args == TEST_ADAPTIVE_SHORT)
+    {
+        for(i = 0; i < TEST_ADAPTIVE_HOLD; ++i)
+        {
+            cpu_pause();
+        }
+    }
+
+    if(mutex_post(&adaptive_mutex) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+/* Pends the adaptive mutex, returns the number of times it blocked */
+static void* test_adaptive_waiter(void* args)
+{
+    kernel_thread_t* current;
+    uint32_t         switches;
+
+    current  = get_current_thread();
+    switches = current->voluntary_switches;
+
+    /* Lets the short owner release the mutex */
+    if((uint32_t)args == TEST_ADAPTIVE_SHORT)
+    {
+        adaptive_release = 1;
+    }
+
+    if(mutex_pend(&adaptive_mutex) != OS_NO_ERR ||
+       adaptive_mutex.owner != current)
+    {
+        return (void*)0xFFFFFFFF;
+    }
+    switches = current->voluntary_switches - switches;
+
+    if(mutex_post(&adaptive_mutex) != OS_NO_ERR ||
+       adaptive_mutex.owner != NULL)
+    {
+        return (void*)0xFFFFFFFF;
+    }
+
+    return (void*)switches;
+}
+
+/* Runs an owner and a waiter of the adaptive mutex.
+ *
+ * @param behaviour The behaviour of the owner.
+ * @param owner_cpu The CPU executing the owner.
+ * @param release Set to 1 to release the mutex once the waiter blocked.
+ * @returns The number of times the waiter blocked, 0xFFFFFFFF on error.
+ */
+static uint32_t test_adaptive_run(const uint32_t behaviour,
+                                  const uint32_t owner_cpu,
+                                  const uint8_t release)
+{
+    OS_RETURN_E error;
+    thread_t    owner;
+    thread_t    waiter;
+    void*       owner_ret;
+    void*       waiter_ret;
+    uint32_t    i;
+
+    adaptive_locked  = 0;
+    adaptive_release = 0;
+
+    error = create_thread_affinity(&owner, test_adaptive_owner,
+                                   TEST_ADAPTIVE_PRIO, "test_adaptive_own",
+                                   (void*)behaviour,
+                                   THREAD_AFFINITY_CPU(owner_cpu),
+                                   THREAD_STACK_SIZE);
+    for(i = 0;
+        error == OS_NO_ERR && adaptive_locked == 0 && i < TEST_MUTEX_TIMEOUT;
+        ++i)
+    {
+        sleep(1);
+    }
+    if(error != OS_NO_ERR || adaptive_locked == 0)
+    {
+        return 0xFFFFFFFF;
+    }
+
+    error = create_thread_affinity(&waiter, test_adaptive_waiter,
+                                   TEST_ADAPTIVE_PRIO, "test_adaptive_wait",
+                                   (void*)behaviour, THREAD_AFFINITY_CPU(0),
+                                   THREAD_STACK_SIZE);
+    if(error != OS_NO_ERR)
+    {
+        return 0xFFFFFFFF;
+    }
+
+    if(release == 1)
+    {
+        if(test_wait_locked(waiter) == 0)
+        {
+            return 0xFFFFFFFF;
+        }
+        adaptive_release = 1;
+    }
+
+    if(wait_thread(waiter, &waiter_ret) != OS_NO_ERR ||
+       wait_thread(owner, &owner_ret) != OS_NO_ERR ||
+       owner_ret != NULL)
+    {
+        return 0xFFFFFFFF;
+    }
+
+    return (uint32_t)waiter_ret;
+}
+
+void test_mutex_adaptive(void)
+{
+    uint32_t switches;
+
+    if(mutex_init(&adaptive_mutex, MUTEX_FLAG_ADAPTIVE) != OS_NO_ERR)
+    {
+        kernel_error("TEST_MUTEX_ADAPTIVE 0\n");
+        kernel_panic();
+    }
+
+    /* The owner is not running, the waiter blocks without spinning */
+    switches = test_adaptive_run(TEST_ADAPTIVE_SLEEP, 0, 1);
+    if(switches == 0 || switches == 0xFFFFFFFF)
+    {
+        kernel_error("TEST_MUTEX_ADAPTIVE 1\n");
+        kernel_panic();
+    }
+
+    /* The spins need the owner running on an other CPU */
+    if(get_booted_cpu_count() > 1)
+    {
+        /* The owner releases the mutex while the waiter spins, the waiter
+         * acquires it without blocking.
+         */
+        switches = test_adaptive_run(TEST_ADAPTIVE_SHORT, 1, 0);
+        if(switches != 0)
+        {
+            kernel_error("TEST_MUTEX_ADAPTIVE 2\n");
+            kernel_panic();
+        }
+
+        /* The owner keeps running, the spin is bounded and the waiter
+         * blocks.
+         */
+        switches = test_adaptive_run(TEST_ADAPTIVE_SPIN, 1, 1);
+        if(switches == 0 || switches == 0xFFFFFFFF)
+        {
+            kernel_error("TEST_MUTEX_ADAPTIVE 3\n");
+            kernel_panic();
+        }
+    }
+
+    if(mutex_destroy(&adaptive_mutex) != OS_NO_ERR)
+    {
+        kernel_error("TEST_MUTEX_ADAPTIVE 4\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Mutex adaptive spin tests passed\n");
+}
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ *
+ * File: test_rbtree.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Kernel red-black tree tests
+ ******************************************************************************/
+
+#include "../../core/kernel_rbtree.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../lib/stddef.h"
+
+void test_rbtree(void)
+{
+    OS_RETURN_E           error;
+    kernel_rbtree_t       tree;
+    kernel_rbtree_node_t  nodes[40] = { { 0 } };
+    kernel_rbtree_node_t* find;
+    kernel_rbtree_node_t* prev;
+    uint32_t              unsorted[10] = {0, 3, 5, 7, 4, 1, 8, 9, 6, 2};
+    uint32_t              count;
+    uint32_t              i;
+
+    /* Init tree */
+    error = kernel_rbtree_init(&tree);
+    if(error != OS_NO_ERR || kernel_rbtree_first(&tree) != NULL)
+    {
+        kernel_error("TEST_RBTREE 0\n");
+        kernel_panic();
+    }
+
+    /* Insert NULL node */
+    error = kernel_rbtree_insert(&tree, NULL, 0);
+    if(error != OS_ERR_NULL_POINTER)
+    {
+        kernel_error("TEST_RBTREE 1\n");
+        kernel_panic();
+    }
+
+    /* Insert nodes, four nodes per key */
+    for(i = 0; i < 40; ++i)
+    {
+        nodes[i].data = (void*)i;
+        error = kernel_rbtree_insert(&tree, &nodes[i], unsorted[i % 10]);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_RBTREE 2\n");
+            kernel_panic();
+        }
+    }
+    if(tree.size != 40)
+    {
+        kernel_error("TEST_RBTREE 3\n");
+        kernel_panic();
+    }
+
+    /* Insert a node twice */
+    error = kernel_rbtree_insert(&tree, &nodes[0], 0);
+    if(error != OS_ERR_UNAUTHORIZED_ACTION)
+    {
+        kernel_error("TEST_RBTREE 4\n");
+        kernel_panic();
+    }
+
+    /* Walk the tree, keys are sorted and equal keys keep the insertion
+     * order
+     */
+    count = 0;
+    prev  = NULL;
+    find  = kernel_rbtree_first(&tree);
+    while(find != NULL)
+    {
+        if(find->key != count / 4 ||
+           (count % 4 != 0 && (uint32_t)find->data <= (uint32_t)prev->data))
+        {
+            kernel_error("TEST_RBTREE 5\n");
+            kernel_panic();
+        }
+        ++count;
+        prev = find;
+        find = kernel_rbtree_next(find);
+    }
+    if(count != 40)
+    {
+        kernel_error("TEST_RBTREE 6\n");
+        kernel_panic();
+    }
+
+    /* The first node is the first inserted node of the lowest key */
+    find = kernel_rbtree_first(&tree);
+    if(find != &nodes[0])
+    {
+        kernel_error("TEST_RBTREE 7\n");
+        kernel_panic();
+    }
+
+    /* Remove the first nodes, the next one of the same key follows */
+    for(i = 0; i < 4; ++i)
+    {
+        find = kernel_rbtree_first(&tree);
+        if(find != &nodes[i * 10])
+        {
+            kernel_error("TEST_RBTREE 8\n");
+            kernel_panic();
+        }
+        error = kernel_rbtree_remove(&tree, find);
+        if(error != OS_NO_ERR || find->linked != 0)
+        {
+            kernel_error("TEST_RBTREE 9\n");
+            kernel_panic();
+        }
+    }
+
+    /* Remove a node twice */
+    error = kernel_rbtree_remove(&tree, &nodes[0]);
+    if(error != OS_ERR_UNAUTHORIZED_ACTION)
+    {
+        kernel_error("TEST_RBTREE 10\n");
+        kernel_panic();
+    }
+
+    /* Remove the other nodes in an other order */
+    for(i = 39; i > 0; --i)
+    {
+        if(nodes[i].linked == 0)
+        {
+            continue;
+        }
+        error = kernel_rbtree_remove(&tree, &nodes[i]);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_RBTREE 11\n");
+            kernel_panic();
+        }
+    }
+    if(tree.size != 0 || kernel_rbtree_first(&tree) != NULL ||
+       tree.root != NULL)
+    {
+        kernel_error("TEST_RBTREE 12\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Kernel red-black trees tests passed\n");
+}
@@ -0,0 +1,1100 @@
+/*******************************************************************************
+ *
+ * File: test_sched.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Scheduler tests. The tests create threads, they are
+ * executed by the INIT thread once the scheduler is started.
+ ******************************************************************************/
+
+#include "../../core/scheduler.h"
+#include "../../core/kernel_thread.h"
+#include "../../core/interrupts.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../drivers/tsc.h"
+#include "../../cpu/cpu.h"
+#include "../../cpu/smp.h"
+#include "../../lib/string.h"
+#include "../../lib/stddef.h"
+#include "../../lib/stdint.h"
+
+/* Time given to a test before it is considered failed, in ms */
+#define TEST_SCHED_TIMEOUT 2000
+
+/* Number of samples of the CPU executing a pinned thread */
+#define TEST_AFFINITY_SAMPLES 50
+
+/* Deadline thread parameters (us) and measure window (ms) of the throttling
+ * test
+ */
+#define TEST_DL_RUNTIME    20000
+#define TEST_DL_PERIOD     100000
+#define TEST_DL_WINDOW     500
+
+/* Period (us) of the periodic thread test and work time of the overrun, in
+ * tenths of period
+ */
+#define TEST_PERIOD_US     10000
+#define TEST_PERIOD_WORK   35
+
+/* Attempts to wait for a release within the clock tick of the release */
+#define TEST_PERIOD_TRIES  10
+
+/* Time the accounting test threads spin, in ns */
+#define TEST_ACCOUNT_SPIN_NS 50000000ULL
+
+/* Maximal lateness of a high resolution sleep wake up, in ns */
+#define TEST_SLEEP_LATE_NS 2000000ULL
+
+/* Maximal lateness of a sleep wheel wake up, in ms. The wheel wakes a thread
+ * up on the tick following its wake-up time.
+ */
+#define TEST_WHEEL_LATE_MS 3
+
+/* Number of threads sharing the same wheel wake-up time, and their sleep */
+#define TEST_WHEEL_EQUAL    16
+#define TEST_WHEEL_EQUAL_MS 200
+
+/* Priority of the sleep wheel test threads */
+#define TEST_WHEEL_PRIO     10
+
+/* Threads created per CPU by the load balancing test, and their priority */
+#define TEST_BALANCE_PER_CPU 2
+#define TEST_BALANCE_PRIO    30
+
+/* Capacity of the threads information buffer */
+#define TEST_INFO_COUNT 128
+
+/* Threads created by each parent of the teardown test, and rounds */
+#define TEST_TEARDOWN_COUNT  64
+#define TEST_TEARDOWN_ROUNDS 4
+
+static volatile uint32_t test_start;
+static volatile uint32_t test_stop;
+static volatile uint32_t fair_progress;
+static volatile uint32_t affinity_cpu;
+static volatile uint32_t wheel_target;
+static volatile uint32_t balance_started;
+
+/* CPUs which executed each load balancing test thread */
+static volatile uint32_t balance_cpus[MAX_CPU_COUNT * TEST_BALANCE_PER_CPU];
+
+static thread_info_t threads_info[TEST_INFO_COUNT];
+
+/* Sleeps crossing the sleep wheel levels boundaries, in ms */
+static const uint32_t wheel_sleeps[] = {
+    SLEEP_WHEEL_SIZE - 1,
+    SLEEP_WHEEL_SIZE,
+    70,
+    SLEEP_WHEEL_SIZE * SLEEP_WHEEL_SIZE - 1,
+    SLEEP_WHEEL_SIZE * SLEEP_WHEEL_SIZE,
+    5000
+};
+
+/* Counters read by the accounting test threads on themselves */
+typedef struct test_account
+{
+    uint64_t start;
+    uint64_t end;
+    uint64_t cpu_time;
+    uint32_t voluntary;
+    uint32_t involuntary;
+} test_account_t;
+
+static test_account_t accounts[3];
+
+static void* test_fair_routine(void* args)
+{
+    (void)args;
+
+    while(test_start == 0);
+
+    while(test_stop == 0)
+    {
+        ++fair_progress;
+    }
+
+    return NULL;
+}
+
+static void* test_busy_routine(void* args)
+{
+    uint32_t start;
+
+    (void)args;
+
+    /* Never yields, the fair thread only runs if the fair class ages */
+    test_start = 1;
+    start      = get_current_uptime();
+    while(fair_progress == 0 &&
+          get_current_uptime() - start < TEST_SCHED_TIMEOUT);
+
+    return (void*)fair_progress;
+}
+
+void test_sched_fair(void)
+{
+    OS_RETURN_E error;
+    thread_t    fair;
+    thread_t    busy;
+    void*       ret;
+
+    test_start    = 0;
+    test_stop     = 0;
+    fair_progress = 0;
+
+    /* Both threads share the CPU 0, the busy thread is more prioritary than
+     * the fair class
+     */
+    error = create_thread_affinity(&fair, test_fair_routine,
+                                   SCHEDULE_FAIR_PRIORITY + 8, "test_fair",
+                                   NULL, THREAD_AFFINITY_CPU(0),
+                                   THREAD_STACK_SIZE);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_FAIR 0\n");
+        kernel_panic();
+    }
+    error = set_thread_policy(fair, SCHED_POLICY_FAIR);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_FAIR 1\n");
+        kernel_panic();
+    }
+
+    error = create_thread_affinity(&busy, test_busy_routine,
+                                   SCHEDULE_FAIR_PRIORITY - 16, "test_busy",
+                                   NULL, THREAD_AFFINITY_CPU(0),
+                                   THREAD_STACK_SIZE);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_FAIR 2\n");
+        kernel_panic();
+    }
+
+    /* The fair thread progressed while the busy thread was ready */
+    error = wait_thread(busy, &ret);
+    if(error != OS_NO_ERR || ret == NULL)
+    {
+        kernel_error("TEST_SCHED_FAIR 3\n");
+        kernel_panic();
+    }
+
+    test_stop = 1;
+    error = wait_thread(fair, NULL);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_FAIR 4\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Fair scheduling tests passed\n");
+}
+
+/* Check the time slept by a high resolution sleep. Without TSC the monotonic
+ * clock has the uptime resolution, the measure may be short of 1ms.
+ *
+ * @param start The monotonic time before the sleep.
+ * @param requested The requested sleep time in ns.
+ * @returns 1 if the thread woke up on time, 0 otherwise.
+ */
+static uint8_t test_sleep_check(const uint64_t start, const uint64_t requested)
+{
+    uint64_t elapsed;
+    uint64_t resolution;
+
+    elapsed    = get_monotonic_ns() - start;
+    resolution = (get_tsc_frequency_khz() == 0) ? 1000000ULL : 0;
+
+    return (elapsed + resolution >= requested &&
+            elapsed <= requested + TEST_SLEEP_LATE_NS) ? 1 : 0;
+}
+
+void test_sched_sleep(void)
+{
+    uint64_t start;
+
+    /* Below the scheduler period */
+    start = get_monotonic_ns();
+    if(usleep(500) != OS_NO_ERR || test_sleep_check(start, 500000ULL) == 0)
+    {
+        kernel_error("TEST_SCHED_SLEEP 0\n");
+        kernel_panic();
+    }
+
+    /* Across scheduler ticks */
+    start = get_monotonic_ns();
+    if(nanosleep(2500000ULL) != OS_NO_ERR ||
+       test_sleep_check(start, 2500000ULL) == 0)
+    {
+        kernel_error("TEST_SCHED_SLEEP 1\n");
+        kernel_panic();
+    }
+
+    /* Absolute deadline */
+    start = get_monotonic_ns();
+    if(nanosleep_until(start + 1500000ULL) != OS_NO_ERR ||
+       test_sleep_check(start, 1500000ULL) == 0)
+    {
+        kernel_error("TEST_SCHED_SLEEP 2\n");
+        kernel_panic();
+    }
+
+    /* A past deadline returns at once */
+    start = get_monotonic_ns();
+    if(nanosleep_until(start - 1) != OS_NO_ERR ||
+       test_sleep_check(start, 0) == 0)
+    {
+        kernel_error("TEST_SCHED_SLEEP 3\n");
+        kernel_panic();
+    }
+
+    kernel_debug("High resolution sleep tests passed\n");
+}
+
+/* Sleeps the time given as parameter, or until wheel_target if 0, and checks
+ * the wake up is neither early nor late.
+ */
+static void* test_wheel_routine(void* args)
+{
+    uint32_t start;
+    uint32_t requested;
+    uint32_t elapsed;
+
+    start     = get_current_uptime();
+    requested = (uint32_t)args;
+    if(requested == 0)
+    {
+        requested = ((int32_t)(wheel_target - start) > 0) ?
+                    wheel_target - start : 0;
+    }
+
+    if(sleep(requested) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    elapsed = get_current_uptime() - start;
+    if(elapsed < requested || elapsed > requested + TEST_WHEEL_LATE_MS)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+void test_sched_wheel(void)
+{
+    OS_RETURN_E error;
+    thread_t    threads[sizeof(wheel_sleeps) / sizeof(wheel_sleeps[0]) +
+                        TEST_WHEEL_EQUAL];
+    uint32_t    count;
+    uint32_t    i;
+    void*       ret;
+
+    count = sizeof(wheel_sleeps) / sizeof(wheel_sleeps[0]);
+
+    /* The sleeps are moved down the levels before they expire */
+    for(i = 0; i < count; ++i)
+    {
+        error = create_thread(&threads[i], test_wheel_routine,
+                              TEST_WHEEL_PRIO, "test_wheel",
+                              (void*)wheel_sleeps[i]);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_WHEEL 0\n");
+            kernel_panic();
+        }
+    }
+
+    /* The sleepers sharing a wake-up time share a slot */
+    wheel_target = get_current_uptime() + TEST_WHEEL_EQUAL_MS;
+    for(i = count; i < count + TEST_WHEEL_EQUAL; ++i)
+    {
+        error = create_thread(&threads[i], test_wheel_routine,
+                              TEST_WHEEL_PRIO, "test_wheel", NULL);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_WHEEL 1\n");
+            kernel_panic();
+        }
+    }
+
+    for(i = 0; i < count + TEST_WHEEL_EQUAL; ++i)
+    {
+        error = wait_thread(threads[i], &ret);
+        if(error != OS_NO_ERR || ret != NULL)
+        {
+            kernel_error("TEST_SCHED_WHEEL %d\n", (i < count) ? 2 : 3);
+            kernel_panic();
+        }
+    }
+
+    kernel_debug("Sleep wheel tests passed\n");
+}
+
+static void* test_affinity_routine(void* args)
+{
+    (void)args;
+
+    /* The CPU id is read and published without migrating in between */
+    while(test_stop == 0)
+    {
+        disable_local_interrupt();
+        affinity_cpu = get_cpu_id();
+        enable_local_interrupt();
+    }
+
+    return NULL;
+}
+
+/* Check that a pinned thread is only executed by a CPU.
+ *
+ * @param cpu_id The CPU the thread is pinned to.
+ * @returns 1 if the thread reached the CPU and stayed on it, 0 otherwise.
+ */
+static uint8_t test_affinity_check(const uint32_t cpu_id)
+{
+    uint32_t i;
+
+    for(i = 0; affinity_cpu != cpu_id && i < TEST_SCHED_TIMEOUT; ++i)
+    {
+        sleep(1);
+    }
+
+    for(i = 0; i < TEST_AFFINITY_SAMPLES; ++i)
+    {
+        if(affinity_cpu != cpu_id)
+        {
+            return 0;
+        }
+        sleep(1);
+    }
+
+    return 1;
+}
+
+void test_sched_affinity(void)
+{
+    OS_RETURN_E error;
+    thread_t    thread;
+    uint32_t    last_cpu;
+
+    test_stop    = 0;
+    affinity_cpu = MAX_CPU_COUNT;
+    last_cpu     = get_booted_cpu_count() - 1;
+
+    /* No running CPU allowed */
+    error = create_thread_affinity(&thread, test_affinity_routine, 40,
+                                   "test_affinity", NULL, 0,
+                                   THREAD_STACK_SIZE);
+    if(error != OS_ERR_UNAUTHORIZED_ACTION)
+    {
+        kernel_error("TEST_SCHED_AFFINITY 0\n");
+        kernel_panic();
+    }
+
+    error = create_thread_affinity(&thread, test_affinity_routine, 40,
+                                   "test_affinity", NULL,
+                                   THREAD_AFFINITY_CPU(0), THREAD_STACK_SIZE);
+    if(error != OS_NO_ERR || test_affinity_check(0) == 0)
+    {
+        kernel_error("TEST_SCHED_AFFINITY 1\n");
+        kernel_panic();
+    }
+
+    if(get_booted_cpu_count() < MAX_CPU_COUNT &&
+       set_thread_affinity(thread, THREAD_AFFINITY_CPU(MAX_CPU_COUNT - 1)) !=
+       OS_ERR_UNAUTHORIZED_ACTION)
+    {
+        kernel_error("TEST_SCHED_AFFINITY 2\n");
+        kernel_panic();
+    }
+
+    /* The running thread leaves its CPU for the last CPU */
+    error = set_thread_affinity(thread, THREAD_AFFINITY_CPU(last_cpu));
+    if(error != OS_NO_ERR || test_affinity_check(last_cpu) == 0)
+    {
+        kernel_error("TEST_SCHED_AFFINITY 3\n");
+        kernel_panic();
+    }
+
+    test_stop = 1;
+    error = wait_thread(thread, NULL);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_AFFINITY 4\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Affinity tests passed\n");
+}
+
+/* Records the CPUs executing the thread */
+static void* test_balance_routine(void* args)
+{
+    uint32_t index = (uint32_t)args;
+
+    cpu_fetch_add(&balance_started, 1);
+
+    while(test_stop == 0)
+    {
+        balance_cpus[index] |= THREAD_AFFINITY_CPU(get_cpu_id());
+    }
+
+    return NULL;
+}
+
+/* Check the load balancing test threads are spread on all the CPUs.
+ *
+ * @param threads The load balancing test threads.
+ * @param count The number of threads.
+ * @returns 1 if every CPU holds a test thread and no run queue holds all of
+ * them, 0 otherwise.
+ */
+static uint8_t test_balance_check(const thread_t* threads,
+                                  const uint32_t count)
+{
+    int32_t  size;
+    int32_t  i;
+    uint32_t j;
+    uint32_t hosts;
+
+    size = TEST_INFO_COUNT;
+    if(get_threads_info(threads_info, &size) != OS_NO_ERR)
+    {
+        return 0;
+    }
+
+    hosts = 0;
+    for(i = 0; i < size; ++i)
+    {
+        for(j = 0; j < count; ++j)
+        {
+            if(threads_info[i].pid != threads[j]->pid)
+            {
+                continue;
+            }
+
+            /* The threads were all queued on CPU 0 */
+            if(threads_info[i].cpu_queue_length + 1 >= count)
+            {
+                return 0;
+            }
+            hosts |= THREAD_AFFINITY_CPU(threads_info[i].cpu_id);
+        }
+    }
+
+    for(j = 0; j < get_booted_cpu_count(); ++j)
+    {
+        if((hosts & THREAD_AFFINITY_CPU(j)) == 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void test_sched_balance(void)
+{
+    OS_RETURN_E error;
+    thread_t    threads[MAX_CPU_COUNT * TEST_BALANCE_PER_CPU];
+    uint32_t    cpu_count;
+    uint32_t    count;
+    uint32_t    cpus;
+    uint32_t    i;
+
+    /* The threads are stolen by the other CPUs */
+    cpu_count = get_booted_cpu_count();
+    if(cpu_count < 2)
+    {
+        kernel_debug("Load balancing tests skipped, single CPU\n");
+        return;
+    }
+
+    count           = cpu_count * TEST_BALANCE_PER_CPU;
+    test_stop       = 0;
+    balance_started = 0;
+
+    /* All the threads are queued on CPU 0 */
+    for(i = 0; i < count; ++i)
+    {
+        balance_cpus[i] = 0;
+        error = create_thread_affinity(&threads[i], test_balance_routine,
+                                       TEST_BALANCE_PRIO, "test_balance",
+                                       (void*)i, THREAD_AFFINITY_CPU(0),
+                                       THREAD_STACK_SIZE);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_BALANCE 0\n");
+            kernel_panic();
+        }
+    }
+    for(i = 0; i < TEST_SCHED_TIMEOUT && balance_started != count; ++i)
+    {
+        sleep(1);
+    }
+    if(balance_started != count)
+    {
+        kernel_error("TEST_SCHED_BALANCE 1\n");
+        kernel_panic();
+    }
+
+    /* The threads stay queued on CPU 0 until the idle CPUs take them */
+    for(i = 0; i < count; ++i)
+    {
+        if(set_thread_affinity(threads[i], THREAD_AFFINITY_ALL) != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_BALANCE 2\n");
+            kernel_panic();
+        }
+    }
+    for(i = 0; i < TEST_SCHED_TIMEOUT &&
+        test_balance_check(threads, count) == 0; ++i)
+    {
+        sleep(1);
+    }
+    if(i == TEST_SCHED_TIMEOUT)
+    {
+        kernel_error("TEST_SCHED_BALANCE 3\n");
+        kernel_panic();
+    }
+
+    test_stop = 1;
+    cpus      = 0;
+    for(i = 0; i < count; ++i)
+    {
+        error = wait_thread(threads[i], NULL);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_BALANCE 4\n");
+            kernel_panic();
+        }
+        cpus |= balance_cpus[i];
+    }
+
+    /* Every CPU executed a thread created on CPU 0 */
+    for(i = 0; i < cpu_count; ++i)
+    {
+        if((cpus & THREAD_AFFINITY_CPU(i)) == 0)
+        {
+            kernel_error("TEST_SCHED_BALANCE 5\n");
+            kernel_panic();
+        }
+    }
+
+    kernel_debug("Load balancing tests passed\n");
+}
+
+static void* test_spin_routine(void* args)
+{
+    (void)args;
+
+    while(test_stop == 0);
+
+    return NULL;
+}
+
+static void* test_sleep_routine(void* args)
+{
+    (void)args;
+
+    while(test_stop == 0)
+    {
+        sleep(1);
+    }
+
+    return NULL;
+}
+
+void test_sched_deadline(void)
+{
+    OS_RETURN_E error;
+    thread_t    spinner;
+    thread_t    sleeper;
+    uint64_t    cpu_time;
+    uint64_t    max_time;
+
+    test_stop = 0;
+
+    error = create_thread_affinity(&spinner, test_spin_routine, 40,
+                                   "test_dl_spin", NULL,
+                                   THREAD_AFFINITY_CPU(0), THREAD_STACK_SIZE);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 0\n");
+        kernel_panic();
+    }
+    error = create_thread_affinity(&sleeper, test_sleep_routine, 40,
+                                   "test_dl_sleep", NULL,
+                                   THREAD_AFFINITY_CPU(0), THREAD_STACK_SIZE);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 1\n");
+        kernel_panic();
+    }
+
+    /* Wrong parameters and share above SCHEDULE_DL_BW_MAX */
+    if(set_thread_deadline(sleeper, 200, 100, 1000) != OS_ERR_OUT_OF_BOUND ||
+       set_thread_deadline(sleeper, 100, 1000, SCHEDULE_DL_MAX_PERIOD + 1) !=
+       OS_ERR_OUT_OF_BOUND ||
+       set_thread_deadline(sleeper, 95000, 100000, 100000) !=
+       OS_ERR_UNAUTHORIZED_ACTION)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 2\n");
+        kernel_panic();
+    }
+
+    /* 50% is admitted, an other 50% on the same CPU is not, 30% is */
+    if(set_thread_deadline(spinner, 50000, 100000, 100000) != OS_NO_ERR ||
+       set_thread_deadline(sleeper, 50000, 100000, 100000) !=
+       OS_ERR_UNAUTHORIZED_ACTION ||
+       set_thread_deadline(sleeper, 30000, 100000, 100000) != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 3\n");
+        kernel_panic();
+    }
+
+    /* The reservations are released */
+    if(set_thread_deadline(sleeper, 0, 0, 0) != OS_NO_ERR ||
+       set_thread_deadline(spinner, 85000, 100000, 100000) != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 4\n");
+        kernel_panic();
+    }
+
+    /* The spinner never blocks, it is throttled once its runtime is consumed
+     * and only executes TEST_DL_RUNTIME per period
+     */
+    if(set_thread_deadline(spinner, TEST_DL_RUNTIME, TEST_DL_PERIOD,
+                           TEST_DL_PERIOD) != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 5\n");
+        kernel_panic();
+    }
+    sleep(TEST_DL_PERIOD / 1000);
+
+    cpu_time = spinner->cpu_time;
+    sleep(TEST_DL_WINDOW);
+    cpu_time = spinner->cpu_time - cpu_time;
+
+    max_time = (uint64_t)(TEST_DL_WINDOW / (TEST_DL_PERIOD / 1000) + 2) *
+               TEST_DL_RUNTIME * 1000;
+    if(cpu_time < (uint64_t)TEST_DL_RUNTIME * 1000 || cpu_time > max_time)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 6\n");
+        kernel_panic();
+    }
+
+    test_stop = 1;
+    if(set_thread_deadline(spinner, 0, 0, 0) != OS_NO_ERR ||
+       wait_thread(spinner, NULL) != OS_NO_ERR ||
+       wait_thread(sleeper, NULL) != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_DEADLINE 7\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Deadline scheduling tests passed\n");
+}
+
+void test_sched_period(void)
+{
+    thread_period_t period;
+    uint64_t        first_release;
+    uint64_t        release;
+    uint64_t        work_end;
+    uint32_t        overruns;
+    uint32_t        i;
+
+    if(thread_period_init(&period, TEST_PERIOD_US) != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_PERIOD 0\n");
+        kernel_panic();
+    }
+    first_release = period.next_release;
+
+    /* Releases on time, never before the timeline */
+    for(i = 0; i < 3; ++i)
+    {
+        release = period.next_release;
+        if(thread_period_wait(&period) != OS_NO_ERR ||
+           test_sleep_check(release, 0) == 0)
+        {
+            kernel_error("TEST_SCHED_PERIOD 1\n");
+            kernel_panic();
+        }
+    }
+    if(period.releases != 3 || period.overruns != 0 ||
+       period.next_release !=
+       first_release + 3ULL * TEST_PERIOD_US * 1000)
+    {
+        kernel_error("TEST_SCHED_PERIOD 2\n");
+        kernel_panic();
+    }
+
+    /* Work 3.5 periods: the 3 releases passed meanwhile are overruns, the
+     * timeline keeps its phase
+     */
+    work_end = get_monotonic_ns() +
+               (uint64_t)TEST_PERIOD_WORK * TEST_PERIOD_US * 100;
+    while(get_monotonic_ns() < work_end);
+
+    if(thread_period_wait(&period) != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_PERIOD 3\n");
+        kernel_panic();
+    }
+    if(period.releases != 4 || period.overruns != 3 ||
+       period.next_release !=
+       first_release + 7ULL * TEST_PERIOD_US * 1000)
+    {
+        kernel_error("TEST_SCHED_PERIOD 4\n");
+        kernel_panic();
+    }
+
+    /* A wait made at the release time is not an overrun. The call time can
+     * only match the release with the uptime resolution of the monotonic
+     * clock, without TSC.
+     */
+    for(i = 0; get_tsc_frequency_khz() == 0 && i < TEST_PERIOD_TRIES; ++i)
+    {
+        /* Start on a clock tick so the wait is made within the same tick */
+        release = get_monotonic_ns();
+        while(get_monotonic_ns() == release);
+        release = get_monotonic_ns();
+
+        period.next_release = release;
+        overruns            = period.overruns;
+        if(thread_period_wait(&period) != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_PERIOD 5\n");
+            kernel_panic();
+        }
+
+        /* The clock moved before the wait, try again */
+        if(get_monotonic_ns() != release)
+        {
+            continue;
+        }
+
+        if(period.overruns != overruns ||
+           period.next_release != release + (uint64_t)TEST_PERIOD_US * 1000)
+        {
+            kernel_error("TEST_SCHED_PERIOD 6\n");
+            kernel_panic();
+        }
+        break;
+    }
+    if(i == TEST_PERIOD_TRIES)
+    {
+        kernel_error("TEST_SCHED_PERIOD 7\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Periodic threads tests passed\n");
+}
+
+/* Record the accounting of the current thread. The thread sleeps first so its
+ * last execution is charged.
+ *
+ * @param account The buffer receiving the counters.
+ */
+static void test_account_record(test_account_t* account)
+{
+    kernel_thread_t* current;
+
+    account->end = get_monotonic_ns();
+    sleep(1);
+
+    current              = get_current_thread();
+    account->cpu_time    = current->cpu_time;
+    account->voluntary   = current->voluntary_switches;
+    account->involuntary = current->involuntary_switches;
+}
+
+static void* test_account_sleep_routine(void* args)
+{
+    uint32_t i;
+
+    accounts[(uint32_t)args].start = get_monotonic_ns();
+    for(i = 0; i < 10; ++i)
+    {
+        sleep(1);
+    }
+    test_account_record(&accounts[(uint32_t)args]);
+
+    return NULL;
+}
+
+static void* test_account_spin_routine(void* args)
+{
+    uint64_t start;
+
+    start = get_monotonic_ns();
+    accounts[(uint32_t)args].start = start;
+    while(get_monotonic_ns() - start < TEST_ACCOUNT_SPIN_NS);
+    test_account_record(&accounts[(uint32_t)args]);
+
+    return NULL;
+}
+
+void test_sched_accounting(void)
+{
+    OS_RETURN_E error;
+    thread_t    threads[3];
+    uint64_t    span;
+    uint64_t    cpu_time;
+    uint32_t    i;
+
+    /* A sleeping thread and two spinning threads sharing the CPU 0 */
+    error = create_thread(&threads[0], test_account_sleep_routine, 30,
+                          "test_account", (void*)0);
+    for(i = 1; i < 3 && error == OS_NO_ERR; ++i)
+    {
+        error = create_thread_affinity(&threads[i], test_account_spin_routine,
+                                       30, "test_account", (void*)i,
+                                       THREAD_AFFINITY_CPU(0),
+                                       THREAD_STACK_SIZE);
+    }
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_ACCOUNTING 0\n");
+        kernel_panic();
+    }
+    for(i = 0; i < 3; ++i)
+    {
+        if(wait_thread(threads[i], NULL) != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_ACCOUNTING 1\n");
+            kernel_panic();
+        }
+    }
+
+    /* Each sleep is a voluntary switch, the thread barely executes */
+    if(accounts[0].voluntary < 11 ||
+       accounts[0].cpu_time >= accounts[0].end - accounts[0].start)
+    {
+        kernel_error("TEST_SCHED_ACCOUNTING 2\n");
+        kernel_panic();
+    }
+
+    /* The spinning threads preempt each other and share the CPU time */
+    if(accounts[1].involuntary == 0 || accounts[2].involuntary == 0)
+    {
+        kernel_error("TEST_SCHED_ACCOUNTING 3\n");
+        kernel_panic();
+    }
+
+    span = ((accounts[1].end > accounts[2].end) ?
+            accounts[1].end : accounts[2].end) -
+           ((accounts[1].start < accounts[2].start) ?
+            accounts[1].start : accounts[2].start);
+    cpu_time = accounts[1].cpu_time + accounts[2].cpu_time;
+    if(cpu_time < span / 2 ||
+       cpu_time > span + TEST_SLEEP_LATE_NS)
+    {
+        kernel_error("TEST_SCHED_ACCOUNTING 4\n");
+        kernel_panic();
+    }
+
+    kernel_debug("CPU time accounting tests passed\n");
+}
+
+void test_sched_hist(void)
+{
+    sched_histogram_t hist;
+    sched_stats_t     stats;
+    OS_RETURN_E       error;
+    thread_t          thread;
+    uint32_t          latency_count;
+    uint32_t          depth_count;
+    uint32_t          i;
+
+    memset(&hist, 0, sizeof(sched_histogram_t));
+
+    /* Bucket 0 counts 0, bucket n counts [2^(n-1), 2^n[ */
+    sched_hist_add(&hist, 0);
+    sched_hist_add(&hist, 1);
+    sched_hist_add(&hist, 2);
+    sched_hist_add(&hist, 3);
+    sched_hist_add(&hist, 4);
+    sched_hist_add(&hist, 1000);
+    if(hist.buckets[0] != 1 || hist.buckets[1] != 1 || hist.buckets[2] != 2 ||
+       hist.buckets[3] != 1 || hist.buckets[10] != 1 ||
+       hist.count != 6 || hist.max != 1000)
+    {
+        kernel_error("TEST_SCHED_HIST 0\n");
+        kernel_panic();
+    }
+
+    /* The last bucket counts the greater values, the maximum saturates */
+    sched_hist_add(&hist, 1U << 29);
+    sched_hist_add(&hist, 1U << 30);
+    sched_hist_add(&hist, 0xFFFFFFFF);
+    sched_hist_add(&hist, 1ULL << 40);
+    if(hist.buckets[30] != 1 ||
+       hist.buckets[SCHEDULE_HIST_BUCKETS - 1] != 3 ||
+       hist.count != 10 || hist.max != 0xFFFFFFFF)
+    {
+        kernel_error("TEST_SCHED_HIST 1\n");
+        kernel_panic();
+    }
+
+    /* A sleeping thread wake ups are recorded in its priority band */
+    reset_sched_stats();
+
+    test_stop = 0;
+    error = create_thread(&thread, test_sleep_routine, 40, "test_hist", NULL);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_HIST 2\n");
+        kernel_panic();
+    }
+    sleep(20);
+    test_stop = 1;
+    if(wait_thread(thread, NULL) != OS_NO_ERR)
+    {
+        kernel_error("TEST_SCHED_HIST 3\n");
+        kernel_panic();
+    }
+
+    latency_count = 0;
+    depth_count   = 0;
+    for(i = 0; i < get_booted_cpu_count(); ++i)
+    {
+        if(get_sched_stats(i, &stats) != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_HIST 4\n");
+            kernel_panic();
+        }
+        latency_count +=
+            stats.wakeup_latency[40 / SCHEDULE_HIST_BAND_SIZE].count;
+        depth_count   += stats.rq_depth.count;
+    }
+    if(latency_count == 0 || depth_count == 0)
+    {
+        kernel_error("TEST_SCHED_HIST 5\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Scheduler histograms tests passed\n");
+}
+
+/* Returns its argument, the odd threads exit after their parent waits for
+ * them, the even ones before.
+ */
+static void* test_teardown_child(void* args)
+{
+    if(((uint32_t)args & 1) != 0)
+    {
+        sleep(1);
+    }
+
+    return args;
+}
+
+/* Creates and joins TEST_TEARDOWN_COUNT children.
+ *
+ * @param args Unused.
+ * @returns NULL on success, non NULL otherwise.
+ */
+static void* test_teardown_parent(void* args)
+{
+    kernel_thread_t* current;
+    thread_t         threads[TEST_TEARDOWN_COUNT];
+    void*            ret;
+    uint32_t         children;
+    uint32_t         i;
+
+    (void)args;
+
+    current  = get_current_thread();
+    children = current->children->size;
+
+    for(i = 0; i < TEST_TEARDOWN_COUNT; ++i)
+    {
+        if(create_thread(&threads[i], test_teardown_child,
+                         KERNEL_LOWEST_PRIORITY - 1, "test_teardown",
+                         (void*)i) != OS_NO_ERR)
+        {
+            return (void*)1;
+        }
+    }
+    if(current->children->size != children + TEST_TEARDOWN_COUNT)
+    {
+        return (void*)1;
+    }
+
+    /* The children are joined in reverse order, out of their exit order */
+    for(i = TEST_TEARDOWN_COUNT; i > 0; --i)
+    {
+        if(wait_thread(threads[i - 1], &ret) != OS_NO_ERR ||
+           ret != (void*)(i - 1))
+        {
+            return (void*)1;
+        }
+    }
+    if(current->children->size != children)
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+void test_sched_teardown(void)
+{
+    OS_RETURN_E error;
+    thread_t    parent;
+    void*       ret;
+    uint32_t    threads;
+    uint32_t    children;
+    uint32_t    i;
+
+    threads  = get_thread_count();
+    children = get_current_thread()->children->size;
+
+    for(i = 0; i < TEST_TEARDOWN_ROUNDS; ++i)
+    {
+        /* Children of INIT */
+        ret = test_teardown_parent(NULL);
+        if(ret != NULL || get_thread_count() != threads ||
+           get_current_thread()->children->size != children)
+        {
+            kernel_error("TEST_SCHED_TEARDOWN 0\n");
+            kernel_panic();
+        }
+
+        /* Children of an other thread */
+        error = create_thread(&parent, test_teardown_parent,
+                              KERNEL_LOWEST_PRIORITY - 1, "test_teardown",
+                              NULL);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_SCHED_TEARDOWN 1\n");
+            kernel_panic();
+        }
+        error = wait_thread(parent, &ret);
+        if(error != OS_NO_ERR || ret != NULL)
+        {
+            kernel_error("TEST_SCHED_TEARDOWN 2\n");
+            kernel_panic();
+        }
+        if(get_thread_count() != threads ||
+           get_current_thread()->children->size != children)
+        {
+            kernel_error("TEST_SCHED_TEARDOWN 3\n");
+            kernel_panic();
+        }
+    }
+
+    kernel_debug("Threads teardown tests passed\n");
+}
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ *
+ * File: test_slab.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Kernel object caches tests
+ ******************************************************************************/
+
+#include "../../memory/slab.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../lib/stddef.h"
+
+static uint32_t ctor_count;
+static uint32_t dtor_count;
+
+static void test_slab_ctor(void* obj)
+{
+    *(uint32_t*)obj = 0xCAFEBABE;
+    ++ctor_count;
+}
+
+static void test_slab_dtor(void* obj)
+{
+    (void)obj;
+    ++dtor_count;
+}
+
+void test_slab(void)
+{
+    OS_RETURN_E  error;
+    kmem_cache_t cache = KMEM_CACHE_INIT("test", 100, test_slab_ctor,
+                                         test_slab_dtor);
+    uint32_t*    objs[100] = { NULL };
+    uint32_t*    obj;
+
+    ctor_count = 0;
+    dtor_count = 0;
+
+    /* Allocate objects */
+    for(uint32_t i = 0; i < 100; ++i)
+    {
+        objs[i] = kmem_cache_alloc(&cache);
+        if(objs[i] == NULL)
+        {
+            kernel_error("TEST_SLAB 0\n");
+            kernel_panic();
+        }
+        if(((uint32_t)objs[i] & (KMEM_ALIGN - 1)) != 0 ||
+           *objs[i] != 0xCAFEBABE)
+        {
+            kernel_error("TEST_SLAB 1\n");
+            kernel_panic();
+        }
+        for(uint32_t j = 0; j < i; ++j)
+        {
+            if(objs[j] == objs[i])
+            {
+                kernel_error("TEST_SLAB 2\n");
+                kernel_panic();
+            }
+        }
+        *objs[i] = i;
+    }
+
+    if(cache.obj_count != 100 || ctor_count < 100 || cache.slab_count < 2)
+    {
+        kernel_error("TEST_SLAB 3\n");
+        kernel_panic();
+    }
+
+    /* Objects are not overlapping */
+    for(uint32_t i = 0; i < 100; ++i)
+    {
+        if(*objs[i] != i)
+        {
+            kernel_error("TEST_SLAB 4\n");
+            kernel_panic();
+        }
+    }
+
+    /* A freed object is reused without constructing a new one */
+    error = kmem_cache_free(&cache, objs[50]);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_SLAB 5\n");
+        kernel_panic();
+    }
+    obj = kmem_cache_alloc(&cache);
+    if(obj != objs[50] || *obj != 50)
+    {
+        kernel_error("TEST_SLAB 6\n");
+        kernel_panic();
+    }
+
+    /* Free NULL object */
+    error = kmem_cache_free(&cache, NULL);
+    if(error != OS_ERR_NULL_POINTER)
+    {
+        kernel_error("TEST_SLAB 7\n");
+        kernel_panic();
+    }
+
+    /* Free all objects, the slabs are destroyed */
+    for(uint32_t i = 0; i < 100; ++i)
+    {
+        error = kmem_cache_free(&cache, objs[i]);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_SLAB 8\n");
+            kernel_panic();
+        }
+    }
+
+    if(cache.obj_count != 0 || cache.empty_count != KMEM_CACHE_MAX_EMPTY)
+    {
+        kernel_error("TEST_SLAB 9\n");
+        kernel_panic();
+    }
+
+    if(kmem_cache_shrink(&cache) != KMEM_CACHE_MAX_EMPTY ||
+       cache.slab_count != 0 || dtor_count != ctor_count)
+    {
+        kernel_error("TEST_SLAB 10\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Kernel object caches tests passed\n");
+}
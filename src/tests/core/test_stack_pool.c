@@ -0,0 +1,133 @@
+/*******************************************************************************
+ *
+ * File: test_stack_pool.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Kernel threads stacks pool tests
+ ******************************************************************************/
+
+#include "../../memory/stack_pool.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../lib/stddef.h"
+
+void test_stack_pool(void)
+{
+    OS_RETURN_E    error;
+    kernel_stack_t stacks[20];
+    kernel_stack_t copy;
+
+    /* Wrong sizes */
+    error = stack_pool_alloc(0, &stacks[0]);
+    if(error != OS_ERR_OUT_OF_BOUND)
+    {
+        kernel_error("TEST_STACK_POOL 0\n");
+        kernel_panic();
+    }
+    error = stack_pool_alloc(STACK_POOL_MAX_SIZE + 1, &stacks[0]);
+    if(error != OS_ERR_OUT_OF_BOUND)
+    {
+        kernel_error("TEST_STACK_POOL 1\n");
+        kernel_panic();
+    }
+
+    /* Allocate NULL stack */
+    error = stack_pool_alloc(KERNEL_PAGE_SIZE, NULL);
+    if(error != OS_ERR_NULL_POINTER)
+    {
+        kernel_error("TEST_STACK_POOL 2\n");
+        kernel_panic();
+    }
+
+    /* Allocate stacks over several chunks, sizes are rounded to two pages */
+    for(uint32_t i = 0; i < 20; ++i)
+    {
+        error = stack_pool_alloc(5000, &stacks[i]);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_STACK_POOL 3\n");
+            kernel_panic();
+        }
+        if(stacks[i].size != 2 * KERNEL_PAGE_SIZE ||
+           ((uint32_t)stacks[i].base & (KERNEL_PAGE_SIZE - 1)) != 0 ||
+           stack_pool_high_water(&stacks[i]) != 0)
+        {
+            kernel_error("TEST_STACK_POOL 4\n");
+            kernel_panic();
+        }
+        for(uint32_t j = 0; j < i; ++j)
+        {
+            if(stacks[j].base == stacks[i].base)
+            {
+                kernel_error("TEST_STACK_POOL 5\n");
+                kernel_panic();
+            }
+        }
+    }
+
+    /* The high water mark is measured from the top of the stack */
+    stacks[0].base[stacks[0].size / sizeof(uint32_t) - 25] = 0;
+    if(stack_pool_high_water(&stacks[0]) != 25 * sizeof(uint32_t))
+    {
+        kernel_error("TEST_STACK_POOL 6\n");
+        kernel_panic();
+    }
+
+    /* A freed stack is filled again when reused */
+    stacks[10].base[0] = 0;
+    error = stack_pool_free(&stacks[10]);
+    if(error != OS_NO_ERR || stacks[10].base != NULL)
+    {
+        kernel_error("TEST_STACK_POOL 7\n");
+        kernel_panic();
+    }
+    error = stack_pool_alloc(2 * KERNEL_PAGE_SIZE, &stacks[10]);
+    if(error != OS_NO_ERR || stack_pool_high_water(&stacks[10]) != 0)
+    {
+        kernel_error("TEST_STACK_POOL 8\n");
+        kernel_panic();
+    }
+
+    /* Free a stack twice */
+    copy  = stacks[5];
+    error = stack_pool_free(&stacks[5]);
+    if(error != OS_NO_ERR)
+    {
+        kernel_error("TEST_STACK_POOL 9\n");
+        kernel_panic();
+    }
+    error = stack_pool_free(&copy);
+    if(error != OS_ERR_UNAUTHORIZED_ACTION)
+    {
+        kernel_error("TEST_STACK_POOL 10\n");
+        kernel_panic();
+    }
+    error = stack_pool_free(&stacks[5]);
+    if(error != OS_ERR_NULL_POINTER)
+    {
+        kernel_error("TEST_STACK_POOL 11\n");
+        kernel_panic();
+    }
+
+    /* Free the other stacks */
+    for(uint32_t i = 0; i < 20; ++i)
+    {
+        if(i == 5)
+        {
+            continue;
+        }
+        error = stack_pool_free(&stacks[i]);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_STACK_POOL 12\n");
+            kernel_panic();
+        }
+    }
+
+    kernel_debug("Kernel stacks pool tests passed\n");
+}
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ *
+ * File: test_tls.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Thread local storage tests. The tests create threads,
+ * they are executed by the INIT thread once the scheduler is started.
+ ******************************************************************************/
+
+#include "../../core/scheduler.h"
+#include "../../core/kernel_thread.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../sync/futex.h"
+#include "../../lib/stddef.h"
+#include "../../lib/stdint.h"
+
+/* Each thread reports a different error, then sleeps so the other thread
+ * executes on the same CPU before the error is read back through FS.
+ */
+static void* test_tls_routine(void* args)
+{
+    kernel_thread_t* thread;
+    fmutex_t         mutex = FMUTEX_INIT;
+    fsem_t           sem   = FSEM_INIT(0);
+    OS_RETURN_E      expected;
+
+    thread = get_current_thread();
+    if(THREAD_LOCAL_READ(self) != &thread->tls ||
+       THREAD_LOCAL_READ(thread) != thread ||
+       get_last_error() != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    if((uint32_t)args == 0)
+    {
+        expected = fmutex_unlock(&mutex);
+    }
+    else
+    {
+        expected = fsem_try_pend(&sem);
+    }
+
+    if(sleep(10) != OS_NO_ERR)
+    {
+        return (void*)1;
+    }
+
+    if(get_last_error() != expected ||
+       THREAD_LOCAL_READ(thread) != get_current_thread())
+    {
+        return (void*)1;
+    }
+
+    return NULL;
+}
+
+void test_tls(void)
+{
+    OS_RETURN_E error;
+    thread_t    threads[2];
+    void*       ret;
+    uint32_t    i;
+
+    set_last_error(OS_NO_ERR);
+
+    for(i = 0; i < 2; ++i)
+    {
+        error = create_thread_affinity(&threads[i], test_tls_routine,
+                                       KERNEL_LOWEST_PRIORITY - 1, "test_tls",
+                                       (void*)i, THREAD_AFFINITY_CPU(0),
+                                       THREAD_STACK_SIZE);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_TLS 0\n");
+            kernel_panic();
+        }
+    }
+
+    for(i = 0; i < 2; ++i)
+    {
+        error = wait_thread(threads[i], &ret);
+        if(error != OS_NO_ERR || ret != NULL)
+        {
+            kernel_error("TEST_TLS %d\n", i + 1);
+            kernel_panic();
+        }
+    }
+
+    /* The errors of the other threads did not reach INIT */
+    if(get_last_error() != OS_NO_ERR)
+    {
+        kernel_error("TEST_TLS 3\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Thread local storage tests passed\n");
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************
+ *
+ * File: test_tsc.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: TSC clocksource tests
+ ******************************************************************************/
+
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../drivers/tsc.h"
+
+/*
+ * !!! THESE TESTS MUST BE DONE AFTER INITIALIZING THE TSC !!!
+ */
+
+void test_tsc(void)
+{
+    uint64_t first;
+    uint64_t second;
+    uint64_t one_second;
+    uint32_t freq_khz;
+
+    /* TEST MONOTONIC CLOCK */
+    first  = get_monotonic_ns();
+    second = get_monotonic_ns();
+    if(second < first)
+    {
+        kernel_error("TEST_TSC 0\n");
+        kernel_panic();
+    }
+
+    freq_khz = get_tsc_frequency_khz();
+    if(freq_khz != 0)
+    {
+        /* TEST CONVERSION, ONE SECOND OF CYCLES WITHIN 0.1% */
+        one_second = tsc_cycles_to_ns((uint64_t)freq_khz * 1000);
+        if(one_second < 999000000ULL || one_second > 1001000000ULL)
+        {
+            kernel_error("TEST_TSC 1\n");
+            kernel_panic();
+        }
+
+        /* TEST CONVERSION ABOVE 32 BITS */
+        one_second = tsc_cycles_to_ns((uint64_t)freq_khz * 10000);
+        if(one_second < 9990000000ULL || one_second > 10010000000ULL)
+        {
+            kernel_error("TEST_TSC 2\n");
+            kernel_panic();
+        }
+
+        /* TEST CYCLES COUNTER */
+        first  = get_cycles();
+        second = get_cycles();
+        if(second <= first)
+        {
+            kernel_error("TEST_TSC 3\n");
+            kernel_panic();
+        }
+    }
+
+    kernel_debug("TSC tests passed\n");
+}
@@ -0,0 +1,290 @@
+/*******************************************************************************
+ *
+ * File: test_workqueue.c
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 16/10/2026
+ *
+ * Version: 1.0
+ *
+ * Kernel tests bank: Work queues tests. The tests create threads, they are
+ * executed by the INIT thread once the scheduler is started.
+ ******************************************************************************/
+
+#include "../../core/workqueue.h"
+#include "../../core/scheduler.h"
+#include "../../core/kernel_thread.h"
+#include "../../core/kernel_output.h"
+#include "../../core/panic.h"
+#include "../../cpu/cpu.h"
+#include "../../cpu/smp.h"
+#include "../../lib/stddef.h"
+#include "../../lib/stdint.h"
+
+/* Time given to a routine to execute before the test fails, in ms */
+#define TEST_WORK_TIMEOUT 2000
+
+/* Number of times each queuing thread queues the executing item */
+#define TEST_WORK_QUEUES 100
+
+/* Number of executions of the item queuing itself */
+#define TEST_WORK_REQUEUES 3
+
+/* Priority of the queuing threads */
+#define TEST_WORK_PRIO 20
+
+static work_t            test_work;
+static volatile uint32_t work_active;
+static volatile uint32_t work_overlap;
+static volatile uint32_t work_started;
+static volatile uint32_t work_done;
+static volatile uint32_t work_release;
+static volatile uint32_t work_cpu[TEST_WORK_REQUEUES];
+static volatile uint32_t work_queued;
+
+/* Records the execution of the test item and checks no other worker executes
+ * it at the same time.
+ *
+ * @returns The index of the execution.
+ */
+static uint32_t test_work_enter(void)
+{
+    uint32_t index;
+
+    if(cpu_fetch_add(&work_active, 1) != 0)
+    {
+        work_overlap = 1;
+    }
+
+    index = work_started++;
+    if(index < TEST_WORK_REQUEUES)
+    {
+        work_cpu[index] = get_cpu_id();
+    }
+
+    return index;
+}
+
+/* Ends the execution of the test item */
+static void test_work_leave(void)
+{
+    cpu_fetch_add(&work_active, -1);
+    ++work_done;
+}
+
+/* The first execution waits for the test to release it */
+static void test_work_routine(void* args)
+{
+    (void)args;
+
+    if(test_work_enter() == 0)
+    {
+        while(work_release == 0)
+        {
+            sleep(1);
+        }
+    }
+
+    test_work_leave();
+}
+
+/* Queues itself again until it executed TEST_WORK_REQUEUES times */
+static void test_work_requeue_routine(void* args)
+{
+    if(test_work_enter() + 1 < TEST_WORK_REQUEUES &&
+       queue_work((work_t*)args) != OS_NO_ERR)
+    {
+        work_overlap = 1;
+    }
+
+    test_work_leave();
+}
+
+/* Counts the executions of the item queued after the restart */
+static void test_work_count_routine(void* args)
+{
+    (void)args;
+
+    ++work_done;
+}
+
+/* Queues the test item while its routine executes */
+static void* test_work_queue_routine(void* args)
+{
+    uint32_t i;
+
+    (void)args;
+
+    for(i = 0; i < TEST_WORK_QUEUES; ++i)
+    {
+        if(queue_work(&test_work) != OS_NO_ERR)
+        {
+            return (void*)1;
+        }
+        ++work_queued;
+    }
+
+    return NULL;
+}
+
+/* Resets the executions records of the test item */
+static void test_work_reset(void)
+{
+    uint32_t i;
+
+    work_active  = 0;
+    work_overlap = 0;
+    work_started = 0;
+    work_done    = 0;
+    work_release = 0;
+    work_queued  = 0;
+
+    for(i = 0; i < TEST_WORK_REQUEUES; ++i)
+    {
+        work_cpu[i] = 0xFFFFFFFF;
+    }
+}
+
+/* Sleep until the test item executed a number of times and is idle.
+ *
+ * @param count The number of executions to wait for.
+ * @returns 1 if the item executed before TEST_WORK_TIMEOUT, 0 otherwise.
+ */
+static uint8_t test_work_wait(const uint32_t count)
+{
+    uint32_t i;
+
+    for(i = 0; i < TEST_WORK_TIMEOUT; ++i)
+    {
+        if(work_done >= count && test_work.pending == 0 &&
+           test_work.running == 0)
+        {
+            return 1;
+        }
+        sleep(1);
+    }
+
+    return 0;
+}
+
+void test_workqueue(void)
+{
+    OS_RETURN_E error;
+    thread_t    threads[2];
+    void*       ret;
+    uint32_t    cpus[2];
+    uint32_t    i;
+
+    /* Queued from two CPUs while the routine executes, the item is executed
+     * again once, by the same worker.
+     */
+    test_work_reset();
+    if(work_init(&test_work, test_work_routine, NULL) != OS_NO_ERR ||
+       queue_work(&test_work) != OS_NO_ERR)
+    {
+        kernel_error("TEST_WORKQUEUE 0\n");
+        kernel_panic();
+    }
+    for(i = 0; i < TEST_WORK_TIMEOUT && work_started == 0; ++i)
+    {
+        sleep(1);
+    }
+    if(work_started != 1)
+    {
+        kernel_error("TEST_WORKQUEUE 1\n");
+        kernel_panic();
+    }
+
+    cpus[0] = 0;
+    cpus[1] = get_booted_cpu_count() - 1;
+    for(i = 0; i < 2; ++i)
+    {
+        error = create_thread_affinity(&threads[i], test_work_queue_routine,
+                                       TEST_WORK_PRIO, "test_work", NULL,
+                                       THREAD_AFFINITY_CPU(cpus[i]),
+                                       THREAD_STACK_SIZE);
+        if(error != OS_NO_ERR)
+        {
+            kernel_error("TEST_WORKQUEUE 2\n");
+            kernel_panic();
+        }
+    }
+    for(i = 0; i < 2; ++i)
+    {
+        error = wait_thread(threads[i], &ret);
+        if(error != OS_NO_ERR || ret != NULL)
+        {
+            kernel_error("TEST_WORKQUEUE 3\n");
+            kernel_panic();
+        }
+    }
+    if(work_queued != 2 * TEST_WORK_QUEUES || test_work.pending != 1 ||
+       test_work.running != 1 || work_started != 1)
+    {
+        kernel_error("TEST_WORKQUEUE 4\n");
+        kernel_panic();
+    }
+
+    work_release = 1;
+    if(test_work_wait(2) == 0 || work_started != 2 || work_overlap != 0 ||
+       work_cpu[0] != work_cpu[1])
+    {
+        kernel_error("TEST_WORKQUEUE 5\n");
+        kernel_panic();
+    }
+
+    /* Queued again by its own routine */
+    test_work_reset();
+    if(work_init(&test_work, test_work_requeue_routine, &test_work) !=
+       OS_NO_ERR ||
+       queue_work(&test_work) != OS_NO_ERR)
+    {
+        kernel_error("TEST_WORKQUEUE 6\n");
+        kernel_panic();
+    }
+    if(test_work_wait(TEST_WORK_REQUEUES) == 0 ||
+       work_started != TEST_WORK_REQUEUES || work_overlap != 0)
+    {
+        kernel_error("TEST_WORKQUEUE 7\n");
+        kernel_panic();
+    }
+    for(i = 1; i < TEST_WORK_REQUEUES; ++i)
+    {
+        if(work_cpu[i] != work_cpu[0])
+        {
+            kernel_error("TEST_WORKQUEUE 8\n");
+            kernel_panic();
+        }
+    }
+
+    /* Stopped queues, the caller executes the work itself */
+    test_work_reset();
+    if(work_init(&test_work, test_work_count_routine, NULL) != OS_NO_ERR ||
+       stop_workqueues() != OS_NO_ERR)
+    {
+        kernel_error("TEST_WORKQUEUE 9\n");
+        kernel_panic();
+    }
+    if(queue_work(&test_work) != OS_ERR_UNAUTHORIZED_ACTION ||
+       test_work.pending != 0 || work_done != 0)
+    {
+        kernel_error("TEST_WORKQUEUE 10\n");
+        kernel_panic();
+    }
+
+    /* Restarted queues */
+    if(init_workqueues(WORKQUEUE_THREAD_PRIORITY) != OS_NO_ERR ||
+       queue_work(&test_work) != OS_NO_ERR)
+    {
+        kernel_error("TEST_WORKQUEUE 11\n");
+        kernel_panic();
+    }
+    if(test_work_wait(1) == 0 || work_done != 1)
+    {
+        kernel_error("TEST_WORKQUEUE 12\n");
+        kernel_panic();
+    }
+
+    kernel_debug("Work queues tests passed\n");
+}
@@ -44,5 +44,28 @@ extern void test_mouse(void);
 extern void test_bios_call(void);
 extern void test_ata(void);
 extern void test_klist(void);
+extern void test_rbtree(void);
+extern void test_slab(void);
+extern void test_stack_pool(void);
+extern void test_futex(void);
+extern void test_tsc(void);
+
+/* Executed by INIT once the scheduler is started */
+extern void test_sched_fair(void);
+extern void test_tls(void);
+extern void test_mutex_pi(void);
+extern void test_sched_sleep(void);
+extern void test_sched_wheel(void);
+extern void test_sched_affinity(void);
+extern void test_sched_balance(void);
+extern void test_sched_deadline(void);
+extern void test_sched_period(void);
+extern void test_sched_accounting(void);
+extern void test_sched_hist(void);
+extern void test_sched_teardown(void);
+extern void test_mutex_adaptive(void);
+extern void test_futex_contended(void);
+extern void test_workqueue(void);
+extern void test_fpu(void);
 
  #endif /* __TESTS_H_ */
@@ -2,6 +2,7 @@
 #define TEST_SEM
 #define TEST_MULTITHREAD
 #define TEST_PAYLOAD
+#define TEST_POOL_PAYLOAD
 
 #define TESTS 1
 
@@ -13,10 +14,11 @@
 #include "../../lib/stdio.h"
 #include "../../sync/lock.h"
 #include "../../core/scheduler.h"
+#include "../../core/thread_pool.h"
 #include "../../core/kernel_output.h"
 
 #ifdef TESTS
-static const int32_t tests_count = 4;
+static const int32_t tests_count = 5;
 #endif
 
 /***************
@@ -29,6 +31,31 @@ static const int32_t tests_count = 4;
  	return NULL;
  }
 
+void th_pool(uint32_t first, uint32_t last, void* args)
+{
+    (void)args;
+    for(uint32_t i = first; i < last; ++i)
+    {
+        printf("HI %d ", i);
+    }
+}
+
+uint32_t th_pool_sum(uint32_t first, uint32_t last, void* args)
+{
+    uint32_t sum = 0;
+    (void)args;
+    for(uint32_t i = first; i < last; ++i)
+    {
+        sum += i;
+    }
+    return sum;
+}
+
+uint32_t th_pool_add(uint32_t a, uint32_t b)
+{
+    return a + b;
+}
+
 
 void *launch_tests(void*args)
 {
@@ -58,8 +85,28 @@ void *launch_tests(void*args)
     printf("[OK] Test payload passed\n");
 #endif
 
-#ifdef TEST_SEM
+#ifdef TEST_POOL_PAYLOAD
     printf("2/%d\n", tests_count);
+
+    uint32_t sum;
+
+    /* The payload runs on the thread pool workers */
+    if(parallel_for(0, 200, 1, th_pool, NULL) != OS_NO_ERR ||
+       parallel_reduce(0, 200, 1, th_pool_sum, th_pool_add, 0, NULL, &sum) !=
+       OS_NO_ERR || sum != 19900)
+    {
+        printf("\n");
+        printf(" Test pool payload failed\n");
+    }
+    else
+    {
+        printf("\n");
+        printf("[OK] Test pool payload passed\n");
+    }
+#endif
+
+#ifdef TEST_SEM
+    printf("3/%d\n", tests_count);
     if(test_sem())
     {
         printf(" Test semaphores failed\n");
@@ -72,7 +119,7 @@ void *launch_tests(void*args)
 #endif
     printf("\n");
 #ifdef TEST_MUTEX
-    printf("3/%d\n", tests_count);
+    printf("4/%d\n", tests_count);
     if(test_mutex())
     {
         printf(" Test mutex failed\n");
@@ -84,7 +131,7 @@ void *launch_tests(void*args)
 #endif
     printf("\n");
 #ifdef TEST_MULTITHREAD
-    printf("4/%d\n", tests_count);
+    printf("5/%d\n", tests_count);
     if(test_multithread())
     {
         printf(" Test multithread failed\n");